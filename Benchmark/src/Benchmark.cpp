@@ -0,0 +1,24 @@
+#include "Benchmark.h"
+
+#include <chrono>
+
+#include "engine/Log.h"
+
+namespace Benchmark
+{
+	double Measure(int iterations, const std::function<void()>& func)
+	{
+		func();
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i) func();
+
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+	}
+
+	bool Check(bool passed, std::string_view what)
+	{
+		if (!passed) feLog::Error("Check failed: {}", what);
+		return passed;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+
+// Helpers shared by the benchmarks, every benchmark logs its own timings and returns false if a result check failed
+namespace Benchmark
+{
+	// Mean milliseconds per run of func over iterations runs, after one untimed warm up run
+	double Measure(int iterations, const std::function<void()>& func);
+	// Logs an error when passed is false and returns it
+	bool Check(bool passed, std::string_view what);
+}
+
+// Only use the CPU
+bool RunSphereBenchmark();
+bool RunSphereMeshBenchmark();
+bool RunTransformBenchmark();
+bool RunBvhBenchmark();
+bool RunOcclusionBenchmark();
+
+// Need a current OpenGL context
+bool RunUniformBenchmark();
+bool RunMeshBenchmark();
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "engine/Log.h"
+#include "engine/math/Bvh.h"
+#include "engine/math/Frustum.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr size_t SphereCount = 100000;
+	constexpr int BuildIterations = 5;
+	constexpr int QueryCount = 50;
+	constexpr int RayCount = 500;
+	constexpr size_t MovedCount = 1000;
+
+	struct Scene final
+	{
+		std::vector<glm::vec3> centers;
+		std::vector<float> radii;
+		std::vector<feAabb> bounds;
+	};
+
+	bool Overlaps(const feAabb& a, const feAabb& b)
+	{
+		return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	bool OverlapsSphere(const feAabb& box, const glm::vec3& center, float radius)
+	{
+		glm::vec3 offset = glm::max(glm::max(box.min - center, center - box.max), glm::vec3(0.0f));
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+
+	// Both lists hold the same indices, the tree returns them in no particular order
+	bool SameIndices(std::vector<uint32_t>& result, const std::vector<uint32_t>& expected)
+	{
+		std::sort(result.begin(), result.end());
+		return result == expected;
+	}
+
+	// Times QueryCount tree queries and brute force scans over random shapes, returns false if any result differs
+	bool CompareQueries(const feBvh& bvh, const Scene& scene, std::mt19937& random, const char* stage)
+	{
+		std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-100.0f, 100.0f);
+		std::vector<uint32_t> result;
+		std::vector<uint32_t> expected;
+		double treeMs = 0.0;
+		double bruteMs = 0.0;
+		size_t found = 0;
+		bool passed = true;
+
+		auto time = [](double& total, auto&& func)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		for (int query = 0; query < QueryCount; ++query)
+		{
+			glm::vec3 eye = glm::vec3(position(random), position(random), position(random));
+			feFrustum frustum = feFrustum::FromMatrix(glm::perspective(0.8f, 16.0f / 9.0f, 0.1f, 80.0f) * glm::translate(glm::mat4(1.0f), eye));
+
+			result.clear();
+			expected.clear();
+			time(treeMs, [&]() { bvh.QueryFrustum(frustum, result); });
+			time(bruteMs, [&]()
+			{
+				for (size_t i = 0; i < SphereCount; ++i) if (frustum.IntersectsAabb(scene.bounds[i].min, scene.bounds[i].max)) expected.push_back(static_cast<uint32_t>(i));
+			});
+
+			found += result.size();
+			passed = SameIndices(result, expected) && passed;
+
+			glm::vec3 center = glm::vec3(position(random), position(random), position(random));
+			feAabb box = feAabb::FromSphere(center, 10.0f);
+
+			result.clear();
+			expected.clear();
+			time(treeMs, [&]()
+			{
+				bvh.QueryAabb(box, result);
+				bvh.QuerySphere(center, 10.0f, result);
+			});
+			time(bruteMs, [&]()
+			{
+				for (size_t i = 0; i < SphereCount; ++i) if (Overlaps(scene.bounds[i], box)) expected.push_back(static_cast<uint32_t>(i));
+				for (size_t i = 0; i < SphereCount; ++i) if (OverlapsSphere(scene.bounds[i], center, 10.0f)) expected.push_back(static_cast<uint32_t>(i));
+			});
+
+			std::sort(expected.begin(), expected.end());
+			passed = SameIndices(result, expected) && passed;
+		}
+
+		double rayTreeMs = 0.0;
+		double rayBruteMs = 0.0;
+		size_t hits = 0;
+
+		for (int ray = 0; ray < RayCount; ++ray)
+		{
+			glm::vec3 origin = glm::vec3(position(random), position(random), position(random));
+			glm::vec3 direction = glm::normalize(glm::vec3(position(random), position(random), position(random)));
+
+			auto intersect = [&](uint32_t index) { return feBvh::IntersectRaySphere(origin, direction, scene.centers[index], scene.radii[index]); };
+
+			feBvhRayHit hit;
+			time(rayTreeMs, [&]() { bvh.Raycast(origin, direction, 1000.0f, intersect, hit); });
+
+			feBvhRayHit expectedHit;
+			time(rayBruteMs, [&]()
+			{
+				for (uint32_t i = 0; i < SphereCount; ++i)
+				{
+					float distance = intersect(i);
+					if (distance >= 0.0f && distance <= 1000.0f && distance < expectedHit.distance) expectedHit = { i, distance };
+				}
+			});
+
+			// Spheres at the same distance can tie, so only the distance has to agree
+			hits += hit.index != UINT32_MAX;
+			passed = (hit.index == UINT32_MAX) == (expectedHit.index == UINT32_MAX) && (hit.index == UINT32_MAX || std::abs(hit.distance - expectedHit.distance) < 1e-4f) && passed;
+		}
+
+		feLog::Info("BVH {}, {} frustum, box and sphere queries: tree {:.3f} ms, brute force {:.3f} ms, {} in view on average", stage, QueryCount, treeMs, bruteMs, found / QueryCount);
+		feLog::Info("BVH {}, {} rays: tree {:.3f} ms, brute force {:.3f} ms, {} hits", stage, RayCount, rayTreeMs, rayBruteMs, hits);
+
+		return Benchmark::Check(passed, "BVH queries match brute force");
+	}
+}
+
+// Builds a tree over SphereCount random spheres and compares its frustum, box, sphere and ray queries against brute
+// force, once built, after moving a few spheres and refitting only them, and after moving all of them
+bool RunBvhBenchmark()
+{
+	std::mt19937 random = std::mt19937(5);
+	std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius = std::uniform_real_distribution<float>(0.1f, 1.5f);
+	std::uniform_real_distribution<float> step = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+	Scene scene;
+	scene.centers.resize(SphereCount);
+	scene.radii.resize(SphereCount);
+	scene.bounds.resize(SphereCount);
+
+	for (size_t i = 0; i < SphereCount; ++i)
+	{
+		scene.centers[i] = glm::vec3(position(random), position(random), position(random));
+		scene.radii[i] = radius(random);
+		scene.bounds[i] = feAabb::FromSphere(scene.centers[i], scene.radii[i]);
+	}
+
+	feBvhCreateInfo info;
+	info.bounds = scene.bounds.data();
+	info.count = SphereCount;
+
+	feBvh bvh;
+	double buildMs = Benchmark::Measure(BuildIterations, [&]() { bvh = feBvh(info); });
+
+	feLog::Info("BVH over {} spheres: build {:.3f} ms, {} nodes", SphereCount, buildMs, bvh.GetNodeCount());
+
+	bool passed = Benchmark::Check(bvh.IsValid() && bvh.GetPrimitiveCount() == SphereCount, "BVH holds every sphere");
+	passed = CompareQueries(bvh, scene, random, "built") && passed;
+
+	std::vector<uint32_t> changed = std::vector<uint32_t>(MovedCount);
+	for (uint32_t& index : changed)
+	{
+		index = static_cast<uint32_t>(random() % SphereCount);
+		scene.centers[index] += glm::vec3(step(random), step(random), step(random));
+		scene.bounds[index] = feAabb::FromSphere(scene.centers[index], scene.radii[index]);
+	}
+
+	double changedRefitMs = Benchmark::Measure(1, [&]() { bvh.Refit(scene.bounds.data(), changed.data(), changed.size()); });
+	passed = CompareQueries(bvh, scene, random, "after refitting moved spheres") && passed;
+
+	for (size_t i = 0; i < SphereCount; ++i)
+	{
+		scene.centers[i] += glm::vec3(step(random), step(random), step(random));
+		scene.bounds[i] = feAabb::FromSphere(scene.centers[i], scene.radii[i]);
+	}
+
+	double refitMs = Benchmark::Measure(BuildIterations, [&]() { bvh.Refit(scene.bounds.data()); });
+	passed = CompareQueries(bvh, scene, random, "after a full refit") && passed;
+
+	feLog::Info("BVH refit: {} moved spheres {:.3f} ms, every sphere {:.3f} ms", MovedCount, changedRefitMs, refitMs);
+
+	return passed;
+}
\ No newline at end of file
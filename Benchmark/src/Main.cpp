@@ -0,0 +1,98 @@
+#include <cstring>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/Window.h"
+#include "engine/Log.h"
+#include "engine/renderer/Util.h"
+#include "Benchmark.h"
+
+struct BenchmarkEntry final
+{
+	const char* name;
+	bool (*run)();
+	bool needsContext;
+};
+
+static const BenchmarkEntry s_Benchmarks[] =
+{
+	{ "uniform", RunUniformBenchmark, true },
+	{ "mesh", RunMeshBenchmark, true },
+	{ "sphere", RunSphereBenchmark, false },
+	{ "spheremesh", RunSphereMeshBenchmark, false },
+	{ "transform", RunTransformBenchmark, false },
+	{ "bvh", RunBvhBenchmark, false },
+	{ "occlusion", RunOcclusionBenchmark, false }
+};
+
+// Hidden window with the highest core context the driver offers, the first one only asks for the version
+static bool MakeContext(std::unique_ptr<feWindow>& window)
+{
+	unsigned char version = 40;
+
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		feWindowCreateInfo info;
+		info.width = 64;
+		info.height = 64;
+		info.title = "Benchmark";
+		info.contextMajor = version / 10;
+		info.contextMinor = version % 10;
+		info.contextForwardCompat = true;
+		info.contextProfileCore = true;
+		info.visible = false;
+
+		window = std::make_unique<feWindow>(info);
+		if (!window->GetHandle()) return false;
+
+		feContext::Load(*window);
+		feRenderUtil::ClearLoadedFlag();
+		version = feRenderUtil::GetSupportedVersion();
+	}
+
+	return true;
+}
+
+// Benchmarks named on the command line run in their listed order, without names all of them run. Returns the number
+// of benchmarks whose result checks failed.
+int main(int argc, char* argv[])
+{
+	// Resource creation logs at trace level, which would dominate the timings
+	spdlog::set_level(spdlog::level::info);
+
+	auto selected = [argc, argv](const BenchmarkEntry& entry)
+	{
+		if (argc < 2) return true;
+		for (int i = 1; i < argc; ++i) if (std::strcmp(argv[i], entry.name) == 0) return true;
+		return false;
+	};
+
+	// Only made once a benchmark needs it, the others run headless
+	std::unique_ptr<feWindow> window;
+	bool hasContext = false;
+	bool triedContext = false;
+	int failed = 0;
+
+	for (const BenchmarkEntry& entry : s_Benchmarks)
+	{
+		if (!selected(entry)) continue;
+
+		if (entry.needsContext && !triedContext)
+		{
+			triedContext = true;
+			hasContext = MakeContext(window);
+		}
+
+		if (entry.needsContext && !hasContext)
+		{
+			feLog::Warn("Skipping {}, no OpenGL context", entry.name);
+			continue;
+		}
+
+		feLog::Info("Running {}", entry.name);
+		if (!entry.run()) ++failed;
+	}
+
+	return failed;
+}
\ No newline at end of file
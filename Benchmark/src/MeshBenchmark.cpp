@@ -0,0 +1,99 @@
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "engine/Log.h"
+#include "engine/renderer/BufferObject.h"
+#include "engine/renderer/VertexArray.h"
+#include "engine/renderer/Util.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr int MeshCount = 5000;
+	constexpr int Iterations = 5;
+	// Position, normal and tex coord like the sphere meshes
+	constexpr int VertexFloats = 8;
+	constexpr int VertexCount = 256;
+	constexpr int IndexCount = 1536;
+
+	// Creates and destroys MeshCount meshes of a vertex buffer, an index buffer and a vertex array, returns false if GL
+	// reported an error
+	bool CreateAndDestroyMeshes(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+	{
+		feVertexArrayCreateInfoAttributeInfo attributes[3];
+		attributes[0].size = 3;
+		attributes[0].type = GL_FLOAT;
+		attributes[0].offset = 0;
+		attributes[1].size = 3;
+		attributes[1].type = GL_FLOAT;
+		attributes[1].offset = 3 * sizeof(float);
+		attributes[2].size = 2;
+		attributes[2].type = GL_FLOAT;
+		attributes[2].offset = 6 * sizeof(float);
+
+		for (int i = 0; i < MeshCount; ++i)
+		{
+			feBufferObjectCreateInfo vertexInfo;
+			vertexInfo.target = GL_ARRAY_BUFFER;
+			vertexInfo.data = vertices.data();
+			vertexInfo.size = vertices.size() * sizeof(float);
+
+			feBufferObjectCreateInfo indexInfo;
+			indexInfo.target = GL_ELEMENT_ARRAY_BUFFER;
+			indexInfo.data = indices.data();
+			indexInfo.size = indices.size() * sizeof(unsigned int);
+
+			feBufferObject vertexBuffer = vertexInfo;
+			feBufferObject indexBuffer = indexInfo;
+
+			feVertexArrayCreateInfoBufferObjectInfo bufferInfo;
+			bufferInfo.buffer = &vertexBuffer;
+			bufferInfo.stride = VertexFloats * sizeof(float);
+
+			feVertexArrayCreateInfo arrayInfo;
+			arrayInfo.vertexBufferInfos = &bufferInfo;
+			arrayInfo.vertexBufferInfoCount = 1;
+			arrayInfo.attributeInfos = attributes;
+			arrayInfo.attributeInfoCount = 3;
+			arrayInfo.indexBuffer = &indexBuffer;
+			arrayInfo.count = IndexCount;
+			arrayInfo.mode = GL_TRIANGLES;
+
+			feVertexArray vertexArray = arrayInfo;
+		}
+
+		// Deletion is deferred by most drivers, waiting makes both paths pay for it
+		glFinish();
+		return glGetError() == GL_NO_ERROR;
+	}
+}
+
+// Creates and destroys thousands of meshes through direct state access and through the bind-to-edit fallback
+bool RunMeshBenchmark()
+{
+	std::vector<float> vertices = std::vector<float>(VertexCount * VertexFloats, 0.5f);
+	std::vector<unsigned int> indices = std::vector<unsigned int>(IndexCount);
+	for (int i = 0; i < IndexCount; ++i) indices[i] = static_cast<unsigned int>(i % VertexCount);
+
+	bool passed = true;
+	bool valid = false;
+
+	feBufferObject::SetDirectStateAccessEnabled(false);
+	double boundMs = Benchmark::Measure(Iterations, [&]() { valid = CreateAndDestroyMeshes(vertices, indices); });
+	passed = Benchmark::Check(valid, "bind-to-edit meshes raise no GL errors") && passed;
+
+	feBufferObject::SetDirectStateAccessEnabled(true);
+
+	if (!feBufferObject::IsDirectStateAccessSupported())
+	{
+		feLog::Info("Meshes, {} created and destroyed: bind-to-edit {:.3f} ms, no direct state access below GL 4.5", MeshCount, boundMs);
+		return passed;
+	}
+
+	double directMs = Benchmark::Measure(Iterations, [&]() { valid = CreateAndDestroyMeshes(vertices, indices); });
+	passed = Benchmark::Check(valid, "direct state access meshes raise no GL errors") && passed;
+
+	feLog::Info("Meshes, {} created and destroyed: bind-to-edit {:.3f} ms, direct state access {:.3f} ms", MeshCount, boundMs, directMs);
+	return passed;
+}
\ No newline at end of file
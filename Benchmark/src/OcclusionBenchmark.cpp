@@ -0,0 +1,224 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "engine/Log.h"
+#include "engine/renderer/FrustumCuller.h"
+#include "engine/renderer/OcclusionCuller.h"
+#include "engine/util/SphereMeshes.h"
+#include "engine/util/ThreadPool.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr int ViewCount = 50;
+	constexpr int OccluderCount = 8;
+	constexpr size_t SphereCount = 20000;
+	// Surface points tried per culled sphere, each one has to be hidden behind an occluder
+	constexpr int SampleCount = 64;
+
+	// Unit cube wound counter clockwise from outside, positions only
+	const float BoxPositions[] = {
+		-1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+		-1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1,
+	};
+
+	const unsigned int BoxIndices[] = {
+		4, 5, 6,  4, 6, 7,
+		1, 0, 3,  1, 3, 2,
+		5, 1, 2,  5, 2, 6,
+		0, 4, 7,  0, 7, 3,
+		7, 6, 2,  7, 2, 3,
+		0, 1, 5,  0, 5, 4,
+	};
+
+	// An occluder mesh placed in the world, with its triangles kept for the ray tests
+	struct Occluder final
+	{
+		const float* positions;
+		size_t strideFloats;
+		const unsigned int* indices;
+		size_t indexCount;
+		glm::mat4 model;
+
+		std::vector<glm::vec3> corners;
+		glm::vec3 center;
+		float radius;
+	};
+
+	Occluder MakeOccluder(const float* positions, size_t strideFloats, const unsigned int* indices, size_t indexCount, const glm::mat4& model)
+	{
+		Occluder occluder = { positions, strideFloats, indices, indexCount, model };
+		occluder.center = glm::vec3(model[3]);
+		occluder.radius = 0.0f;
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const float* position = positions + indices[i] * strideFloats;
+			glm::vec3 corner = glm::vec3(model * glm::vec4(position[0], position[1], position[2], 1.0f));
+
+			occluder.corners.push_back(corner);
+			occluder.radius = std::max(occluder.radius, glm::length(corner - occluder.center));
+		}
+
+		return occluder;
+	}
+
+	// Whether the segment from the eye to target passes through any occluder triangle before it
+	bool IsHidden(const std::vector<Occluder>& occluders, const glm::vec3& eye, const glm::vec3& target)
+	{
+		glm::vec3 direction = target - eye;
+
+		for (const Occluder& occluder : occluders)
+		{
+			// Segments that miss the bounding sphere miss every triangle
+			glm::vec3 toCenter = occluder.center - eye;
+			float along = std::clamp(glm::dot(toCenter, direction) / glm::dot(direction, direction), 0.0f, 1.0f);
+			glm::vec3 offset = toCenter - direction * along;
+			if (glm::dot(offset, offset) > occluder.radius * occluder.radius) continue;
+
+			for (size_t i = 0; i + 2 < occluder.corners.size(); i += 3)
+			{
+				glm::vec3 edge1 = occluder.corners[i + 1] - occluder.corners[i];
+				glm::vec3 edge2 = occluder.corners[i + 2] - occluder.corners[i];
+				glm::vec3 p = glm::cross(direction, edge2);
+				float determinant = glm::dot(edge1, p);
+				if (std::abs(determinant) < 1e-12f) continue;
+
+				float inverse = 1.0f / determinant;
+				glm::vec3 s = eye - occluder.corners[i];
+				float u = glm::dot(s, p) * inverse;
+				if (u < 0.0f || u > 1.0f) continue;
+
+				glm::vec3 q = glm::cross(s, edge1);
+				float v = glm::dot(direction, q) * inverse;
+				if (v < 0.0f || u + v > 1.0f) continue;
+
+				float t = glm::dot(edge2, q) * inverse;
+				if (t > 0.0f && t < 1.0f) return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+// Rasterizes boxes and icospheres in front of the camera for ViewCount random views and culls a field of random
+// spheres against them. Every culled sphere is checked by casting rays at points on its surface that face the
+// camera, a ray reaching one without passing through an occluder means the culler hid a visible sphere.
+bool RunOcclusionBenchmark()
+{
+	std::mt19937 random = std::mt19937(7);
+	std::uniform_real_distribution<float> unit = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle = std::uniform_real_distribution<float>(-0.5f, 0.5f);
+
+	feSphereMesh icosphere = feSphereMeshes::Icosphere(1.0f, 1);
+
+	feThreadPool threadPool;
+	feOcclusionCullerCreateInfo info;
+	info.threadPool = &threadPool;
+
+	feOcclusionCuller culler = info;
+	glm::mat4 projection = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+
+	std::vector<Occluder> occluders;
+	feBoundingSphereArray spheres;
+	std::vector<uint32_t> indices;
+
+	size_t tested = 0;
+	size_t culled = 0;
+	size_t leaked = 0;
+	double rasterizeMs = 0.0;
+	double testMs = 0.0;
+
+	for (int view = 0; view < ViewCount; ++view)
+	{
+		glm::vec3 eye = glm::vec3(unit(random), unit(random), unit(random)) * 10.0f;
+		glm::mat4 rotation = glm::rotate(glm::rotate(glm::mat4(1.0f), angle(random), glm::vec3(0.0f, 1.0f, 0.0f)), angle(random), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::vec3 forward = glm::vec3(rotation * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+		glm::vec3 right = glm::vec3(rotation * glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
+		glm::vec3 up = glm::vec3(rotation * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+
+		glm::mat4 viewProj = projection * glm::lookAt(eye, eye + forward, up);
+
+		// Points in front of the camera, spread over most of the view at depth
+		auto inView = [&](float depth)
+		{
+			return eye + forward * depth + right * (unit(random) * depth * 0.9f) + up * (unit(random) * depth * 0.5f);
+		};
+
+		occluders.clear();
+		for (int i = 0; i < OccluderCount; ++i)
+		{
+			glm::vec3 center = inView(6.0f + 8.0f * (unit(random) + 1.0f));
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+
+			if (i % 2 == 0)
+			{
+				model = glm::rotate(model, angle(random) * 6.0f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.01f, 0.0f)));
+				model = glm::scale(model, glm::vec3(1.0f + unit(random) * 0.5f, 1.5f + unit(random), 0.5f + unit(random) * 0.25f));
+				occluders.push_back(MakeOccluder(BoxPositions, 3, BoxIndices, sizeof(BoxIndices) / sizeof(BoxIndices[0]), model));
+			}
+			else
+			{
+				model = glm::scale(model, glm::vec3(1.5f + unit(random) * 0.5f));
+				occluders.push_back(MakeOccluder(icosphere.vertices.data(), 8, icosphere.indices.data(), icosphere.indices.size(), model));
+			}
+		}
+
+		spheres.Clear();
+		indices.clear();
+		for (size_t i = 0; i < SphereCount; ++i)
+		{
+			spheres.Add(inView(10.0f + 20.0f * (unit(random) + 1.0f)), 0.05f + 0.5f * (unit(random) + 1.0f));
+			indices.push_back(static_cast<uint32_t>(i));
+		}
+
+		culler.Begin(viewProj);
+		for (const Occluder& occluder : occluders) culler.AddOccluder(occluder.positions, occluder.strideFloats, occluder.indices, occluder.indexCount, occluder.model);
+		culler.Rasterize();
+		culler.Cull(spheres, indices);
+
+		const feOcclusionCullerStats& stats = culler.GetFrameStats();
+		tested += stats.tested;
+		culled += stats.culled;
+		rasterizeMs += stats.rasterizeMilliseconds;
+		testMs += stats.testMilliseconds;
+
+		std::vector<uint8_t> visible = std::vector<uint8_t>(SphereCount, 0);
+		for (uint32_t index : indices) visible[index] = 1;
+
+		for (size_t i = 0; i < SphereCount; ++i)
+		{
+			if (visible[i]) continue;
+
+			glm::vec3 center = spheres.GetCenter(i);
+			float radius = spheres.GetRadius(i);
+
+			for (int sample = 0; sample < SampleCount; ++sample)
+			{
+				glm::vec3 normal = glm::vec3(unit(random), unit(random), unit(random));
+				float length = glm::length(normal);
+				if (length < 1e-3f || length > 1.0f) continue;
+
+				normal = normal / length;
+				if (glm::dot(normal, eye - center) < 0.0f) normal = -normal;
+
+				if (!IsHidden(occluders, eye, center + normal * radius))
+				{
+					++leaked;
+					break;
+				}
+			}
+		}
+	}
+
+	feLog::Info("Occlusion, {} views of {} occluders over {} spheres: {} of {} culled, rasterize {:.3f} ms, test {:.3f} ms per view", ViewCount, OccluderCount, SphereCount, culled, tested, rasterizeMs / ViewCount, testMs / ViewCount);
+
+	if (leaked > 0) feLog::Error("Occlusion, {} culled spheres have surface points visible from the camera", leaked);
+	return Benchmark::Check(leaked == 0, "every culled sphere is hidden behind an occluder");
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "engine/Log.h"
+#include "engine/util/Sphere.h"
+#include "engine/util/SphereGenerator.h"
+#include "engine/util/ThreadPool.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr int Iterations = 20;
+
+	struct SphereSize final
+	{
+		int sectors;
+		int stacks;
+		bool smooth;
+	};
+
+	// The sphere the game draws, the finest LOD level and a very dense one, then the flat shaded game sphere and LOD
+	constexpr SphereSize Sizes[] = { { 36, 18, true }, { 144, 72, true }, { 1024, 512, true }, { 36, 18, false }, { 144, 72, false } };
+
+	// The generator uses the same expressions as Sphere, so every value has to match exactly
+	bool Matches(const Sphere& sphere, const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+	{
+		if (vertices.size() != sphere.getInterleavedVertexCount() * 8 || indices.size() != sphere.getIndexCount()) return false;
+		if (std::memcmp(indices.data(), sphere.getIndices(), indices.size() * sizeof(unsigned int)) != 0) return false;
+		return std::memcmp(vertices.data(), sphere.getInterleavedVertices(), vertices.size() * sizeof(float)) == 0;
+	}
+
+	// The fourth position component is padding and left out
+	bool MatchesPacked(const std::vector<Sphere::PackedVertex>& expected, const std::vector<Sphere::PackedVertex>& vertices)
+	{
+		if (vertices.size() != expected.size()) return false;
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j) if (vertices[i].position[j] != expected[i].position[j]) return false;
+			if (vertices[i].normal != expected[i].normal) return false;
+			for (int j = 0; j < 2; ++j) if (vertices[i].texCoord[j] != expected[i].texCoord[j]) return false;
+		}
+
+		return true;
+	}
+}
+
+// Builds smooth and flat spheres of a few sizes with the Sphere class, with feSphereGenerator on one thread and split
+// across a thread pool, both as floats and packed. Every generated mesh is compared against the one Sphere built.
+bool RunSphereBenchmark()
+{
+	feThreadPool threadPool;
+	bool passed = true;
+
+	for (const SphereSize& size : Sizes)
+	{
+		feSphereGeneratorInfo info;
+		info.sectorCount = size.sectors;
+		info.stackCount = size.stacks;
+		info.smooth = size.smooth;
+
+		std::vector<float> vertices = std::vector<float>(feSphereGenerator::GetVertexCount(info) * 8);
+		std::vector<unsigned int> indices = std::vector<unsigned int>(feSphereGenerator::GetIndexCount(info));
+		std::vector<Sphere::PackedVertex> packed = std::vector<Sphere::PackedVertex>(feSphereGenerator::GetVertexCount(info));
+
+		double sphereMs = Benchmark::Measure(Iterations, [&]()
+		{
+			Sphere sphere = Sphere(info.radius, size.sectors, size.stacks, size.smooth);
+		});
+
+		double spherePackedMs = Benchmark::Measure(Iterations, [&]()
+		{
+			Sphere sphere = Sphere(info.radius, size.sectors, size.stacks, size.smooth);
+			std::vector<Sphere::PackedVertex> result = sphere.getPackedVertices();
+		});
+
+		double generatorMs = Benchmark::Measure(Iterations, [&]()
+		{
+			feSphereGenerator::Generate(info, vertices.data(), indices.data());
+		});
+
+		Sphere sphere = Sphere(info.radius, size.sectors, size.stacks, size.smooth);
+		passed = Benchmark::Check(Matches(sphere, vertices, indices), "generated sphere matches Sphere") && passed;
+
+		info.threadPool = &threadPool;
+		std::fill(vertices.begin(), vertices.end(), 0.0f);
+
+		double threadedMs = Benchmark::Measure(Iterations, [&]()
+		{
+			feSphereGenerator::Generate(info, vertices.data(), indices.data());
+		});
+
+		passed = Benchmark::Check(Matches(sphere, vertices, indices), "sphere generated across threads matches Sphere") && passed;
+
+		double packedMs = Benchmark::Measure(Iterations, [&]()
+		{
+			feSphereGenerator::GeneratePacked(info, packed.data(), indices.data());
+		});
+
+		passed = Benchmark::Check(MatchesPacked(sphere.getPackedVertices(), packed), "packed sphere matches Sphere") && passed;
+
+		feLog::Info("Sphere {}x{} {}, {} vertices: Sphere {:.3f} ms, packed {:.3f} ms", size.sectors, size.stacks, size.smooth ? "smooth" : "flat", sphere.getInterleavedVertexCount(), sphereMs, spherePackedMs);
+		feLog::Info("Sphere {}x{} {}: generator {:.3f} ms, {} threads {:.3f} ms, packed {:.3f} ms", size.sectors, size.stacks, size.smooth ? "smooth" : "flat", generatorMs, threadPool.GetThreadCount() + 1, threadedMs, packedMs);
+	}
+
+	return passed;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include <vector>
+#include <utility>
+
+#include "engine/Log.h"
+#include "engine/renderer/MeshOptimizer.h"
+#include "engine/util/SphereGenerator.h"
+#include "engine/util/SphereMeshes.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr int Iterations = 10;
+	constexpr float MaxErrors[] = { 0.01f, 0.005f, 0.001f };
+
+	feSphereMesh GenerateUvSphere(int sectors)
+	{
+		feSphereGeneratorInfo info;
+		info.sectorCount = sectors;
+		info.stackCount = sectors / 2;
+
+		feSphereMesh mesh;
+		mesh.vertices.resize(feSphereGenerator::GetVertexCount(info) * 8);
+		mesh.indices.resize(feSphereGenerator::GetIndexCount(info));
+		feSphereGenerator::Generate(info, mesh.vertices.data(), mesh.indices.data());
+
+		return mesh;
+	}
+
+	// Logs the triangles and vertex shader invocations after optimisation, returns false if the mesh is not within maxError
+	bool Compare(const char* name, int level, float maxError, double milliseconds, feSphereMesh mesh)
+	{
+		feMeshOptimizerInfo info;
+		info.vertices = mesh.vertices.data();
+		info.vertexCount = mesh.GetVertexCount();
+		info.vertexSize = feSphereMesh::stride;
+		info.indices = mesh.indices.data();
+		info.indexCount = mesh.indices.size();
+
+		feMeshOptimizerStats stats;
+		feMeshOptimizer::Optimize(info, &stats);
+
+		float error = feSphereMeshes::MaxError(mesh.vertices.data(), 8, mesh.indices.data(), mesh.indices.size(), 1.0f);
+		feLog::Info("{} {} within {}: {} triangles, {} vertices, {} transforms, ACMR {:.3f}, error {:.5f}, {:.3f} ms", name, level, maxError, mesh.GetTriangleCount(), stats.vertexCountAfter, stats.after.transforms, stats.after.acmr, error, milliseconds);
+
+		return Benchmark::Check(error <= maxError, "sphere mesh is within its error");
+	}
+}
+
+// Tessellates the UV sphere, icosphere and cube sphere to the same errors and compares what each costs to draw and to
+// generate
+bool RunSphereMeshBenchmark()
+{
+	bool passed = true;
+
+	for (float maxError : MaxErrors)
+	{
+		int sectors = feSphereMeshes::UvSphereSectorsForError(1.0f, maxError);
+		int subdivisions = feSphereMeshes::IcosphereSubdivisionsForError(1.0f, maxError);
+		int segments = feSphereMeshes::CubeSphereSegmentsForError(1.0f, maxError);
+
+		double uvSphereMs = Benchmark::Measure(Iterations, [sectors]() { GenerateUvSphere(sectors); });
+		double icosphereMs = Benchmark::Measure(Iterations, [subdivisions]() { feSphereMeshes::Icosphere(1.0f, subdivisions); });
+		double cubeSphereMs = Benchmark::Measure(Iterations, [segments]() { feSphereMeshes::CubeSphere(1.0f, segments); });
+
+		passed = Compare("UV sphere, sectors", sectors, maxError, uvSphereMs, GenerateUvSphere(sectors)) && passed;
+		passed = Compare("Icosphere, subdivisions", subdivisions, maxError, icosphereMs, feSphereMeshes::Icosphere(1.0f, subdivisions)) && passed;
+		passed = Compare("Cube sphere, segments", segments, maxError, cubeSphereMs, feSphereMeshes::CubeSphere(1.0f, segments)) && passed;
+	}
+
+	return passed;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "engine/Log.h"
+#include "engine/math/Transform.h"
+#include "engine/math/TransformArray.h"
+#include "engine/util/ThreadPool.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr size_t TransformCount = 100000;
+	constexpr int Iterations = 20;
+
+	// feTransform goes through glm, which may group its sums differently than the array, so values only have to agree
+	// to a relative 1e-4
+	bool Matches(const std::vector<glm::mat4>& expected, const std::vector<glm::mat4>& matrices)
+	{
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					float value = expected[i][column][row];
+					if (std::abs(matrices[i][column][row] - value) > 1e-4f * std::fmax(1.0f, std::abs(value))) return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// The SSE2 path and the scalar tail of the array use the same expressions, so their results are compared exactly
+	bool MatchesExactly(const std::vector<glm::mat4>& expected, const std::vector<glm::mat4>& matrices)
+	{
+		return std::memcmp(expected.data(), matrices.data(), expected.size() * sizeof(glm::mat4)) == 0;
+	}
+}
+
+// Builds the world and view projection matrices of TransformCount random transforms one feTransform at a time, and
+// through feTransformArray on one thread, split across a thread pool and for a subset of indices. The array results
+// are checked against the per object ones, and the SSE2 path of the array against its scalar tail.
+bool RunTransformBenchmark()
+{
+	std::mt19937 random = std::mt19937(1);
+	std::uniform_real_distribution<float> distribution = std::uniform_real_distribution<float>(-2.0f, 2.0f);
+
+	std::vector<feTransform> transforms = std::vector<feTransform>(TransformCount);
+	feTransformArray array;
+	array.Reserve(TransformCount);
+
+	for (feTransform& transform : transforms)
+	{
+		transform.pos = glm::vec3(distribution(random), distribution(random), distribution(random)) * 50.0f;
+		transform.quat = glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random)));
+		transform.sca = glm::vec3(distribution(random), distribution(random), distribution(random));
+		array.Add(transform);
+	}
+
+	glm::mat4 viewProj = glm::perspective(1.2f, 16.0f / 9.0f, 0.1f, 1000.0f) * glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, -3.0f));
+
+	std::vector<glm::mat4> expected = std::vector<glm::mat4>(TransformCount);
+	std::vector<glm::mat4> expectedViewProj = std::vector<glm::mat4>(TransformCount);
+	std::vector<glm::mat4> matrices = std::vector<glm::mat4>(TransformCount);
+	feThreadPool threadPool;
+	bool passed = true;
+
+	double objectMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (size_t i = 0; i < TransformCount; ++i) expected[i] = transforms[i].GetMatrix();
+	});
+
+	double objectViewProjMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (size_t i = 0; i < TransformCount; ++i) expectedViewProj[i] = viewProj * transforms[i].GetMatrix();
+	});
+
+	double arrayMs = Benchmark::Measure(Iterations, [&]() { array.BuildMatrices(matrices.data()); });
+	passed = Benchmark::Check(Matches(expected, matrices), "transform array matrices match feTransform") && passed;
+
+	double arrayViewProjMs = Benchmark::Measure(Iterations, [&]() { array.BuildMatrices(matrices.data(), &viewProj); });
+	passed = Benchmark::Check(Matches(expectedViewProj, matrices), "transform array view projections match feTransform") && passed;
+
+	double threadedMs = Benchmark::Measure(Iterations, [&]() { array.BuildMatrices(matrices.data(), nullptr, &threadPool); });
+	passed = Benchmark::Check(Matches(expected, matrices), "threaded transform array matrices match feTransform") && passed;
+
+	// One transform at a time always takes the scalar tail
+	std::vector<glm::mat4> scalar = std::vector<glm::mat4>(TransformCount);
+	for (size_t i = 0; i < TransformCount; ++i) array.BuildMatrices(i, 1, &scalar[i]);
+	array.BuildMatrices(matrices.data());
+	passed = Benchmark::Check(MatchesExactly(matrices, scalar), "transform array SSE2 and scalar matrices are identical") && passed;
+
+	for (size_t i = 0; i < TransformCount; ++i) array.BuildMatrices(i, 1, &scalar[i], &viewProj);
+	array.BuildMatrices(matrices.data(), &viewProj);
+	passed = Benchmark::Check(MatchesExactly(matrices, scalar), "transform array SSE2 and scalar view projections are identical") && passed;
+
+	// A single transform rotates in the scalar tail, the full array four at a time
+	glm::quat spin = glm::angleAxis(0.3f, glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f)));
+	feTransformArray rotated = array;
+	rotated.RotateAll(spin);
+
+	bool rotationsMatch = true;
+	for (size_t i = 0; i < TransformCount; i += 97)
+	{
+		feTransformArray single;
+		single.Add(array.Get(i));
+		single.RotateAll(spin);
+		glm::quat expectedRotation = rotated.GetRotation(i);
+		glm::quat rotation = single.GetRotation(0);
+		rotationsMatch = rotationsMatch && std::memcmp(&expectedRotation, &rotation, sizeof(glm::quat)) == 0;
+	}
+
+	passed = Benchmark::Check(rotationsMatch, "transform array SSE2 and scalar rotations are identical") && passed;
+
+	// Every third transform from the back, like the visible instances of a frame grouped by level
+	std::vector<uint32_t> indices;
+	for (size_t i = TransformCount; i >= 3; i -= 3) indices.push_back(static_cast<uint32_t>(i - 3));
+
+	std::vector<glm::mat4> expectedGathered = std::vector<glm::mat4>(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i) expectedGathered[i] = expected[indices[i]];
+
+	std::vector<glm::mat4> gathered = std::vector<glm::mat4>(indices.size());
+	double gatherMs = Benchmark::Measure(Iterations, [&]() { array.BuildMatrices(indices, gathered.data(), nullptr, &threadPool); });
+	passed = Benchmark::Check(Matches(expectedGathered, gathered), "gathered transform array matrices match feTransform") && passed;
+
+	feLog::Info("Transforms, {} world matrices: feTransform {:.3f} ms, array {:.3f} ms, {} threads {:.3f} ms", TransformCount, objectMs, arrayMs, threadPool.GetThreadCount() + 1, threadedMs);
+	feLog::Info("Transforms, {} view projection matrices: feTransform {:.3f} ms, array {:.3f} ms", TransformCount, objectViewProjMs, arrayViewProjMs);
+	feLog::Info("Transforms, {} gathered world matrices: {} threads {:.3f} ms", indices.size(), threadPool.GetThreadCount() + 1, gatherMs);
+
+	return passed;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "engine/Log.h"
+#include "engine/renderer/Shader.h"
+#include "Benchmark.h"
+
+namespace
+{
+	constexpr int DrawCount = 100000;
+	constexpr int Iterations = 5;
+
+	const char* VertexSource = R"(#version 400 core
+uniform mat4 u_Model;
+uniform mat4 u_ViewProj;
+uniform float u_Time;
+layout(location = 0) in vec3 vert_Position;
+void main() { gl_Position = u_ViewProj * u_Model * vec4(vert_Position * (1.0 + u_Time), 1.0); }
+)";
+
+	const char* FragmentSource = R"(#version 400 core
+uniform vec3 u_Color;
+out vec4 frag_Color;
+void main() { frag_Color = vec4(u_Color, 1.0); }
+)";
+
+	// The lookup feProgram did before slots, the name is copied into a shared string for the map
+	class StringUniforms final
+	{
+	public:
+		StringUniforms(unsigned int program)
+		{
+			for (const char* name : { "u_Model", "u_ViewProj", "u_Time", "u_Color" }) m_Uniforms.emplace(name, glGetUniformLocation(program, name));
+		}
+
+		int GetUniformLocation(std::string_view name)
+		{
+			m_Temp = name;
+
+			auto result = m_Uniforms.find(m_Temp);
+			return result != m_Uniforms.end() ? result->second : -1;
+		}
+	private:
+		std::unordered_map<std::string, int> m_Uniforms;
+		std::string m_Temp = std::string(64, '!');
+	};
+}
+
+// Sets the uniforms of DrawCount draws three ways: by name through a string map as before slots, by hashed name every
+// call, and by slots resolved once. Every draw changes every value so the shadow copies never skip an upload.
+bool RunUniformBenchmark()
+{
+	std::string_view vertexSource = VertexSource;
+	std::string_view fragmentSource = FragmentSource;
+
+	feShaderCreateInfo shaderInfos[2];
+	shaderInfos[0].type = GL_VERTEX_SHADER;
+	shaderInfos[0].sources = &vertexSource;
+	shaderInfos[0].sourceCount = 1;
+	shaderInfos[1].type = GL_FRAGMENT_SHADER;
+	shaderInfos[1].sources = &fragmentSource;
+	shaderInfos[1].sourceCount = 1;
+
+	feShader shaders[2] = { feShader(shaderInfos[0]), feShader(shaderInfos[1]) };
+
+	feProgramCreateInfo programInfo;
+	programInfo.shaders = shaders;
+	programInfo.shaderCount = 2;
+	programInfo.debugName = "Uniform benchmark";
+
+	feProgram program = programInfo;
+	if (!Benchmark::Check(program.IsLinked(), "uniform benchmark program links")) return false;
+
+	program.Bind();
+
+	StringUniforms strings = StringUniforms(program.GetHandle());
+	glm::mat4 viewProj = glm::mat4(1.0f);
+
+	double stringMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (int i = 0; i < DrawCount; ++i)
+		{
+			float value = static_cast<float>(i);
+			glUniformMatrix4fv(strings.GetUniformLocation("u_ViewProj"), 1, GL_FALSE, glm::value_ptr(glm::mat4(value + 1.0f)));
+			glUniformMatrix4fv(strings.GetUniformLocation("u_Model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(value)));
+			glUniform1f(strings.GetUniformLocation("u_Time"), value);
+			glUniform3fv(strings.GetUniformLocation("u_Color"), 1, glm::value_ptr(glm::vec3(value)));
+		}
+	});
+
+	double hashedMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (int i = 0; i < DrawCount; ++i)
+		{
+			float value = static_cast<float>(i);
+			program.UniformMat4f(program.GetUniformSlot("u_ViewProj"_uniform), glm::mat4(value + 1.0f));
+			program.UniformMat4f(program.GetUniformSlot("u_Model"_uniform), glm::mat4(value));
+			program.Uniform1f(program.GetUniformSlot("u_Time"_uniform), value);
+			program.Uniform3f(program.GetUniformSlot("u_Color"_uniform), glm::vec3(value));
+		}
+	});
+
+	feUniformSlot viewProjSlot = program.GetUniformSlot("u_ViewProj"_uniform);
+	feUniformSlot modelSlot = program.GetUniformSlot("u_Model"_uniform);
+	feUniformSlot timeSlot = program.GetUniformSlot("u_Time"_uniform);
+	feUniformSlot colorSlot = program.GetUniformSlot("u_Color"_uniform);
+
+	double slotMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (int i = 0; i < DrawCount; ++i)
+		{
+			float value = static_cast<float>(i);
+			program.UniformMat4f(viewProjSlot, glm::mat4(value + 1.0f));
+			program.UniformMat4f(modelSlot, glm::mat4(value));
+			program.Uniform1f(timeSlot, value);
+			program.Uniform3f(colorSlot, glm::vec3(value));
+		}
+	});
+
+	// The view projection stays the same for a whole frame, so this is the common case of most uploads being skipped
+	double skippedMs = Benchmark::Measure(Iterations, [&]()
+	{
+		for (int i = 0; i < DrawCount; ++i)
+		{
+			program.UniformMat4f(viewProjSlot, viewProj);
+			program.Uniform3f(colorSlot, glm::vec3(1.0f));
+		}
+	});
+
+	glFinish();
+
+	feLog::Info("Uniforms, {} draws of 4: string map {:.3f} ms, hashed name {:.3f} ms, slot {:.3f} ms", DrawCount, stringMs, hashedMs, slotMs);
+	feLog::Info("Uniforms, {} draws of 2 unchanged values through slots: {:.3f} ms", DrawCount, skippedMs);
+
+	bool passed = true;
+	for (feUniformSlot slot : { viewProjSlot, modelSlot, timeSlot, colorSlot })
+	{
+		passed = Benchmark::Check(program.GetUniformLocation(slot) >= 0, "every benchmark uniform has a slot") && passed;
+	}
+
+	return passed;
+}
\ No newline at end of file
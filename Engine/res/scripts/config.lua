@@ -1,2 +1,7 @@
 windowWidth = 1280
-windowHeight = 720
\ No newline at end of file
+windowHeight = 720
+programCache = true
+instanceCount = 100000
+depthPrepass = false
+planet = false
+occlusionCulling = true
\ No newline at end of file
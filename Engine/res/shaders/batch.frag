@@ -0,0 +1,12 @@
+#version 430 core
+
+in vec3 frag_Normal;
+flat in vec4 frag_Color;
+
+layout (location = 0) out vec4 out_Color;
+
+void main(void)
+{
+	float brightness = max(dot(vec3(0.0, 0.0, 1.0), normalize(frag_Normal)), 0.2);
+	out_Color = vec4(frag_Color.rgb * brightness, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+
+layout (location = 0) in vec3 vert_Position;
+layout (location = 1) in vec3 vert_Normal;
+layout (location = 2) in vec2 vert_TexCoord;
+
+out vec3 frag_Normal;
+flat out vec4 frag_Color;
+
+#include "include/camera.glsl"
+
+struct feBatchDrawData
+{
+	mat4 model;
+	vec4 color;
+};
+
+// Bound by feBatchRenderer, the base instance of every command is the index of its record
+layout (std430, binding = 0) readonly buffer fe_BatchDraws
+{
+	feBatchDrawData fe_Draws[];
+};
+
+void main(void)
+{
+	feBatchDrawData draw = fe_Draws[gl_BaseInstanceARB];
+
+	gl_Position = u_ViewProj * draw.model * vec4(vert_Position, 1.0);
+	frag_Normal = transpose(inverse(mat3(draw.model))) * vert_Normal;
+	frag_Color = draw.color;
+}
\ No newline at end of file
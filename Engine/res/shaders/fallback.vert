@@ -0,0 +1,23 @@
+#version 400 core
+
+layout (location = 0) in vec3 vert_Position;
+
+#include "include/camera.glsl"
+
+// The depth prepass and the shading pass must produce identical depths
+invariant gl_Position;
+
+#ifdef FE_INSTANCED
+layout (location = 3) in mat4 vert_Model;
+#else
+uniform mat4 u_Model;
+#endif
+
+void main(void)
+{
+#ifdef FE_INSTANCED
+	gl_Position = u_ViewProj * vert_Model * vec4(vert_Position, 1.0);
+#else
+	gl_Position = u_ViewProj * u_Model * vec4(vert_Position, 1.0);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+layout (std140) uniform fe_Camera
+{
+	mat4 u_View;
+	mat4 u_Proj;
+	mat4 u_ViewProj;
+	vec4 u_CameraPosition;
+};
\ No newline at end of file
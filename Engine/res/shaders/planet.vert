@@ -0,0 +1,18 @@
+#version 400 core
+
+layout (location = 0) in vec3 vert_Position;
+layout (location = 1) in vec3 vert_Normal;
+
+out vec3 frag_Normal;
+
+#include "include/camera.glsl"
+
+// Patch origin minus the camera position, computed in double on the CPU
+uniform vec3 u_PatchOffset;
+
+void main(void)
+{
+	// Camera relative, the translation of u_View would lose the precision the offset keeps
+	gl_Position = u_Proj * vec4(mat3(u_View) * (vert_Position + u_PatchOffset), 1.0);
+	frag_Normal = vert_Normal;
+}
\ No newline at end of file
@@ -6,12 +6,25 @@ layout (location = 2) in vec2 vert_TexCoord;
 
 out vec3 frag_Normal;
 
+#include "include/camera.glsl"
+
+// The depth prepass and the shading pass must produce identical depths
+invariant gl_Position;
+
+#ifdef FE_INSTANCED
+layout (location = 3) in mat4 vert_Model;
+#else
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Proj;
+#endif
 
 void main(void)
 {
-	gl_Position = u_Proj * u_View * u_Model * vec4(vert_Position, 1.0);
-	frag_Normal = transpose(inverse(mat3(u_Model))) * vert_Normal;
+#ifdef FE_INSTANCED
+	mat4 model = vert_Model;
+#else
+	mat4 model = u_Model;
+#endif
+
+	gl_Position = u_ViewProj * model * vec4(vert_Position, 1.0);
+	frag_Normal = transpose(inverse(mat3(model))) * vert_Normal;
 }
\ No newline at end of file
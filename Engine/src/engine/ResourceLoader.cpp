@@ -2,6 +2,8 @@
 
 #include <fstream>
 
+#include "Log.h"
+
 namespace feResourceLoader
 {
 	std::optional<std::string> LoadTextFile(std::string_view filename)
@@ -17,9 +19,19 @@ namespace feResourceLoader
 
 		if (fp)
 		{
-			std::string contents;
 			std::fseek(fp, 0, SEEK_END);
-			contents.resize(std::ftell(fp));
+			long size = std::ftell(fp);
+
+			// A negative size would wrap around to a huge allocation
+			if (size < 0)
+			{
+				feLog::Error("Failed to get the size of {}", filename);
+				std::fclose(fp);
+				return {};
+			}
+
+			std::string contents;
+			contents.resize(static_cast<size_t>(size));
 			std::rewind(fp);
 			std::fread(&contents[0], 1, contents.size(), fp);
 			std::fclose(fp);
@@ -28,4 +40,59 @@ namespace feResourceLoader
 
 		return {};
 	}
+
+	std::optional<std::vector<unsigned char>> LoadBinaryFile(std::string_view filename)
+	{
+		std::FILE* fp;
+
+#if defined(FE_PLAT_WINDOWS)
+		errno_t error = fopen_s(&fp, filename.data(), "rb");
+		if (error != 0) return {};
+#else
+		fp = fopen(filename.data(), "rb");
+#endif
+
+		if (fp)
+		{
+			std::fseek(fp, 0, SEEK_END);
+			long size = std::ftell(fp);
+
+			if (size < 0)
+			{
+				feLog::Error("Failed to get the size of {}", filename);
+				std::fclose(fp);
+				return {};
+			}
+
+			std::vector<unsigned char> contents;
+			contents.resize(static_cast<size_t>(size));
+			std::rewind(fp);
+			std::fread(contents.data(), 1, contents.size(), fp);
+			std::fclose(fp);
+			return contents;
+		}
+
+		return {};
+	}
+
+	bool WriteBinaryFile(std::string_view filename, const void* data, size_t size)
+	{
+		std::FILE* fp;
+
+#if defined(FE_PLAT_WINDOWS)
+		errno_t error = fopen_s(&fp, filename.data(), "wb");
+		if (error != 0) return false;
+#else
+		fp = fopen(filename.data(), "wb");
+#endif
+
+		if (fp)
+		{
+			size_t written = std::fwrite(data, 1, size, fp);
+			std::fclose(fp);
+			return written == size;
+		}
+
+		return false;
+	}
 }
\ No newline at end of file
@@ -3,8 +3,11 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace feResourceLoader
 {
 	std::optional<std::string> LoadTextFile(std::string_view filename);
+	std::optional<std::vector<unsigned char>> LoadBinaryFile(std::string_view filename);
+	bool WriteBinaryFile(std::string_view filename, const void* data, size_t size);
 }
\ No newline at end of file
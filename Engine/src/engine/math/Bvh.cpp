@@ -0,0 +1,683 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "../Log.h"
+
+namespace
+{
+	constexpr int MaxBinCount = 32;
+	// Past this depth nodes are split at the median, which bounds the depth of the tree and the traversal stacks
+	constexpr int MaxSahDepth = 48;
+	constexpr int StackSize = 256;
+	constexpr uint32_t NoNode = UINT32_MAX;
+
+	struct BuildNode final
+	{
+		feAabb bounds;
+		uint32_t begin = 0;
+		uint32_t count = 0;
+		// NoNode for leaves
+		uint32_t left = NoNode;
+		uint32_t right = NoNode;
+	};
+
+	// Partitioned in place instead of through indices, so every pass over a node reads memory in order
+	struct BuildPrimitive final
+	{
+		feAabb bounds;
+		glm::vec3 center;
+		uint32_t index;
+	};
+
+	struct Builder final
+	{
+		std::vector<BuildPrimitive> primitives;
+		std::vector<BuildNode> nodes;
+		size_t maxLeafSize = 4;
+		int binCount = 16;
+
+		uint32_t Build(uint32_t begin, uint32_t count, int depth)
+		{
+			BuildPrimitive* first = primitives.data() + begin;
+
+			BuildNode node;
+			node.begin = begin;
+			node.count = count;
+
+			feAabb centerBounds;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				node.bounds.Grow(first[i].bounds);
+				centerBounds.Grow(first[i].center);
+			}
+
+			uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+			nodes.push_back(node);
+
+			if (count <= maxLeafSize) return nodeIndex;
+
+			BuildPrimitive* middle = nullptr;
+			glm::vec3 extent = centerBounds.max - centerBounds.min;
+
+			if (depth < MaxSahDepth) middle = PartitionSah(first, count, centerBounds, extent);
+
+			// Too deep, or every split leaves one side empty because the centers coincide
+			if (!middle)
+			{
+				int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+				middle = first + count / 2;
+				std::nth_element(first, middle, first + count, [axis](const BuildPrimitive& a, const BuildPrimitive& b) { return a.center[axis] < b.center[axis]; });
+			}
+
+			uint32_t leftCount = static_cast<uint32_t>(middle - first);
+			uint32_t left = Build(begin, leftCount, depth + 1);
+			uint32_t right = Build(begin + leftCount, count - leftCount, depth + 1);
+
+			nodes[nodeIndex].left = left;
+			nodes[nodeIndex].right = right;
+			return nodeIndex;
+		}
+
+		// Returns the split point of the cheapest binned split over all three axes, or null if none splits
+		BuildPrimitive* PartitionSah(BuildPrimitive* first, uint32_t count, const feAabb& centerBounds, const glm::vec3& extent)
+		{
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			int bestBin = 0;
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (extent[axis] <= 0.0f) continue;
+
+				feAabb binBounds[MaxBinCount];
+				uint32_t binCounts[MaxBinCount] = {};
+				float scale = binCount / extent[axis];
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					int bin = std::min(binCount - 1, static_cast<int>((first[i].center[axis] - centerBounds.min[axis]) * scale));
+					binBounds[bin].Grow(first[i].bounds);
+					++binCounts[bin];
+				}
+
+				// Sweep from the right for the cost of everything after each split
+				float rightAreas[MaxBinCount];
+				uint32_t rightCounts[MaxBinCount];
+				feAabb right;
+				uint32_t rightCount = 0;
+				for (int bin = binCount - 1; bin > 0; --bin)
+				{
+					right.Grow(binBounds[bin]);
+					rightCount += binCounts[bin];
+					rightAreas[bin] = right.GetSurfaceArea();
+					rightCounts[bin] = rightCount;
+				}
+
+				feAabb left;
+				uint32_t leftCount = 0;
+				for (int bin = 0; bin < binCount - 1; ++bin)
+				{
+					left.Grow(binBounds[bin]);
+					leftCount += binCounts[bin];
+					if (leftCount == 0 || rightCounts[bin + 1] == 0) continue;
+
+					float cost = left.GetSurfaceArea() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = bin;
+					}
+				}
+			}
+
+			if (bestAxis < 0) return nullptr;
+
+			float scale = binCount / extent[bestAxis];
+			float minimum = centerBounds.min[bestAxis];
+			BuildPrimitive* middle = std::partition(first, first + count, [&](const BuildPrimitive& primitive)
+			{
+				return std::min(binCount - 1, static_cast<int>((primitive.center[bestAxis] - minimum) * scale)) <= bestBin;
+			});
+
+			return middle == first || middle == first + count ? nullptr : middle;
+		}
+	};
+
+	int ValidMask(const int32_t children[4])
+	{
+		return (children[0] >= 0 ? 1 : 0) | (children[1] >= 0 ? 2 : 0) | (children[2] >= 0 ? 4 : 0) | (children[3] >= 0 ? 8 : 0);
+	}
+
+	bool Overlaps(const feAabb& a, const feAabb& b)
+	{
+		return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	float DistanceSquared(const feAabb& box, const glm::vec3& point)
+	{
+		glm::vec3 offset = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+		return glm::dot(offset, offset);
+	}
+}
+
+feBvh::feBvh(const feBvhCreateInfo& info)
+{
+	if (!info.bounds || info.count == 0)
+	{
+		feLog::Error("Bvh needs at least one primitive");
+		return;
+	}
+
+	if (info.count >= static_cast<size_t>(INT32_MAX))
+	{
+		feLog::Error("Bvh supports at most {} primitives, got {}", INT32_MAX - 1, info.count);
+		return;
+	}
+
+	m_Bounds.assign(info.bounds, info.bounds + info.count);
+
+	Builder builder;
+	builder.maxLeafSize = std::max<size_t>(info.maxLeafSize, 1);
+	builder.binCount = std::clamp(info.binCount, 2, MaxBinCount);
+	builder.primitives.resize(info.count);
+	for (size_t i = 0; i < info.count; ++i) builder.primitives[i] = { info.bounds[i], info.bounds[i].GetCenter(), static_cast<uint32_t>(i) };
+
+	builder.nodes.reserve(info.count * 2 / builder.maxLeafSize + 1);
+	builder.Build(0, static_cast<uint32_t>(info.count), 0);
+
+	m_Indices.resize(info.count);
+	for (size_t i = 0; i < info.count; ++i) m_Indices[i] = builder.primitives[i].index;
+
+	m_PrimitiveNodes.resize(info.count);
+	m_Nodes.reserve(builder.nodes.size() / 3 + 1);
+	m_NodeParents.reserve(builder.nodes.size() / 3 + 1);
+
+	// Every node takes up to four descendants of its binary node, always opening the largest inner one
+	std::function<uint32_t(uint32_t, uint32_t)> emit = [&](uint32_t buildIndex, uint32_t parent) -> uint32_t
+	{
+		uint32_t nodeIndex = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.emplace_back();
+		m_NodeParents.push_back(parent);
+
+		uint32_t slots[4];
+		int slotCount = 0;
+
+		const BuildNode& buildNode = builder.nodes[buildIndex];
+		if (buildNode.left == NoNode) slots[slotCount++] = buildIndex;
+		else
+		{
+			slots[slotCount++] = buildNode.left;
+			slots[slotCount++] = buildNode.right;
+		}
+
+		while (slotCount < 4)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (int slot = 0; slot < slotCount; ++slot)
+			{
+				const BuildNode& child = builder.nodes[slots[slot]];
+				if (child.left != NoNode && child.bounds.GetSurfaceArea() > largestArea)
+				{
+					largest = slot;
+					largestArea = child.bounds.GetSurfaceArea();
+				}
+			}
+
+			if (largest < 0) break;
+
+			const BuildNode& opened = builder.nodes[slots[largest]];
+			slots[largest] = opened.left;
+			slots[slotCount++] = opened.right;
+		}
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			feAabb slotBounds;
+			int32_t child = -1;
+			uint32_t count = 0;
+
+			if (slot < slotCount)
+			{
+				const BuildNode& buildChild = builder.nodes[slots[slot]];
+				slotBounds = buildChild.bounds;
+
+				if (buildChild.left == NoNode)
+				{
+					child = static_cast<int32_t>(buildChild.begin);
+					count = buildChild.count;
+					for (uint32_t i = 0; i < count; ++i) m_PrimitiveNodes[m_Indices[buildChild.begin + i]] = nodeIndex;
+				}
+				else child = static_cast<int32_t>(emit(slots[slot], nodeIndex));
+			}
+
+			// Looked up again, emit may have grown m_Nodes
+			feBvhNode& node = m_Nodes[nodeIndex];
+			node.minX[slot] = slotBounds.min.x;
+			node.minY[slot] = slotBounds.min.y;
+			node.minZ[slot] = slotBounds.min.z;
+			node.maxX[slot] = slotBounds.max.x;
+			node.maxY[slot] = slotBounds.max.y;
+			node.maxZ[slot] = slotBounds.max.z;
+			node.children[slot] = child;
+			node.counts[slot] = count;
+		}
+
+		return nodeIndex;
+	};
+
+	emit(0, NoNode);
+
+	m_Dirty.assign(m_Nodes.size(), 0);
+	m_RootBounds = builder.nodes[0].bounds;
+}
+
+void feBvh::Refit(const feAabb* bounds)
+{
+	if (!IsValid()) return;
+
+	m_Bounds.assign(bounds, bounds + m_Bounds.size());
+
+	// Children come after their parents, going backwards finishes every child first
+	for (size_t node = m_Nodes.size(); node > 0; --node) RefitNode(static_cast<uint32_t>(node - 1));
+}
+
+void feBvh::Refit(const feAabb* bounds, const uint32_t* changed, size_t changedCount)
+{
+	if (!IsValid()) return;
+
+	size_t firstDirty = m_Nodes.size();
+
+	for (size_t i = 0; i < changedCount; ++i)
+	{
+		uint32_t primitive = changed[i];
+		m_Bounds[primitive] = bounds[primitive];
+
+		// Stops at the first node another primitive already marked, the rest of the path is marked too
+		for (uint32_t node = m_PrimitiveNodes[primitive]; node != NoNode && !m_Dirty[node]; node = m_NodeParents[node])
+		{
+			m_Dirty[node] = 1;
+			firstDirty = std::min<size_t>(firstDirty, node);
+		}
+	}
+
+	for (size_t node = m_Nodes.size(); node > firstDirty; --node)
+	{
+		if (!m_Dirty[node - 1]) continue;
+
+		RefitNode(static_cast<uint32_t>(node - 1));
+		m_Dirty[node - 1] = 0;
+	}
+}
+
+void feBvh::QueryFrustum(const feFrustum& frustum, std::vector<uint32_t>& out) const
+{
+	if (!IsValid()) return;
+
+	uint32_t stack[StackSize];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const feBvhNode& node = m_Nodes[stack[--top]];
+
+		// A child stays in while it is not fully behind any plane and counts as inside while fully in front of all
+		int intersects = ValidMask(node.children);
+		int inside = intersects;
+
+#ifdef FE_BVH_SSE
+		__m128 minX = _mm_load_ps(node.minX), minY = _mm_load_ps(node.minY), minZ = _mm_load_ps(node.minZ);
+		__m128 maxX = _mm_load_ps(node.maxX), maxY = _mm_load_ps(node.maxY), maxZ = _mm_load_ps(node.maxZ);
+
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			__m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y), c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+
+			// The corner furthest along the normal decides if the box is outside, the nearest one if it is inside
+			__m128 farthest = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, plane.x >= 0.0f ? maxX : minX), _mm_mul_ps(b, plane.y >= 0.0f ? maxY : minY)), _mm_add_ps(_mm_mul_ps(c, plane.z >= 0.0f ? maxZ : minZ), d));
+			__m128 nearest = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, plane.x >= 0.0f ? minX : maxX), _mm_mul_ps(b, plane.y >= 0.0f ? minY : maxY)), _mm_add_ps(_mm_mul_ps(c, plane.z >= 0.0f ? minZ : maxZ), d));
+
+			intersects &= _mm_movemask_ps(_mm_cmpge_ps(farthest, _mm_setzero_ps()));
+			inside &= _mm_movemask_ps(_mm_cmpge_ps(nearest, _mm_setzero_ps()));
+		}
+#else
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (!(intersects & (1 << slot))) continue;
+
+			feAabb box = { { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } };
+			if (!frustum.IntersectsAabb(box.min, box.max))
+			{
+				intersects &= ~(1 << slot);
+				continue;
+			}
+
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				glm::vec3 nearest = glm::vec3(plane.x >= 0.0f ? box.min.x : box.max.x, plane.y >= 0.0f ? box.min.y : box.max.y, plane.z >= 0.0f ? box.min.z : box.max.z);
+				if (glm::dot(glm::vec3(plane), nearest) + plane.w < 0.0f) inside &= ~(1 << slot);
+			}
+		}
+#endif
+
+		inside &= intersects;
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (!(intersects & (1 << slot))) continue;
+
+			bool fullyInside = (inside & (1 << slot)) != 0;
+
+			if (node.counts[slot] > 0 && fullyInside) AppendLeaf(node, slot, out);
+			else if (node.counts[slot] > 0)
+			{
+				const uint32_t* first = m_Indices.data() + node.children[slot];
+				for (uint32_t i = 0; i < node.counts[slot]; ++i)
+				{
+					const feAabb& box = m_Bounds[first[i]];
+					if (frustum.IntersectsAabb(box.min, box.max)) out.push_back(first[i]);
+				}
+			}
+			else if (fullyInside) AppendSubtree(static_cast<uint32_t>(node.children[slot]), out);
+			else stack[top++] = static_cast<uint32_t>(node.children[slot]);
+		}
+	}
+}
+
+void feBvh::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const
+{
+	if (!IsValid()) return;
+
+	float radiusSquared = radius * radius;
+
+	uint32_t stack[StackSize];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const feBvhNode& node = m_Nodes[stack[--top]];
+		int mask = ValidMask(node.children);
+
+#ifdef FE_BVH_SSE
+		__m128 zero = _mm_setzero_ps();
+		__m128 x = _mm_set1_ps(center.x), y = _mm_set1_ps(center.y), z = _mm_set1_ps(center.z);
+
+		// Distance from the center to the nearest point of every box
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minX), x), _mm_sub_ps(x, _mm_load_ps(node.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minY), y), _mm_sub_ps(y, _mm_load_ps(node.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minZ), z), _mm_sub_ps(z, _mm_load_ps(node.maxZ))), zero);
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		mask &= _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(radiusSquared)));
+#else
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			feAabb box = { { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } };
+			if (DistanceSquared(box, center) > radiusSquared) mask &= ~(1 << slot);
+		}
+#endif
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (!(mask & (1 << slot))) continue;
+
+			if (node.counts[slot] > 0)
+			{
+				const uint32_t* first = m_Indices.data() + node.children[slot];
+				for (uint32_t i = 0; i < node.counts[slot]; ++i)
+				{
+					if (DistanceSquared(m_Bounds[first[i]], center) <= radiusSquared) out.push_back(first[i]);
+				}
+			}
+			else stack[top++] = static_cast<uint32_t>(node.children[slot]);
+		}
+	}
+}
+
+void feBvh::QueryAabb(const feAabb& box, std::vector<uint32_t>& out) const
+{
+	if (!IsValid()) return;
+
+	uint32_t stack[StackSize];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const feBvhNode& node = m_Nodes[stack[--top]];
+		int mask = ValidMask(node.children);
+
+#ifdef FE_BVH_SSE
+		__m128 overlapX = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(box.max.x)), _mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(box.min.x)));
+		__m128 overlapY = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(box.max.y)), _mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(box.min.y)));
+		__m128 overlapZ = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minZ), _mm_set1_ps(box.max.z)), _mm_cmpge_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(box.min.z)));
+
+		mask &= _mm_movemask_ps(_mm_and_ps(_mm_and_ps(overlapX, overlapY), overlapZ));
+#else
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			feAabb slotBox = { { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } };
+			if (!Overlaps(slotBox, box)) mask &= ~(1 << slot);
+		}
+#endif
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (!(mask & (1 << slot))) continue;
+
+			if (node.counts[slot] > 0)
+			{
+				const uint32_t* first = m_Indices.data() + node.children[slot];
+				for (uint32_t i = 0; i < node.counts[slot]; ++i)
+				{
+					if (Overlaps(m_Bounds[first[i]], box)) out.push_back(first[i]);
+				}
+			}
+			else stack[top++] = static_cast<uint32_t>(node.children[slot]);
+		}
+	}
+}
+
+bool feBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const feBvhIntersector& intersect, feBvhRayHit& hit, bool anyHit) const
+{
+	hit = feBvhRayHit();
+	if (!IsValid()) return false;
+
+	hit.distance = maxDistance;
+
+	// Division by zero gives infinities, which the slab test handles
+	glm::vec3 inverse = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	uint32_t stack[StackSize];
+	float stackDistances[StackSize];
+	int top = 0;
+	stack[top] = 0;
+	stackDistances[top++] = 0.0f;
+
+	while (top > 0)
+	{
+		--top;
+		// Something closer was found after this node was pushed
+		if (stackDistances[top] > hit.distance) continue;
+
+		const feBvhNode& node = m_Nodes[stack[top]];
+		int mask = ValidMask(node.children);
+		alignas(16) float entries[4];
+
+#ifdef FE_BVH_SSE
+		__m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+		__m128 ix = _mm_set1_ps(inverse.x), iy = _mm_set1_ps(inverse.y), iz = _mm_set1_ps(inverse.z);
+
+		__m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix), x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+		__m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy), y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+		__m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz), z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+
+		__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+		__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(hit.distance)));
+
+		mask &= _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+		_mm_store_ps(entries, entry);
+#else
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			glm::vec3 t0 = (glm::vec3(node.minX[slot], node.minY[slot], node.minZ[slot]) - origin) * inverse;
+			glm::vec3 t1 = (glm::vec3(node.maxX[slot], node.maxY[slot], node.maxZ[slot]) - origin) * inverse;
+			glm::vec3 entry = glm::min(t0, t1);
+			glm::vec3 exit = glm::max(t0, t1);
+
+			entries[slot] = std::max(std::max(entry.x, entry.y), std::max(entry.z, 0.0f));
+			float exitDistance = std::min(std::min(exit.x, exit.y), std::min(exit.z, hit.distance));
+			if (!(entries[slot] <= exitDistance)) mask &= ~(1 << slot);
+		}
+#endif
+
+		// Inner children are pushed farthest first, so the nearest is visited next
+		uint32_t inner[4];
+		int innerCount = 0;
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (!(mask & (1 << slot))) continue;
+
+			if (node.counts[slot] == 0)
+			{
+				inner[innerCount++] = static_cast<uint32_t>(slot);
+				continue;
+			}
+
+			const uint32_t* first = m_Indices.data() + node.children[slot];
+			for (uint32_t i = 0; i < node.counts[slot]; ++i)
+			{
+				float distance = intersect(first[i]);
+				if (distance < 0.0f || distance > hit.distance) continue;
+
+				hit.index = first[i];
+				hit.distance = distance;
+				if (anyHit) return true;
+			}
+		}
+
+		std::sort(inner, inner + innerCount, [&entries](uint32_t a, uint32_t b) { return entries[a] > entries[b]; });
+
+		for (int i = 0; i < innerCount; ++i)
+		{
+			stack[top] = static_cast<uint32_t>(node.children[inner[i]]);
+			stackDistances[top++] = entries[inner[i]];
+		}
+	}
+
+	return hit.index != UINT32_MAX;
+}
+
+float feBvh::IntersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius)
+{
+	glm::vec3 offset = origin - center;
+
+	float a = glm::dot(direction, direction);
+	float b = glm::dot(offset, direction);
+	float c = glm::dot(offset, offset) - radius * radius;
+
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f || a == 0.0f) return -1.0f;
+
+	return (-b - std::sqrt(discriminant)) / a;
+}
+
+bool feBvh::IsValid() const
+{
+	return !m_Nodes.empty();
+}
+
+size_t feBvh::GetNodeCount() const
+{
+	return m_Nodes.size();
+}
+
+size_t feBvh::GetPrimitiveCount() const
+{
+	return m_Bounds.size();
+}
+
+const feAabb& feBvh::GetBounds() const
+{
+	return m_RootBounds;
+}
+
+void feBvh::RefitNode(uint32_t nodeIndex)
+{
+	feBvhNode& node = m_Nodes[nodeIndex];
+
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		if (node.children[slot] < 0) continue;
+
+		feAabb slotBounds;
+
+		if (node.counts[slot] > 0)
+		{
+			const uint32_t* first = m_Indices.data() + node.children[slot];
+			for (uint32_t i = 0; i < node.counts[slot]; ++i) slotBounds.Grow(m_Bounds[first[i]]);
+		}
+		else
+		{
+			// Empty slots of the child have inverted bounds and do not grow it
+			const feBvhNode& child = m_Nodes[node.children[slot]];
+			for (int childSlot = 0; childSlot < 4; ++childSlot)
+			{
+				slotBounds.Grow(feAabb{ { child.minX[childSlot], child.minY[childSlot], child.minZ[childSlot] }, { child.maxX[childSlot], child.maxY[childSlot], child.maxZ[childSlot] } });
+			}
+		}
+
+		node.minX[slot] = slotBounds.min.x;
+		node.minY[slot] = slotBounds.min.y;
+		node.minZ[slot] = slotBounds.min.z;
+		node.maxX[slot] = slotBounds.max.x;
+		node.maxY[slot] = slotBounds.max.y;
+		node.maxZ[slot] = slotBounds.max.z;
+	}
+
+	if (nodeIndex == 0)
+	{
+		m_RootBounds = feAabb();
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			m_RootBounds.Grow(feAabb{ { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } });
+		}
+	}
+}
+
+void feBvh::AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& out) const
+{
+	uint32_t stack[StackSize];
+	int top = 0;
+	stack[top++] = nodeIndex;
+
+	while (top > 0)
+	{
+		const feBvhNode& node = m_Nodes[stack[--top]];
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			if (node.children[slot] < 0) continue;
+
+			if (node.counts[slot] > 0) AppendLeaf(node, slot, out);
+			else stack[top++] = static_cast<uint32_t>(node.children[slot]);
+		}
+	}
+}
+
+void feBvh::AppendLeaf(const feBvhNode& node, int slot, std::vector<uint32_t>& out) const
+{
+	const uint32_t* first = m_Indices.data() + node.children[slot];
+	out.insert(out.end(), first, first + node.counts[slot]);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+struct feAabb final
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	static feAabb FromSphere(const glm::vec3& center, float radius) { return { center - glm::vec3(radius), center + glm::vec3(radius) }; }
+
+	void Grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	void Grow(const feAabb& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+
+	[[nodiscard]] bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	[[nodiscard]] glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+	[[nodiscard]] float GetSurfaceArea() const
+	{
+		glm::vec3 size = max - min;
+		return IsEmpty() ? 0.0f : 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+};
+
+struct feBvhCreateInfo final
+{
+	// One box per primitive, query results are indices into it
+	const feAabb* bounds = nullptr;
+	size_t count = 0;
+	// Nodes with this many primitives or fewer are not split
+	size_t maxLeafSize = 4;
+	// Candidate split planes per axis are the borders between bins of primitive centers
+	int binCount = 16;
+};
+
+struct feBvhRayHit final
+{
+	uint32_t index = UINT32_MAX;
+	float distance = FLT_MAX;
+};
+
+// Returns the distance along the ray to primitive index, or a negative value if the ray misses it
+using feBvhIntersector = std::function<float(uint32_t index)>;
+
+// Bounding volume hierarchy over boxes, built with the surface area heuristic and flattened into nodes of four
+// children each, so one SSE2 test covers a whole node. Moving primitives are handled by refitting the boxes, which
+// keeps the tree valid but loosens it, rebuild when queries slow down.
+class feBvh final
+{
+public:
+	feBvh() = default;
+	feBvh(const feBvhCreateInfo& info);
+
+	// bounds has the count and order the tree was built with
+	void Refit(const feAabb* bounds);
+	// Only updates the nodes above the primitives in changed
+	void Refit(const feAabb* bounds, const uint32_t* changed, size_t changedCount);
+
+	// Query results are appended to out in no particular order
+	void QueryFrustum(const feFrustum& frustum, std::vector<uint32_t>& out) const;
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+	void QueryAabb(const feAabb& box, std::vector<uint32_t>& out) const;
+
+	// Closest primitive intersect reports a hit for within maxDistance, distances are in multiples of direction.
+	// anyHit stops at the first hit, enough for line of sight checks.
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const feBvhIntersector& intersect, feBvhRayHit& hit, bool anyHit = false) const;
+
+	// Distance along the ray to the sphere, negative if the ray misses it or starts inside
+	static float IntersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius);
+
+	[[nodiscard]] bool IsValid() const;
+	[[nodiscard]] size_t GetNodeCount() const;
+	[[nodiscard]] size_t GetPrimitiveCount() const;
+	[[nodiscard]] const feAabb& GetBounds() const;
+private:
+	// Four children as structure of arrays. A child is a leaf when its count is above 0, children holds the first of
+	// its primitives in m_Indices then. Otherwise it is the index of an inner node, or -1 for an empty slot.
+	struct alignas(16) feBvhNode final
+	{
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		int32_t children[4];
+		uint32_t counts[4];
+	};
+
+	void RefitNode(uint32_t node);
+	void AppendSubtree(uint32_t node, std::vector<uint32_t>& out) const;
+	void AppendLeaf(const feBvhNode& node, int slot, std::vector<uint32_t>& out) const;
+private:
+	// Children always come after their parent
+	std::vector<feBvhNode> m_Nodes;
+	std::vector<uint32_t> m_NodeParents;
+	// Primitive indices, every leaf owns a range
+	std::vector<uint32_t> m_Indices;
+	std::vector<feAabb> m_Bounds;
+	// Node whose leaf holds each primitive
+	std::vector<uint32_t> m_PrimitiveNodes;
+	std::vector<uint8_t> m_Dirty;
+	feAabb m_RootBounds;
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "Frustum.h"
+
+feFrustum feFrustum::FromMatrix(const glm::mat4& viewProj)
+{
+	// Gribb and Hartmann, every plane is the last row plus or minus another row
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; ++row) rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+
+	feFrustum frustum;
+	frustum.planes[Left] = rows[3] + rows[0];
+	frustum.planes[Right] = rows[3] - rows[0];
+	frustum.planes[Bottom] = rows[3] + rows[1];
+	frustum.planes[Top] = rows[3] - rows[1];
+	frustum.planes[Near] = rows[3] + rows[2];
+	frustum.planes[Far] = rows[3] - rows[2];
+
+	for (glm::vec4& plane : frustum.planes) plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
+
+bool feFrustum::IntersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+	}
+
+	return true;
+}
+
+bool feFrustum::IntersectsAabb(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		// The corner furthest along the normal
+		glm::vec3 corner = glm::vec3(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return false;
+	}
+
+	return true;
+}
\ No newline at end of file
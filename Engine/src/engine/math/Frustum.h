@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Six planes facing inwards, xyz is the unit normal and w the distance so dot(plane, vec4(point, 1)) is the signed
+// distance of point
+struct feFrustum final
+{
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	glm::vec4 planes[PlaneCount];
+
+	// Planes of a GL clip space matrix, proj * view gives them in world space
+	static feFrustum FromMatrix(const glm::mat4& viewProj);
+
+	// Conservative, spheres near a corner outside two planes can still pass
+	[[nodiscard]] bool IntersectsSphere(const glm::vec3& center, float radius) const;
+	[[nodiscard]] bool IntersectsAabb(const glm::vec3& min, const glm::vec3& max) const;
+};
\ No newline at end of file
@@ -5,10 +5,12 @@
 
 glm::mat4 feTransform::GetMatrix() const
 {
-	glm::mat4 mat = glm::identity<glm::mat4>();
-	mat = glm::translate(mat, pos);
-	mat *= glm::toMat4(quat);
-	mat = glm::scale(mat, sca);
+	// translate * rotate * scale without the full matrix products
+	glm::mat4 mat = glm::toMat4(quat);
+	mat[0] *= sca.x;
+	mat[1] *= sca.y;
+	mat[2] *= sca.z;
+	mat[3] = glm::vec4(pos, 1.0f);
 	return mat;
 }
 
@@ -22,12 +24,11 @@ void feTransform::SetMatrix(const glm::mat4& mat)
 
 void feTransform::Rotate(float angle, const glm::vec3& axis)
 {
-	// Preferred way to do this, this function doesn't work for whatever reason
-	// quat = glm::rotate(quat, angle, axis);
-
-	// Performs a rotation on the entire transform, not used because it exposes position and scaling
-	// SetMatrix(glm::rotate(GetMatrix(), angle, axis)); 
+	// glm::rotate normalises the axis, glm::angleAxis expects it normalised
+	Rotate(glm::angleAxis(angle, glm::normalize(axis)));
+}
 
-	// Convers the rotation to a matrix and uses that to apply the quaternion
-	quat = glm::normalize(glm::toQuat(glm::rotate(glm::toMat4(quat), angle, axis)));
-}
\ No newline at end of file
+void feTransform::Rotate(const glm::quat& rotation)
+{
+	quat = glm::normalize(quat * rotation);
+}
@@ -9,9 +9,12 @@ class feTransform final
 public:
 	glm::mat4 GetMatrix() const;
 	void SetMatrix(const glm::mat4& mat);
+	// Rotates around axis in local space, like glm::rotate on the matrix
 	void Rotate(float angle, const glm::vec3& axis);
+	// Applies rotation after the current rotation, in local space
+	void Rotate(const glm::quat& rotation);
 public:
 	glm::vec3 pos = glm::vec3(0, 0, 0);
-	glm::quat quat = glm::quat(0, 0, 0, 0);
+	glm::quat quat = glm::identity<glm::quat>();
 	glm::vec3 sca = glm::vec3(1, 1, 1);
 };
\ No newline at end of file
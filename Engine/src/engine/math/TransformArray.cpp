@@ -0,0 +1,364 @@
+#include "TransformArray.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_TRANSFORM_ARRAY_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "../util/ThreadPool.h"
+
+namespace
+{
+	// Below this many transforms a pool costs more than it saves
+	constexpr size_t MinParallelChunk = 1024;
+
+	// The rotation of q scaled per column, the same expressions as the SSE path so both give the same results
+	void BuildMatrix(float px, float py, float pz, float qx, float qy, float qz, float qw, float sx, float sy, float sz, glm::mat4& out)
+	{
+		float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+		out[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * sx, (2.0f * (xy + wz)) * sx, (2.0f * (xz - wy)) * sx, 0.0f);
+		out[1] = glm::vec4((2.0f * (xy - wz)) * sy, (1.0f - 2.0f * (xx + zz)) * sy, (2.0f * (yz + wx)) * sy, 0.0f);
+		out[2] = glm::vec4((2.0f * (xz + wy)) * sz, (2.0f * (yz - wx)) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f);
+		out[3] = glm::vec4(px, py, pz, 1.0f);
+	}
+
+	// viewProj * m with the sums grouped like TransformColumn
+	glm::mat4 TransformMatrix(const glm::mat4& viewProj, const glm::mat4& m)
+	{
+		glm::mat4 out;
+		for (int column = 0; column < 4; ++column) out[column] = (viewProj[0] * m[column].x + viewProj[1] * m[column].y) + (viewProj[2] * m[column].z + viewProj[3] * m[column].w);
+		return out;
+	}
+
+	// a * b normalised, term for term like the SSE path of RotateAll
+	void RotateQuaternion(float& ax, float& ay, float& az, float& aw, const glm::quat& b)
+	{
+		float w = ((aw * b.w - ax * b.x) - ay * b.y) - az * b.z;
+		float x = ((aw * b.x + ax * b.w) + ay * b.z) - az * b.y;
+		float y = ((aw * b.y + ay * b.w) + az * b.x) - ax * b.z;
+		float z = ((aw * b.z + az * b.w) + ax * b.y) - ay * b.x;
+
+		float length = std::sqrt((x * x + y * y) + (z * z + w * w));
+
+		ax = x / length;
+		ay = y / length;
+		az = z / length;
+		aw = w / length;
+	}
+
+#ifdef FE_TRANSFORM_ARRAY_SSE
+	// Column c of viewProj * m is viewProj * column c of m
+	__m128 TransformColumn(const __m128 viewProj[4], __m128 column)
+	{
+		__m128 x = _mm_mul_ps(viewProj[0], _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+		__m128 y = _mm_mul_ps(viewProj[1], _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1)));
+		__m128 z = _mm_mul_ps(viewProj[2], _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 w = _mm_mul_ps(viewProj[3], _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3)));
+		return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+	}
+
+	// r0 to r3 hold rows 0 to 3 of column c for four transforms, transposed they are column c of each transform
+	void StoreColumn(__m128 r0, __m128 r1, __m128 r2, __m128 r3, int column, glm::mat4* out, const __m128* viewProj)
+	{
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		if (viewProj)
+		{
+			r0 = TransformColumn(viewProj, r0);
+			r1 = TransformColumn(viewProj, r1);
+			r2 = TransformColumn(viewProj, r2);
+			r3 = TransformColumn(viewProj, r3);
+		}
+
+		_mm_storeu_ps(&out[0][column][0], r0);
+		_mm_storeu_ps(&out[1][column][0], r1);
+		_mm_storeu_ps(&out[2][column][0], r2);
+		_mm_storeu_ps(&out[3][column][0], r3);
+	}
+
+	// Matrices of four transforms, one per lane of each component
+	void StoreMatrices(__m128 px, __m128 py, __m128 pz, __m128 qx, __m128 qy, __m128 qz, __m128 qw, __m128 sx, __m128 sy, __m128 sz, glm::mat4* out, const __m128* viewProj)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		StoreColumn(
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+			zero, 0, out, viewProj);
+
+		StoreColumn(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+			zero, 1, out, viewProj);
+
+		StoreColumn(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+			zero, 2, out, viewProj);
+
+		StoreColumn(px, py, pz, one, 3, out, viewProj);
+	}
+#endif
+}
+
+size_t feTransformArray::Add(const feTransform& transform)
+{
+	m_PositionX.push_back(transform.pos.x);
+	m_PositionY.push_back(transform.pos.y);
+	m_PositionZ.push_back(transform.pos.z);
+	m_RotationX.push_back(transform.quat.x);
+	m_RotationY.push_back(transform.quat.y);
+	m_RotationZ.push_back(transform.quat.z);
+	m_RotationW.push_back(transform.quat.w);
+	m_ScaleX.push_back(transform.sca.x);
+	m_ScaleY.push_back(transform.sca.y);
+	m_ScaleZ.push_back(transform.sca.z);
+
+	return m_PositionX.size() - 1;
+}
+
+void feTransformArray::RemoveSwap(size_t index)
+{
+	for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+	{
+		(*component)[index] = component->back();
+		component->pop_back();
+	}
+}
+
+void feTransformArray::Reserve(size_t capacity)
+{
+	for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+	{
+		component->reserve(capacity);
+	}
+}
+
+void feTransformArray::Clear()
+{
+	for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+	{
+		component->clear();
+	}
+}
+
+size_t feTransformArray::GetCount() const
+{
+	return m_PositionX.size();
+}
+
+feTransform feTransformArray::Get(size_t index) const
+{
+	feTransform transform;
+	transform.pos = GetPosition(index);
+	transform.quat = GetRotation(index);
+	transform.sca = GetScale(index);
+	return transform;
+}
+
+void feTransformArray::Set(size_t index, const feTransform& transform)
+{
+	SetPosition(index, transform.pos);
+	SetRotation(index, transform.quat);
+	SetScale(index, transform.sca);
+}
+
+glm::vec3 feTransformArray::GetPosition(size_t index) const
+{
+	return glm::vec3(m_PositionX[index], m_PositionY[index], m_PositionZ[index]);
+}
+
+glm::quat feTransformArray::GetRotation(size_t index) const
+{
+	glm::quat rotation;
+	rotation.x = m_RotationX[index];
+	rotation.y = m_RotationY[index];
+	rotation.z = m_RotationZ[index];
+	rotation.w = m_RotationW[index];
+	return rotation;
+}
+
+glm::vec3 feTransformArray::GetScale(size_t index) const
+{
+	return glm::vec3(m_ScaleX[index], m_ScaleY[index], m_ScaleZ[index]);
+}
+
+void feTransformArray::SetPosition(size_t index, const glm::vec3& position)
+{
+	m_PositionX[index] = position.x;
+	m_PositionY[index] = position.y;
+	m_PositionZ[index] = position.z;
+}
+
+void feTransformArray::SetRotation(size_t index, const glm::quat& rotation)
+{
+	m_RotationX[index] = rotation.x;
+	m_RotationY[index] = rotation.y;
+	m_RotationZ[index] = rotation.z;
+	m_RotationW[index] = rotation.w;
+}
+
+void feTransformArray::SetScale(size_t index, const glm::vec3& scale)
+{
+	m_ScaleX[index] = scale.x;
+	m_ScaleY[index] = scale.y;
+	m_ScaleZ[index] = scale.z;
+}
+
+void feTransformArray::Rotate(size_t index, float angle, const glm::vec3& axis)
+{
+	Rotate(index, glm::angleAxis(angle, glm::normalize(axis)));
+}
+
+void feTransformArray::Rotate(size_t index, const glm::quat& rotation)
+{
+	SetRotation(index, glm::normalize(GetRotation(index) * rotation));
+}
+
+void feTransformArray::RotateAll(const glm::quat& rotation)
+{
+	size_t count = GetCount();
+	size_t i = 0;
+
+#ifdef FE_TRANSFORM_ARRAY_SSE
+	__m128 bx = _mm_set1_ps(rotation.x);
+	__m128 by = _mm_set1_ps(rotation.y);
+	__m128 bz = _mm_set1_ps(rotation.z);
+	__m128 bw = _mm_set1_ps(rotation.w);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 ax = _mm_loadu_ps(&m_RotationX[i]);
+		__m128 ay = _mm_loadu_ps(&m_RotationY[i]);
+		__m128 az = _mm_loadu_ps(&m_RotationZ[i]);
+		__m128 aw = _mm_loadu_ps(&m_RotationW[i]);
+
+		// a * b, term for term like glm's quaternion product
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		__m128 x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bx), _mm_mul_ps(ax, bw)), _mm_mul_ps(ay, bz)), _mm_mul_ps(az, by));
+		__m128 y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, by), _mm_mul_ps(ay, bw)), _mm_mul_ps(az, bx)), _mm_mul_ps(ax, bz));
+		__m128 z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bz), _mm_mul_ps(az, bw)), _mm_mul_ps(ax, by)), _mm_mul_ps(ay, bx));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+
+		_mm_storeu_ps(&m_RotationX[i], _mm_div_ps(x, length));
+		_mm_storeu_ps(&m_RotationY[i], _mm_div_ps(y, length));
+		_mm_storeu_ps(&m_RotationZ[i], _mm_div_ps(z, length));
+		_mm_storeu_ps(&m_RotationW[i], _mm_div_ps(w, length));
+	}
+#endif
+
+	for (; i < count; ++i) RotateQuaternion(m_RotationX[i], m_RotationY[i], m_RotationZ[i], m_RotationW[i], rotation);
+}
+
+void feTransformArray::BuildMatrices(size_t begin, size_t count, glm::mat4* out, const glm::mat4* viewProj) const
+{
+	size_t i = 0;
+
+#ifdef FE_TRANSFORM_ARRAY_SSE
+	__m128 viewProjColumns[4];
+	if (viewProj)
+	{
+		for (int column = 0; column < 4; ++column) viewProjColumns[column] = _mm_loadu_ps(&(*viewProj)[column][0]);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		size_t index = begin + i;
+
+		StoreMatrices(
+			_mm_loadu_ps(&m_PositionX[index]), _mm_loadu_ps(&m_PositionY[index]), _mm_loadu_ps(&m_PositionZ[index]),
+			_mm_loadu_ps(&m_RotationX[index]), _mm_loadu_ps(&m_RotationY[index]), _mm_loadu_ps(&m_RotationZ[index]), _mm_loadu_ps(&m_RotationW[index]),
+			_mm_loadu_ps(&m_ScaleX[index]), _mm_loadu_ps(&m_ScaleY[index]), _mm_loadu_ps(&m_ScaleZ[index]),
+			out + i, viewProj ? viewProjColumns : nullptr);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		size_t index = begin + i;
+		BuildMatrix(m_PositionX[index], m_PositionY[index], m_PositionZ[index], m_RotationX[index], m_RotationY[index], m_RotationZ[index], m_RotationW[index], m_ScaleX[index], m_ScaleY[index], m_ScaleZ[index], out[i]);
+		if (viewProj) out[i] = TransformMatrix(*viewProj, out[i]);
+	}
+}
+
+void feTransformArray::BuildMatrices(glm::mat4* out, const glm::mat4* viewProj, feThreadPool* threadPool) const
+{
+	size_t count = GetCount();
+
+	if (!threadPool || count < MinParallelChunk * 2)
+	{
+		BuildMatrices(0, count, out, viewProj);
+		return;
+	}
+
+	threadPool->ParallelFor(count, MinParallelChunk, [this, out, viewProj](size_t begin, size_t end)
+	{
+		BuildMatrices(begin, end - begin, out + begin, viewProj);
+	});
+}
+
+void feTransformArray::BuildMatrices(const std::vector<uint32_t>& indices, glm::mat4* out, const glm::mat4* viewProj, feThreadPool* threadPool) const
+{
+	size_t count = indices.size();
+
+	if (!threadPool || count < MinParallelChunk * 2)
+	{
+		GatherMatrices(indices.data(), count, out, viewProj);
+		return;
+	}
+
+	threadPool->ParallelFor(count, MinParallelChunk, [this, &indices, out, viewProj](size_t begin, size_t end)
+	{
+		GatherMatrices(indices.data() + begin, end - begin, out + begin, viewProj);
+	});
+}
+
+void feTransformArray::GatherMatrices(const uint32_t* indices, size_t count, glm::mat4* out, const glm::mat4* viewProj) const
+{
+	size_t i = 0;
+
+#ifdef FE_TRANSFORM_ARRAY_SSE
+	__m128 viewProjColumns[4];
+	if (viewProj)
+	{
+		for (int column = 0; column < 4; ++column) viewProjColumns[column] = _mm_loadu_ps(&(*viewProj)[column][0]);
+	}
+
+	// Every lane reads its own transform, the matrices are built the same way as for a range
+	auto gather = [indices, &i](const std::vector<float>& component)
+	{
+		return _mm_setr_ps(component[indices[i]], component[indices[i + 1]], component[indices[i + 2]], component[indices[i + 3]]);
+	};
+
+	for (; i + 4 <= count; i += 4)
+	{
+		StoreMatrices(
+			gather(m_PositionX), gather(m_PositionY), gather(m_PositionZ),
+			gather(m_RotationX), gather(m_RotationY), gather(m_RotationZ), gather(m_RotationW),
+			gather(m_ScaleX), gather(m_ScaleY), gather(m_ScaleZ),
+			out + i, viewProj ? viewProjColumns : nullptr);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		uint32_t index = indices[i];
+		BuildMatrix(m_PositionX[index], m_PositionY[index], m_PositionZ[index], m_RotationX[index], m_RotationY[index], m_RotationZ[index], m_RotationW[index], m_ScaleX[index], m_ScaleY[index], m_ScaleZ[index], out[i]);
+		if (viewProj) out[i] = TransformMatrix(*viewProj, out[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Transform.h"
+
+class feThreadPool;
+
+// Positions, rotations and scales of many transforms kept in one array per component, so matrices are built four
+// transforms at a time with SSE2 instead of one glm call chain per object
+class feTransformArray final
+{
+public:
+	// Returns the index of the new transform
+	size_t Add(const feTransform& transform = feTransform());
+	// Moves the last transform into index, the other indices stay valid
+	void RemoveSwap(size_t index);
+	void Reserve(size_t capacity);
+	void Clear();
+
+	[[nodiscard]] size_t GetCount() const;
+
+	[[nodiscard]] feTransform Get(size_t index) const;
+	void Set(size_t index, const feTransform& transform);
+
+	[[nodiscard]] glm::vec3 GetPosition(size_t index) const;
+	[[nodiscard]] glm::quat GetRotation(size_t index) const;
+	[[nodiscard]] glm::vec3 GetScale(size_t index) const;
+	void SetPosition(size_t index, const glm::vec3& position);
+	void SetRotation(size_t index, const glm::quat& rotation);
+	void SetScale(size_t index, const glm::vec3& scale);
+
+	// Same as feTransform::Rotate
+	void Rotate(size_t index, float angle, const glm::vec3& axis);
+	void Rotate(size_t index, const glm::quat& rotation);
+	// Applies rotation after the rotation of every transform
+	void RotateAll(const glm::quat& rotation);
+
+	// Matrices of [begin, begin + count) like feTransform::GetMatrix, or viewProj times them when it is set
+	void BuildMatrices(size_t begin, size_t count, glm::mat4* out, const glm::mat4* viewProj = nullptr) const;
+	// Every matrix, split across the pool when it is set
+	void BuildMatrices(glm::mat4* out, const glm::mat4* viewProj = nullptr, feThreadPool* threadPool = nullptr) const;
+	// Matrices of the transforms at indices, in the order of indices, split across the pool when it is set
+	void BuildMatrices(const std::vector<uint32_t>& indices, glm::mat4* out, const glm::mat4* viewProj = nullptr, feThreadPool* threadPool = nullptr) const;
+private:
+	void GatherMatrices(const uint32_t* indices, size_t count, glm::mat4* out, const glm::mat4* viewProj) const;
+private:
+	std::vector<float> m_PositionX;
+	std::vector<float> m_PositionY;
+	std::vector<float> m_PositionZ;
+	std::vector<float> m_RotationX;
+	std::vector<float> m_RotationY;
+	std::vector<float> m_RotationZ;
+	std::vector<float> m_RotationW;
+	std::vector<float> m_ScaleX;
+	std::vector<float> m_ScaleY;
+	std::vector<float> m_ScaleZ;
+};
\ No newline at end of file
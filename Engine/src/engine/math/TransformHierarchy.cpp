@@ -0,0 +1,242 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "../util/ThreadPool.h"
+
+namespace
+{
+	// Below this many nodes a pool costs more than it saves
+	constexpr size_t MinParallelNodes = 2048;
+}
+
+feTransformNode feTransformHierarchy::Add(const feTransform& local, feTransformNode parent)
+{
+	size_t node = m_NodeParents.size();
+	bool hasParent = parent.index != SIZE_MAX;
+
+	m_NodeParents.push_back(parent.index);
+	m_NodeRoots.push_back(hasParent ? m_NodeRoots[parent.index] : node);
+	m_NodeDepths.push_back(hasParent ? m_NodeDepths[parent.index] + 1 : 0);
+	m_NodeToIndex.push_back(m_IndexToNode.size());
+
+	m_Locals.Add(local);
+	m_Parents.push_back(hasParent ? static_cast<uint32_t>(m_NodeToIndex[parent.index]) : NoParent);
+	m_Dirty.push_back(1);
+	m_Updated.push_back(0);
+	m_World.emplace_back(1.0f);
+	m_InverseWorld.emplace_back(1.0f);
+	m_IndexToNode.push_back(node);
+
+	// A new root starts its own group at the end, a child has to move in with its root
+	if (hasParent) m_Sorted = false;
+	else if (m_Sorted)
+	{
+		// The old end is where the new group starts
+		if (m_SubtreeStarts.empty()) m_SubtreeStarts.push_back(0);
+		m_SubtreeStarts.push_back(m_IndexToNode.size());
+	}
+
+	return { node };
+}
+
+void feTransformHierarchy::Reserve(size_t capacity)
+{
+	m_NodeParents.reserve(capacity);
+	m_NodeRoots.reserve(capacity);
+	m_NodeDepths.reserve(capacity);
+	m_NodeToIndex.reserve(capacity);
+
+	m_Locals.Reserve(capacity);
+	m_Parents.reserve(capacity);
+	m_Dirty.reserve(capacity);
+	m_Updated.reserve(capacity);
+	m_World.reserve(capacity);
+	m_InverseWorld.reserve(capacity);
+	m_IndexToNode.reserve(capacity);
+}
+
+void feTransformHierarchy::Clear()
+{
+	*this = feTransformHierarchy();
+}
+
+size_t feTransformHierarchy::GetCount() const
+{
+	return m_NodeParents.size();
+}
+
+feTransformNode feTransformHierarchy::GetParent(feTransformNode node) const
+{
+	return { m_NodeParents[node.index] };
+}
+
+feTransform feTransformHierarchy::GetLocal(feTransformNode node) const
+{
+	return m_Locals.Get(m_NodeToIndex[node.index]);
+}
+
+void feTransformHierarchy::SetLocal(feTransformNode node, const feTransform& local)
+{
+	size_t index = m_NodeToIndex[node.index];
+	m_Locals.Set(index, local);
+	m_Dirty[index] = 1;
+}
+
+void feTransformHierarchy::SetPosition(feTransformNode node, const glm::vec3& position)
+{
+	size_t index = m_NodeToIndex[node.index];
+	m_Locals.SetPosition(index, position);
+	m_Dirty[index] = 1;
+}
+
+void feTransformHierarchy::SetRotation(feTransformNode node, const glm::quat& rotation)
+{
+	size_t index = m_NodeToIndex[node.index];
+	m_Locals.SetRotation(index, rotation);
+	m_Dirty[index] = 1;
+}
+
+void feTransformHierarchy::Rotate(feTransformNode node, const glm::quat& rotation)
+{
+	size_t index = m_NodeToIndex[node.index];
+	m_Locals.Rotate(index, rotation);
+	m_Dirty[index] = 1;
+}
+
+void feTransformHierarchy::Propagate(feThreadPool* threadPool)
+{
+	if (!m_Sorted) Sort();
+
+	size_t subtreeCount = m_SubtreeStarts.empty() ? 0 : m_SubtreeStarts.size() - 1;
+
+	m_Stats.nodes = GetCount();
+	m_Stats.subtrees = subtreeCount;
+
+	if (!threadPool || subtreeCount < 2 || GetCount() < MinParallelNodes)
+	{
+		m_Stats.updated = PropagateRange(0, GetCount());
+		return;
+	}
+
+	std::atomic<size_t> updated = 0;
+	threadPool->ParallelFor(subtreeCount, 1, [this, &updated](size_t begin, size_t end)
+	{
+		updated += PropagateRange(m_SubtreeStarts[begin], m_SubtreeStarts[end]);
+	});
+
+	m_Stats.updated = updated;
+}
+
+const glm::mat4& feTransformHierarchy::GetWorld(feTransformNode node) const
+{
+	return m_World[m_NodeToIndex[node.index]];
+}
+
+const glm::mat4& feTransformHierarchy::GetInverseWorld(feTransformNode node) const
+{
+	return m_InverseWorld[m_NodeToIndex[node.index]];
+}
+
+bool feTransformHierarchy::WasUpdated(feTransformNode node) const
+{
+	return m_Updated[m_NodeToIndex[node.index]] != 0;
+}
+
+const feTransformHierarchyStats& feTransformHierarchy::GetStats() const
+{
+	return m_Stats;
+}
+
+void feTransformHierarchy::Sort()
+{
+	size_t count = GetCount();
+
+	// Nodes were added after their parents, so sorting by root and then depth keeps parents first
+	std::vector<size_t> order = std::vector<size_t>(count);
+	for (size_t node = 0; node < count; ++node) order[node] = node;
+
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+	{
+		if (m_NodeRoots[a] != m_NodeRoots[b]) return m_NodeRoots[a] < m_NodeRoots[b];
+		return m_NodeDepths[a] < m_NodeDepths[b];
+	});
+
+	feTransformArray locals;
+	locals.Reserve(count);
+
+	std::vector<uint8_t> dirty = std::vector<uint8_t>(count);
+	std::vector<uint8_t> updated = std::vector<uint8_t>(count);
+	std::vector<glm::mat4> world = std::vector<glm::mat4>(count);
+	std::vector<glm::mat4> inverseWorld = std::vector<glm::mat4>(count);
+
+	m_SubtreeStarts.clear();
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		size_t node = order[index];
+		size_t oldIndex = m_NodeToIndex[node];
+
+		locals.Add(m_Locals.Get(oldIndex));
+		dirty[index] = m_Dirty[oldIndex];
+		updated[index] = m_Updated[oldIndex];
+		world[index] = m_World[oldIndex];
+		inverseWorld[index] = m_InverseWorld[oldIndex];
+
+		if (m_NodeRoots[node] == node) m_SubtreeStarts.push_back(index);
+	}
+
+	m_SubtreeStarts.push_back(count);
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		m_IndexToNode[index] = order[index];
+		m_NodeToIndex[order[index]] = index;
+	}
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		size_t parent = m_NodeParents[order[index]];
+		m_Parents[index] = parent == SIZE_MAX ? NoParent : static_cast<uint32_t>(m_NodeToIndex[parent]);
+	}
+
+	m_Locals = std::move(locals);
+	m_Dirty = std::move(dirty);
+	m_Updated = std::move(updated);
+	m_World = std::move(world);
+	m_InverseWorld = std::move(inverseWorld);
+
+	m_Sorted = true;
+}
+
+size_t feTransformHierarchy::PropagateRange(size_t begin, size_t end)
+{
+	size_t updated = 0;
+
+	for (size_t index = begin; index < end; ++index)
+	{
+		uint32_t parent = m_Parents[index];
+		bool parentUpdated = parent != NoParent && m_Updated[parent];
+
+		if (!m_Dirty[index] && !parentUpdated)
+		{
+			m_Updated[index] = 0;
+			continue;
+		}
+
+		glm::mat4 local;
+		m_Locals.BuildMatrices(index, 1, &local);
+
+		m_World[index] = parent == NoParent ? local : m_World[parent] * local;
+		m_InverseWorld[index] = glm::affineInverse(m_World[index]);
+
+		m_Dirty[index] = 0;
+		m_Updated[index] = 1;
+		++updated;
+	}
+
+	return updated;
+}
\ No newline at end of file
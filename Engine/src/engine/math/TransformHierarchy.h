@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "TransformArray.h"
+
+class feThreadPool;
+
+struct feTransformNode final
+{
+	size_t index = SIZE_MAX;
+};
+
+struct feTransformHierarchyStats final
+{
+	size_t nodes = 0;
+	// World matrices recomputed by the last Propagate
+	size_t updated = 0;
+	size_t subtrees = 0;
+};
+
+// Local transforms with parent links and cached world and inverse world matrices. Nodes are stored grouped by root
+// and sorted by depth inside each group, so Propagate visits parents before their children in one linear pass and
+// only recomputes nodes whose local transform or any ancestor changed. Groups share nothing, so the pool can update
+// them side by side.
+class feTransformHierarchy final
+{
+public:
+	// The parent has to exist already, an empty node makes a root
+	feTransformNode Add(const feTransform& local = feTransform(), feTransformNode parent = feTransformNode());
+	void Reserve(size_t capacity);
+	void Clear();
+
+	[[nodiscard]] size_t GetCount() const;
+	[[nodiscard]] feTransformNode GetParent(feTransformNode node) const;
+
+	// Setting a local transform marks the node dirty, its subtree is recomputed by the next Propagate
+	[[nodiscard]] feTransform GetLocal(feTransformNode node) const;
+	void SetLocal(feTransformNode node, const feTransform& local);
+	void SetPosition(feTransformNode node, const glm::vec3& position);
+	void SetRotation(feTransformNode node, const glm::quat& rotation);
+	void Rotate(feTransformNode node, const glm::quat& rotation);
+
+	void Propagate(feThreadPool* threadPool = nullptr);
+
+	// As of the last Propagate
+	[[nodiscard]] const glm::mat4& GetWorld(feTransformNode node) const;
+	[[nodiscard]] const glm::mat4& GetInverseWorld(feTransformNode node) const;
+	[[nodiscard]] bool WasUpdated(feTransformNode node) const;
+	[[nodiscard]] const feTransformHierarchyStats& GetStats() const;
+private:
+	void Sort();
+	// Returns the number of world matrices recomputed in [begin, end)
+	size_t PropagateRange(size_t begin, size_t end);
+private:
+	static constexpr uint32_t NoParent = UINT32_MAX;
+
+	// Per node, in the order nodes were added
+	std::vector<size_t> m_NodeParents;
+	std::vector<size_t> m_NodeRoots;
+	std::vector<uint32_t> m_NodeDepths;
+	std::vector<size_t> m_NodeToIndex;
+
+	// Per node, in propagation order
+	feTransformArray m_Locals;
+	std::vector<uint32_t> m_Parents;
+	std::vector<uint8_t> m_Dirty;
+	std::vector<uint8_t> m_Updated;
+	std::vector<glm::mat4> m_World;
+	std::vector<glm::mat4> m_InverseWorld;
+	std::vector<size_t> m_IndexToNode;
+	// Start of every root group, followed by the node count
+	std::vector<size_t> m_SubtreeStarts;
+
+	bool m_Sorted = true;
+	feTransformHierarchyStats m_Stats;
+};
\ No newline at end of file
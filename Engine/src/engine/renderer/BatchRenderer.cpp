@@ -0,0 +1,198 @@
+#include "BatchRenderer.h"
+
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "Util.h"
+#include "Shader.h"
+
+feBatchRenderer::feBatchRenderer(const feBatchRendererCreateInfo& info)
+{
+	m_Heap = info.heap;
+	m_MaxDraws = info.maxDraws;
+
+	// Multi draw indirect and storage buffers are core in 4.3, batch.vert needs gl_BaseInstanceARB on top
+	m_Indirect = feRenderUtil::GetSupportedVersion() >= 43 && feRenderUtil::IsExtensionSupported("GL_ARB_shader_draw_parameters");
+
+	if (m_Indirect)
+	{
+		feStreamBufferCreateInfo commandInfo;
+		commandInfo.target = GL_DRAW_INDIRECT_BUFFER;
+		commandInfo.frameSize = m_MaxDraws * sizeof(feDrawElementsIndirectCommand);
+		commandInfo.debugName = info.debugName;
+
+		m_CommandBuffer = commandInfo;
+
+		feStreamBufferCreateInfo drawInfo;
+		drawInfo.target = GL_SHADER_STORAGE_BUFFER;
+		drawInfo.frameSize = m_MaxDraws * sizeof(feBatchDrawData);
+		drawInfo.debugName = info.debugName;
+
+		m_DrawBuffer = drawInfo;
+	}
+	else
+	{
+		feLog::Debug("Multi draw indirect is not supported, batches are drawn one by one");
+	}
+
+	m_Packets.reserve(m_MaxDraws);
+	m_Order.reserve(m_MaxDraws);
+}
+
+void feBatchRenderer::Begin()
+{
+	m_Packets.clear();
+	m_Stats = feBatchRendererStats();
+}
+
+void feBatchRenderer::Submit(feProgram* program, const feMeshAllocation& mesh, const feBatchDrawData& data)
+{
+	if (m_Packets.size() >= m_MaxDraws)
+	{
+		feLog::Warn("Batch renderer is full, dropping draw");
+		return;
+	}
+
+	if (!program || !mesh.IsValid()) return;
+
+	feBatchPacket& packet = m_Packets.emplace_back();
+	packet.program = program;
+	packet.mesh = mesh;
+	packet.data = data;
+}
+
+void feBatchRenderer::End()
+{
+	if (m_Packets.empty()) return;
+
+	// Group by program first since it is the more expensive change
+	m_Order.resize(m_Packets.size());
+	for (size_t i = 0; i < m_Order.size(); ++i) m_Order[i] = i;
+
+	std::stable_sort(m_Order.begin(), m_Order.end(), [this](size_t a, size_t b)
+	{
+		const feBatchPacket& lhs = m_Packets[a];
+		const feBatchPacket& rhs = m_Packets[b];
+		if (lhs.program != rhs.program) return std::less<feProgram*>()(lhs.program, rhs.program);
+		if (lhs.mesh.format.index != rhs.mesh.format.index) return lhs.mesh.format.index < rhs.mesh.format.index;
+		return lhs.mesh.indexType < rhs.mesh.indexType;
+	});
+
+	m_Stats.draws = m_Packets.size();
+
+	if (m_Indirect) SubmitIndirect();
+	else SubmitLoop();
+}
+
+bool feBatchRenderer::IsIndirect() const
+{
+	return m_Indirect;
+}
+
+const feBatchRendererStats& feBatchRenderer::GetFrameStats() const
+{
+	return m_Stats;
+}
+
+void feBatchRenderer::SubmitIndirect()
+{
+	m_CommandBuffer.BeginFrame();
+	m_DrawBuffer.BeginFrame();
+
+	feStreamAllocation commands = m_CommandBuffer.Allocate(m_Packets.size() * sizeof(feDrawElementsIndirectCommand), sizeof(feDrawElementsIndirectCommand));
+	feStreamAllocation draws = m_DrawBuffer.Allocate(m_Packets.size() * sizeof(feBatchDrawData));
+
+	// Mapping failed, the programs cannot be drawn any other way
+	if (!commands.data || !draws.data) return;
+
+	feDrawElementsIndirectCommand* commandData = static_cast<feDrawElementsIndirectCommand*>(commands.data);
+	feBatchDrawData* drawData = static_cast<feBatchDrawData*>(draws.data);
+
+	for (size_t i = 0; i < m_Order.size(); ++i)
+	{
+		const feBatchPacket& packet = m_Packets[m_Order[i]];
+
+		feDrawElementsIndirectCommand command;
+		command.count = packet.mesh.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = packet.mesh.firstIndex;
+		command.baseVertex = packet.mesh.baseVertex;
+		// Also the index of this draw's record in the storage buffer
+		command.baseInstance = static_cast<unsigned int>(i);
+
+		std::memcpy(commandData + i, &command, sizeof(command));
+		std::memcpy(drawData + i, &packet.data, sizeof(packet.data));
+	}
+
+	m_CommandBuffer.Flush();
+	m_DrawBuffer.Flush();
+
+	m_CommandBuffer.Bind();
+	m_DrawBuffer.BindRange(FE_SHADER_STORAGE_BATCH_DRAWS, draws);
+
+	size_t first = 0;
+
+	while (first < m_Order.size())
+	{
+		const feBatchPacket& packet = m_Packets[m_Order[first]];
+
+		size_t last = first + 1;
+		while (last < m_Order.size())
+		{
+			const feBatchPacket& next = m_Packets[m_Order[last]];
+			if (next.program != packet.program || next.mesh.format.index != packet.mesh.format.index) break;
+			// One multi draw takes a single index type
+			if (next.mesh.indexType != packet.mesh.indexType) break;
+			++last;
+		}
+
+		packet.program->Bind();
+		m_Heap->Bind(packet.mesh.format);
+
+		size_t offset = commands.offset + first * sizeof(feDrawElementsIndirectCommand);
+		glMultiDrawElementsIndirect(m_Heap->GetVertexArray(packet.mesh.format).GetMode(), packet.mesh.indexType, (const void*) (intptr_t) offset, static_cast<GLsizei>(last - first), 0);
+
+		++m_Stats.batches;
+		first = last;
+	}
+
+	m_CommandBuffer.EndFrame();
+	m_DrawBuffer.EndFrame();
+}
+
+void feBatchRenderer::SubmitLoop()
+{
+	feProgram* program = nullptr;
+	size_t format = SIZE_MAX;
+	feUniformSlot model;
+	feUniformSlot color;
+
+	for (size_t index : m_Order)
+	{
+		const feBatchPacket& packet = m_Packets[index];
+
+		if (packet.program != program)
+		{
+			program = packet.program;
+			program->Bind();
+			model = program->GetUniformSlot("u_Model"_uniform);
+			color = program->GetUniformSlot("u_Color"_uniform);
+			format = SIZE_MAX;
+		}
+
+		if (packet.mesh.format.index != format)
+		{
+			++m_Stats.batches;
+			format = packet.mesh.format.index;
+			m_Heap->Bind(packet.mesh.format);
+		}
+
+		program->UniformMat4f(model, packet.data.model);
+		program->Uniform3f(color, glm::vec3(packet.data.color));
+		m_Heap->Draw(packet.mesh);
+	}
+}
\ No newline at end of file
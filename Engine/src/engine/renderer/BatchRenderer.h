@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BufferHeap.h"
+#include "StreamBuffer.h"
+
+class feProgram;
+
+// Fixed binding point of the per-draw storage buffer, matches res/shaders/batch.vert
+constexpr unsigned int FE_SHADER_STORAGE_BATCH_DRAWS = 0;
+
+// std430 layout, one record per submitted draw
+struct feBatchDrawData final
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec4 color = glm::vec4(1.0f);
+};
+
+static_assert(sizeof(feBatchDrawData) == 80, "feBatchDrawData does not match std430");
+
+// Matches the layout glMultiDrawElementsIndirect reads
+struct feDrawElementsIndirectCommand final
+{
+	unsigned int count = 0;
+	unsigned int instanceCount = 0;
+	unsigned int firstIndex = 0;
+	int baseVertex = 0;
+	unsigned int baseInstance = 0;
+};
+
+struct feBatchRendererCreateInfo final
+{
+	// Meshes drawn through the batch must live in this heap
+	const feMeshHeap* heap = nullptr;
+	size_t maxDraws = 4096;
+
+	const char* debugName = nullptr;
+};
+
+struct feBatchRendererStats final
+{
+	uint64_t draws = 0;
+	// Program, format and index type changes, each one is a single multi draw on the indirect path
+	uint64_t batches = 0;
+};
+
+// Collects draws during the frame and submits every run with the same program and mesh format at once.
+// With GL 4.3 and shader draw parameters, commands and per-draw data are streamed to the GPU and each run is a single
+// glMultiDrawElementsIndirect, programs read their feBatchDrawData record through gl_BaseInstanceARB (see batch.vert).
+// Other contexts loop over the draws, programs then take the data through u_Model and u_Color uniforms.
+class feBatchRenderer final
+{
+public:
+	feBatchRenderer() = default;
+	feBatchRenderer(const feBatchRendererCreateInfo& info);
+
+	feBatchRenderer(const feBatchRenderer&) = delete;
+	feBatchRenderer& operator=(const feBatchRenderer&) = delete;
+
+	feBatchRenderer(feBatchRenderer&& other) noexcept = default;
+	feBatchRenderer& operator=(feBatchRenderer&& other) noexcept = default;
+
+	void Begin();
+	// The program has to stay alive until End, draws past maxDraws are dropped
+	void Submit(feProgram* program, const feMeshAllocation& mesh, const feBatchDrawData& data);
+	void End();
+
+	// Selects the kind of program to submit with, see the class comment
+	[[nodiscard]] bool IsIndirect() const;
+	[[nodiscard]] const feBatchRendererStats& GetFrameStats() const;
+private:
+	void SubmitIndirect();
+	void SubmitLoop();
+private:
+	struct feBatchPacket final
+	{
+		feProgram* program = nullptr;
+		feMeshAllocation mesh;
+		feBatchDrawData data;
+	};
+
+	const feMeshHeap* m_Heap = nullptr;
+	size_t m_MaxDraws = 0;
+	bool m_Indirect = false;
+	feStreamBuffer m_CommandBuffer;
+	feStreamBuffer m_DrawBuffer;
+	std::vector<feBatchPacket> m_Packets;
+	std::vector<size_t> m_Order;
+	feBatchRendererStats m_Stats;
+};
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "BufferHeap.h"
+
+#include <vector>
+#include <utility>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "MeshOptimizer.h"
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+feOffsetAllocator::feOffsetAllocator(size_t capacity)
+	: m_Capacity(capacity)
+{
+	if (capacity > 0) AddFreeBlock(0, capacity);
+}
+
+feHeapAllocation feOffsetAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0) return feHeapAllocation();
+	if (alignment == 0) alignment = 1;
+
+	// Smallest block first, larger ones are only needed when alignment padding does not fit
+	for (auto it = m_FreeBySize.lower_bound(size); it != m_FreeBySize.end(); ++it)
+	{
+		size_t blockOffset = it->second;
+		size_t blockSize = it->first;
+		size_t alignedOffset = AlignUp(blockOffset, alignment);
+		size_t padding = alignedOffset - blockOffset;
+
+		if (padding + size > blockSize) continue;
+
+		RemoveFreeBlock(m_FreeByOffset.find(blockOffset));
+
+		if (padding > 0) AddFreeBlock(blockOffset, padding);
+		if (padding + size < blockSize) AddFreeBlock(alignedOffset + size, blockSize - padding - size);
+
+		feHeapAllocation allocation;
+		allocation.offset = alignedOffset;
+		allocation.size = size;
+		return allocation;
+	}
+
+	return feHeapAllocation();
+}
+
+void feOffsetAllocator::Free(const feHeapAllocation& allocation)
+{
+	if (!allocation.IsValid()) return;
+
+	size_t offset = allocation.offset;
+	size_t size = allocation.size;
+
+	auto next = m_FreeByOffset.lower_bound(offset);
+
+	if (next != m_FreeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeBlock(previous);
+		}
+	}
+
+	if (next != m_FreeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		RemoveFreeBlock(next);
+	}
+
+	AddFreeBlock(offset, size);
+}
+
+size_t feOffsetAllocator::GetCapacity() const
+{
+	return m_Capacity;
+}
+
+size_t feOffsetAllocator::GetFreeSize() const
+{
+	return m_FreeSize;
+}
+
+size_t feOffsetAllocator::GetLargestFreeBlock() const
+{
+	if (m_FreeBySize.empty()) return 0;
+	return m_FreeBySize.rbegin()->first;
+}
+
+void feOffsetAllocator::AddFreeBlock(size_t offset, size_t size)
+{
+	m_FreeByOffset.emplace(offset, size);
+	m_FreeBySize.emplace(size, offset);
+	m_FreeSize += size;
+}
+
+void feOffsetAllocator::RemoveFreeBlock(std::map<size_t, size_t>::iterator block)
+{
+	auto range = m_FreeBySize.equal_range(block->second);
+
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == block->first)
+		{
+			m_FreeBySize.erase(it);
+			break;
+		}
+	}
+
+	m_FreeSize -= block->second;
+	m_FreeByOffset.erase(block);
+}
+
+feMeshHeap::feMeshHeap(const feMeshHeapCreateInfo& info)
+	: m_VertexAllocator(info.vertexCapacity), m_IndexAllocator(info.indexCapacity)
+{
+	{
+		feBufferObjectCreateInfo bufferInfo;
+		bufferInfo.target = GL_ARRAY_BUFFER;
+		bufferInfo.size = info.vertexCapacity;
+		bufferInfo.usage = GL_DYNAMIC_DRAW;
+		bufferInfo.debugName = info.debugName;
+
+		m_VertexBuffer = bufferInfo;
+	}
+
+	{
+		feBufferObjectCreateInfo bufferInfo;
+		bufferInfo.target = GL_ELEMENT_ARRAY_BUFFER;
+		bufferInfo.size = info.indexCapacity;
+		bufferInfo.usage = GL_DYNAMIC_DRAW;
+		bufferInfo.debugName = info.debugName;
+
+		m_IndexBuffer = bufferInfo;
+	}
+}
+
+feMeshFormat feMeshHeap::AddFormat(const feMeshFormatInfo& info)
+{
+	feVertexArrayCreateInfoBufferObjectInfo bufferInfos[2];
+	bufferInfos[0].buffer = &m_VertexBuffer;
+	bufferInfos[0].stride = info.stride;
+	bufferInfos[1].buffer = info.instanceBuffer;
+	bufferInfos[1].handle = info.GetInstanceHandle();
+	bufferInfos[1].stride = info.instanceStride;
+
+	std::vector<feVertexArrayCreateInfoAttributeInfo> attributeInfos = std::vector<feVertexArrayCreateInfoAttributeInfo>(info.attributeInfos, info.attributeInfos + info.attributeInfoCount);
+	for (feVertexArrayCreateInfoAttributeInfo& attributeInfo : attributeInfos) attributeInfo.buffer = 0;
+
+	unsigned int instanceHandle = info.GetInstanceHandle();
+	if (instanceHandle)
+	{
+		for (size_t i = 0; i < info.instanceAttributeInfoCount; ++i)
+		{
+			feVertexArrayCreateInfoAttributeInfo& attributeInfo = attributeInfos.emplace_back(info.instanceAttributeInfos[i]);
+			attributeInfo.buffer = 1;
+			if (attributeInfo.divisor == 0) attributeInfo.divisor = 1;
+		}
+	}
+
+	uint64_t hash = feHash::Fnv1a64Value(info.stride);
+	hash = feHash::Fnv1a64Value(instanceHandle, hash);
+	hash = feHash::Fnv1a64Value(info.instanceStride, hash);
+	hash = feHash::Fnv1a64Value(info.mode, hash);
+	hash = feVertexLayoutUtil::Hash(attributeInfos.data(), attributeInfos.size(), hash);
+
+	// Identical formats share their vertex array
+	for (size_t i = 0; i < m_Formats.size(); ++i)
+	{
+		if (m_Formats[i].hash != hash) continue;
+
+		feMeshFormat result;
+		result.index = i;
+		return result;
+	}
+
+	feVertexArrayCreateInfo vaoInfo;
+	vaoInfo.vertexBufferInfos = bufferInfos;
+	vaoInfo.vertexBufferInfoCount = instanceHandle ? 2 : 1;
+	vaoInfo.attributeInfos = attributeInfos.data();
+	vaoInfo.attributeInfoCount = attributeInfos.size();
+	vaoInfo.indexBuffer = &m_IndexBuffer;
+	vaoInfo.mode = info.mode;
+	vaoInfo.debugName = info.debugName;
+
+	feMeshHeapFormat& format = m_Formats.emplace_back();
+	format.vertexArray = vaoInfo;
+	format.attributeInfos = std::move(attributeInfos);
+	format.stride = info.stride;
+	format.hash = hash;
+
+	feMeshFormat result;
+	result.index = m_Formats.size() - 1;
+	return result;
+}
+
+feMeshAllocation feMeshHeap::Upload(feMeshFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	feMeshAllocation allocation;
+
+	if (format.index >= m_Formats.size())
+	{
+		feLog::Warn("Attempting to upload a mesh with an unknown format");
+		feLog::Break();
+		return allocation;
+	}
+
+	size_t stride = m_Formats[format.index].stride;
+	unsigned int indexType = feVertexArray::PickIndexType(vertexCount);
+	size_t indexSize = feVertexArray::GetIndexSize(indexType);
+
+	// Vertex offsets must be a multiple of the stride so they can be expressed as a base vertex
+	allocation.vertices = m_VertexAllocator.Allocate(vertexCount * stride, stride);
+	allocation.indices = m_IndexAllocator.Allocate(indexCount * indexSize, indexSize);
+
+	if (!allocation.IsValid())
+	{
+		feLog::Warn("Mesh heap is out of space");
+		m_VertexAllocator.Free(allocation.vertices);
+		m_IndexAllocator.Free(allocation.indices);
+		return feMeshAllocation();
+	}
+
+	allocation.format = format;
+	allocation.baseVertex = static_cast<int>(allocation.vertices.offset / stride);
+	allocation.firstIndex = static_cast<unsigned int>(allocation.indices.offset / indexSize);
+	allocation.indexCount = static_cast<unsigned int>(indexCount);
+	allocation.indexType = indexType;
+
+	m_VertexBuffer.SetData(allocation.vertices.offset, allocation.vertices.size, vertices);
+
+	if (indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<unsigned short> shortIndices = std::vector<unsigned short>(indices, indices + indexCount);
+		m_IndexBuffer.SetData(allocation.indices.offset, allocation.indices.size, shortIndices.data());
+	}
+	else
+	{
+		m_IndexBuffer.SetData(allocation.indices.offset, allocation.indices.size, indices);
+	}
+
+	return allocation;
+}
+
+feMeshAllocation feMeshHeap::UploadOptimized(feMeshFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, const char* debugName)
+{
+	if (format.index >= m_Formats.size())
+	{
+		feLog::Warn("Attempting to upload a mesh with an unknown format");
+		feLog::Break();
+		return feMeshAllocation();
+	}
+
+	const feMeshHeapFormat& heapFormat = m_Formats[format.index];
+
+	std::vector<unsigned char> optimizedVertices = std::vector<unsigned char>(static_cast<const unsigned char*>(vertices), static_cast<const unsigned char*>(vertices) + vertexCount * heapFormat.stride);
+	std::vector<unsigned int> optimizedIndices = std::vector<unsigned int>(indices, indices + indexCount);
+
+	feMeshOptimizerInfo info;
+	info.vertices = optimizedVertices.data();
+	info.vertexCount = vertexCount;
+	info.vertexSize = heapFormat.stride;
+	info.indices = optimizedIndices.data();
+	info.indexCount = indexCount;
+	info.debugName = debugName;
+
+	const feVertexArrayCreateInfoAttributeInfo* position = heapFormat.attributeInfos.empty() ? nullptr : &heapFormat.attributeInfos.front();
+	if (position && position->size >= 3 && !position->normalized && (position->type == GL_FLOAT || position->type == GL_HALF_FLOAT))
+	{
+		info.positionOffset = position->offset;
+		info.positionType = position->type;
+	}
+	else
+	{
+		info.overdrawThreshold = 0.0f;
+	}
+
+	size_t optimizedVertexCount = feMeshOptimizer::Optimize(info);
+
+	return Upload(format, optimizedVertices.data(), optimizedVertexCount, optimizedIndices.data(), optimizedIndices.size());
+}
+
+void feMeshHeap::Free(const feMeshAllocation& allocation)
+{
+	m_VertexAllocator.Free(allocation.vertices);
+	m_IndexAllocator.Free(allocation.indices);
+}
+
+void feMeshHeap::Bind(feMeshFormat format) const
+{
+	GetVertexArray(format).Bind();
+}
+
+void feMeshHeap::Draw(const feMeshAllocation& allocation) const
+{
+	GetVertexArray(allocation.format).DrawBaseVertex(allocation.indexCount, allocation.firstIndex, allocation.baseVertex, allocation.indexType);
+}
+
+void feMeshHeap::DrawInstanced(const feMeshAllocation& allocation, unsigned int instanceCount, unsigned int baseInstance) const
+{
+	GetVertexArray(allocation.format).DrawInstancedBaseVertex(allocation.indexCount, allocation.firstIndex, allocation.baseVertex, instanceCount, baseInstance, allocation.indexType);
+}
+
+bool feMeshHeap::Validate(feMeshFormat format, const feProgram& program, const char* debugName) const
+{
+	const std::vector<feVertexArrayCreateInfoAttributeInfo>& attributeInfos = m_Formats[format.index].attributeInfos;
+	return feVertexLayoutUtil::Validate(program, attributeInfos.data(), attributeInfos.size(), debugName);
+}
+
+const feVertexArray& feMeshHeap::GetVertexArray(feMeshFormat format) const
+{
+	return m_Formats[format.index].vertexArray;
+}
+
+const feBufferObject& feMeshHeap::GetVertexBuffer() const
+{
+	return m_VertexBuffer;
+}
+
+const feBufferObject& feMeshHeap::GetIndexBuffer() const
+{
+	return m_IndexBuffer;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "BufferObject.h"
+#include "StreamBuffer.h"
+#include "VertexArray.h"
+#include "VertexLayout.h"
+
+struct feHeapAllocation final
+{
+	size_t offset = SIZE_MAX;
+	size_t size = 0;
+
+	[[nodiscard]] bool IsValid() const { return offset != SIZE_MAX; }
+};
+
+// Best fit free-list over a range of offsets, neighbouring free blocks are merged on Free
+class feOffsetAllocator final
+{
+public:
+	feOffsetAllocator(size_t capacity = 0);
+
+	feHeapAllocation Allocate(size_t size, size_t alignment = 1);
+	void Free(const feHeapAllocation& allocation);
+
+	[[nodiscard]] size_t GetCapacity() const;
+	[[nodiscard]] size_t GetFreeSize() const;
+	[[nodiscard]] size_t GetLargestFreeBlock() const;
+private:
+	void AddFreeBlock(size_t offset, size_t size);
+	void RemoveFreeBlock(std::map<size_t, size_t>::iterator block);
+private:
+	size_t m_Capacity = 0;
+	size_t m_FreeSize = 0;
+	// offset -> size, for merging neighbours
+	std::map<size_t, size_t> m_FreeByOffset;
+	// size -> offset, for best fit searches
+	std::multimap<size_t, size_t> m_FreeBySize;
+};
+
+struct feMeshHeapCreateInfo final
+{
+	size_t vertexCapacity = 0;
+	size_t indexCapacity = 0;
+
+	const char* debugName = nullptr;
+};
+
+// Attribute buffer indices are ignored, every attribute reads from the shared vertex buffer
+struct feMeshFormatInfo final
+{
+	const feVertexArrayCreateInfoAttributeInfo* attributeInfos = nullptr;
+	size_t attributeInfoCount = 0;
+	unsigned int stride = 0;
+	unsigned int mode = 0;
+
+	// Optional, read from instanceBuffer at the locations following the vertex attributes. A divisor of 0 is treated as 1
+	const feVertexArrayCreateInfoAttributeInfo* instanceAttributeInfos = nullptr;
+	size_t instanceAttributeInfoCount = 0;
+	feBufferObject* instanceBuffer = nullptr;
+	// Used when instanceBuffer is null. Draws reach this frame's allocation through their base instance.
+	const feStreamBuffer* instanceStreamBuffer = nullptr;
+	unsigned int instanceStride = 0;
+
+	const char* debugName = nullptr;
+
+	// Takes the vertex attributes and stride from the FE_VERTEX_LAYOUT of Vertex
+	template<typename Vertex>
+	void SetLayout()
+	{
+		constexpr const auto& layout = feVertexLayoutOf<Vertex>::value;
+		attributeInfos = layout.attributes.data();
+		attributeInfoCount = layout.count;
+		stride = layout.stride;
+	}
+
+	template<typename Instance>
+	void SetInstanceLayout(feBufferObject* buffer)
+	{
+		constexpr const auto& layout = feVertexLayoutOf<Instance>::value;
+		instanceAttributeInfos = layout.attributes.data();
+		instanceAttributeInfoCount = layout.count;
+		instanceBuffer = buffer;
+		instanceStride = layout.stride;
+	}
+
+	template<typename Instance>
+	void SetInstanceLayout(const feStreamBuffer* buffer)
+	{
+		SetInstanceLayout<Instance>(static_cast<feBufferObject*>(nullptr));
+		instanceStreamBuffer = buffer;
+	}
+
+	[[nodiscard]] unsigned int GetInstanceHandle() const
+	{
+		if (instanceBuffer) return instanceBuffer->GetHandle();
+		return instanceStreamBuffer ? instanceStreamBuffer->GetHandle() : 0;
+	}
+};
+
+struct feMeshFormat final
+{
+	size_t index = SIZE_MAX;
+};
+
+struct feMeshAllocation final
+{
+	feMeshFormat format;
+	feHeapAllocation vertices;
+	feHeapAllocation indices;
+	int baseVertex = 0;
+	// Counted in indices of indexType
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	unsigned int indexType = 0;
+
+	[[nodiscard]] bool IsValid() const { return vertices.IsValid() && indices.IsValid(); }
+};
+
+// One large vertex buffer and one large index buffer shared by every mesh, with one vertex array per vertex format
+class feMeshHeap final
+{
+public:
+	feMeshHeap() = default;
+	feMeshHeap(const feMeshHeapCreateInfo& info);
+
+	feMeshHeap(const feMeshHeap&) = delete;
+	feMeshHeap& operator=(const feMeshHeap&) = delete;
+
+	feMeshHeap(feMeshHeap&& other) noexcept = default;
+	feMeshHeap& operator=(feMeshHeap&& other) noexcept = default;
+
+	// Returns the existing format when one with the same layout, instance buffer and mode was already added
+	feMeshFormat AddFormat(const feMeshFormatInfo& info);
+
+	// Returns an invalid allocation when either buffer is out of space. Meshes under 65536 vertices are stored with
+	// 16 bit indices.
+	feMeshAllocation Upload(feMeshFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+	// Runs a copy of the mesh through feMeshOptimizer first. The first attribute of the format is taken as the position
+	// for overdraw ordering when it is three or four floats or halves.
+	feMeshAllocation UploadOptimized(feMeshFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, const char* debugName = nullptr);
+	void Free(const feMeshAllocation& allocation);
+
+	// Meshes of the same format only need the vertex array bound once
+	void Bind(feMeshFormat format) const;
+	// The format has to be bound
+	void Draw(const feMeshAllocation& allocation) const;
+	void DrawInstanced(const feMeshAllocation& allocation, unsigned int instanceCount, unsigned int baseInstance = 0) const;
+
+	// Checks that the format feeds every input the program reads, see feVertexLayoutUtil::Validate
+	bool Validate(feMeshFormat format, const feProgram& program, const char* debugName = nullptr) const;
+
+	[[nodiscard]] const feVertexArray& GetVertexArray(feMeshFormat format) const;
+	[[nodiscard]] const feBufferObject& GetVertexBuffer() const;
+	[[nodiscard]] const feBufferObject& GetIndexBuffer() const;
+private:
+	struct feMeshHeapFormat final
+	{
+		feVertexArray vertexArray;
+		std::vector<feVertexArrayCreateInfoAttributeInfo> attributeInfos;
+		unsigned int stride = 0;
+		uint64_t hash = 0;
+	};
+
+	feBufferObject m_VertexBuffer;
+	feBufferObject m_IndexBuffer;
+	feOffsetAllocator m_VertexAllocator;
+	feOffsetAllocator m_IndexAllocator;
+	std::vector<feMeshHeapFormat> m_Formats;
+};
\ No newline at end of file
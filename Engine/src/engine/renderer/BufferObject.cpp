@@ -6,6 +6,9 @@
 
 #include "../Log.h"
 #include "Util.h"
+#include "RenderState.h"
+
+static bool s_DirectStateAccessEnabled = true;
 
 feBufferObject::feBufferObject(unsigned int handle, unsigned int target)
 	: m_Handle(handle), m_Target(target)
@@ -16,10 +19,19 @@ feBufferObject::feBufferObject(const feBufferObjectCreateInfo& info)
 {
 	m_Target = info.target;
 
-	glGenBuffers(1, &m_Handle);
-	glBindBuffer(m_Target, m_Handle);
-	glBufferData(m_Target, info.size, info.data, GL_STATIC_DRAW);
-	glBindBuffer(m_Target, 0);
+	// Immutable storage cannot be zero sized, those buffers keep the old path
+	if (IsDirectStateAccessSupported() && info.size > 0)
+	{
+		// The usage hint has no equivalent here, dynamic storage keeps SetData working
+		glCreateBuffers(1, &m_Handle);
+		glNamedBufferStorage(m_Handle, info.size, info.data, GL_DYNAMIC_STORAGE_BIT);
+	}
+	else
+	{
+		glGenBuffers(1, &m_Handle);
+		BindForEdit();
+		glBufferData(m_Target, info.size, info.data, info.usage ? info.usage : GL_STATIC_DRAW);
+	}
 
 	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_BUFFER, m_Handle, -1, info.debugName);
 
@@ -32,6 +44,7 @@ feBufferObject::~feBufferObject() noexcept
 	{
 		feLog::Trace("Deleted BufferObject");
 		glDeleteBuffers(1, &m_Handle);
+		feRenderState::OnDeleteBuffer(m_Handle);
 	}
 }
 
@@ -50,5 +63,45 @@ feBufferObject& feBufferObject::operator=(feBufferObject&& other) noexcept
 
 void feBufferObject::Bind() const
 {
-	glBindBuffer(m_Target, m_Handle);
+	feRenderState::BindBuffer(m_Target, m_Handle);
+}
+
+void feBufferObject::BindBase(unsigned int index) const
+{
+	feRenderState::BindBufferBase(m_Target, index, m_Handle);
+}
+
+void feBufferObject::SetData(size_t offset, size_t size, const void* data) const
+{
+	if (IsDirectStateAccessSupported())
+	{
+		glNamedBufferSubData(m_Handle, offset, size, data);
+		return;
+	}
+
+	BindForEdit();
+	glBufferSubData(m_Target, offset, size, data);
+}
+
+unsigned int feBufferObject::GetHandle() const
+{
+	return m_Handle;
+}
+
+bool feBufferObject::IsDirectStateAccessSupported()
+{
+	return s_DirectStateAccessEnabled && feRenderUtil::GetSupportedVersion() >= 45;
+}
+
+void feBufferObject::SetDirectStateAccessEnabled(bool enabled)
+{
+	s_DirectStateAccessEnabled = enabled;
+}
+
+void feBufferObject::BindForEdit() const
+{
+	// Binding an element array buffer would attach it to whatever vertex array is bound
+	if (m_Target == GL_ELEMENT_ARRAY_BUFFER) feRenderState::BindVertexArray(0);
+
+	feRenderState::BindBuffer(m_Target, m_Handle);
 }
\ No newline at end of file
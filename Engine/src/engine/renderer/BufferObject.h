@@ -5,6 +5,8 @@ struct feBufferObjectCreateInfo final
 	unsigned int target = 0;
 	const void* data = nullptr;
 	size_t size = 0;
+	// Defaults to GL_STATIC_DRAW, ignored when the buffer gets immutable storage
+	unsigned int usage = 0;
 
 	const char* debugName = nullptr;
 };
@@ -23,6 +25,17 @@ public:
 	feBufferObject& operator=(feBufferObject&& other) noexcept;
 
 	void Bind() const;
+	void BindBase(unsigned int index) const;
+	void SetData(size_t offset, size_t size, const void* data) const;
+	[[nodiscard]] unsigned int GetHandle() const;
+
+	// GL 4.5 objects are created and edited by name without touching the bindings
+	[[nodiscard]] static bool IsDirectStateAccessSupported();
+	// Forces the bind-to-edit path even on GL 4.5, for comparing the two. Only change it while no buffers or vertex
+	// arrays exist.
+	static void SetDirectStateAccessEnabled(bool enabled);
+private:
+	void BindForEdit() const;
 private:
 	unsigned int m_Handle = 0;
 	unsigned int m_Target = 0;
@@ -0,0 +1,208 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_FRUSTUM_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "../util/ThreadPool.h"
+
+namespace
+{
+	// Writes the visible indices of [begin, end) from out onwards and returns how many there are
+	size_t CullRange(const feFrustum& frustum, const feBoundingSphereArray& spheres, size_t begin, size_t end, uint32_t* out)
+	{
+		const float* centerX = spheres.GetCentersX();
+		const float* centerY = spheres.GetCentersY();
+		const float* centerZ = spheres.GetCentersZ();
+		const float* radii = spheres.GetRadii();
+
+		size_t visible = 0;
+		size_t i = begin;
+
+#ifdef FE_FRUSTUM_CULLER_SSE
+		__m128 planeX[feFrustum::PlaneCount];
+		__m128 planeY[feFrustum::PlaneCount];
+		__m128 planeZ[feFrustum::PlaneCount];
+		__m128 planeW[feFrustum::PlaneCount];
+
+		for (int plane = 0; plane < feFrustum::PlaneCount; ++plane)
+		{
+			planeX[plane] = _mm_set1_ps(frustum.planes[plane].x);
+			planeY[plane] = _mm_set1_ps(frustum.planes[plane].y);
+			planeZ[plane] = _mm_set1_ps(frustum.planes[plane].z);
+			planeW[plane] = _mm_set1_ps(frustum.planes[plane].w);
+		}
+
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(centerX + i);
+			__m128 y = _mm_loadu_ps(centerY + i);
+			__m128 z = _mm_loadu_ps(centerZ + i);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i));
+
+			// A lane stays set while its sphere is not fully behind any plane
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < feFrustum::PlaneCount; ++plane)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[plane], x), _mm_mul_ps(planeY[plane], y)), _mm_add_ps(_mm_mul_ps(planeZ[plane], z), planeW[plane]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+
+			// Always written, only kept by advancing past it
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				out[visible] = static_cast<uint32_t>(i + lane);
+				visible += (mask >> lane) & 1;
+			}
+		}
+#endif
+
+		for (; i < end; ++i)
+		{
+			bool inside = true;
+			for (int plane = 0; plane < feFrustum::PlaneCount; ++plane)
+			{
+				const glm::vec4& p = frustum.planes[plane];
+				float distance = (p.x * centerX[i] + p.y * centerY[i]) + (p.z * centerZ[i] + p.w);
+				inside = inside && distance >= -radii[i];
+			}
+
+			out[visible] = static_cast<uint32_t>(i);
+			visible += inside ? 1 : 0;
+		}
+
+		return visible;
+	}
+}
+
+size_t feBoundingSphereArray::Add(const glm::vec3& center, float radius)
+{
+	m_CenterX.push_back(center.x);
+	m_CenterY.push_back(center.y);
+	m_CenterZ.push_back(center.z);
+	m_Radius.push_back(radius);
+
+	return m_Radius.size() - 1;
+}
+
+void feBoundingSphereArray::Set(size_t index, const glm::vec3& center, float radius)
+{
+	m_CenterX[index] = center.x;
+	m_CenterY[index] = center.y;
+	m_CenterZ[index] = center.z;
+	m_Radius[index] = radius;
+}
+
+void feBoundingSphereArray::Reserve(size_t capacity)
+{
+	m_CenterX.reserve(capacity);
+	m_CenterY.reserve(capacity);
+	m_CenterZ.reserve(capacity);
+	m_Radius.reserve(capacity);
+}
+
+void feBoundingSphereArray::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_Radius.clear();
+}
+
+size_t feBoundingSphereArray::GetCount() const
+{
+	return m_Radius.size();
+}
+
+glm::vec3 feBoundingSphereArray::GetCenter(size_t index) const
+{
+	return glm::vec3(m_CenterX[index], m_CenterY[index], m_CenterZ[index]);
+}
+
+float feBoundingSphereArray::GetRadius(size_t index) const
+{
+	return m_Radius[index];
+}
+
+const float* feBoundingSphereArray::GetCentersX() const
+{
+	return m_CenterX.data();
+}
+
+const float* feBoundingSphereArray::GetCentersY() const
+{
+	return m_CenterY.data();
+}
+
+const float* feBoundingSphereArray::GetCentersZ() const
+{
+	return m_CenterZ.data();
+}
+
+const float* feBoundingSphereArray::GetRadii() const
+{
+	return m_Radius.data();
+}
+
+feFrustumCuller::feFrustumCuller(const feFrustumCullerCreateInfo& info)
+	: m_Info(info)
+{
+	m_Info.chunkSize = std::max<size_t>(m_Info.chunkSize, 4);
+}
+
+size_t feFrustumCuller::Cull(const feFrustum& frustum, const feBoundingSphereArray& spheres, std::vector<uint32_t>& visible)
+{
+	size_t count = spheres.GetCount();
+	size_t chunkSize = std::max<size_t>(m_Info.chunkSize, 4);
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	// Every chunk may keep all of its spheres, so each gets its full range of the output first
+	visible.resize(count);
+
+	if (!m_Info.threadPool || chunkCount < 2)
+	{
+		visible.resize(CullRange(frustum, spheres, 0, count, visible.data()));
+	}
+	else
+	{
+		m_ChunkCounts.resize(chunkCount);
+
+		m_Info.threadPool->ParallelFor(chunkCount, 1, [&](size_t beginChunk, size_t endChunk)
+		{
+			for (size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+			{
+				size_t begin = chunk * chunkSize;
+				size_t end = std::min(begin + chunkSize, count);
+				m_ChunkCounts[chunk] = CullRange(frustum, spheres, begin, end, visible.data() + begin);
+			}
+		});
+
+		// Chunks only move towards the front, so copying them in order never overwrites one still to be moved. While
+		// every earlier chunk kept all of its spheres a chunk is already in place, and std::copy may not start its
+		// output inside its input.
+		size_t written = m_ChunkCounts[0];
+		for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+		{
+			size_t begin = chunk * chunkSize;
+			if (written < begin) std::copy(visible.data() + begin, visible.data() + begin + m_ChunkCounts[chunk], visible.data() + written);
+			written += m_ChunkCounts[chunk];
+		}
+
+		visible.resize(written);
+	}
+
+	m_Stats.tested = count;
+	m_Stats.visible = visible.size();
+	m_Stats.culled = count - visible.size();
+	return visible.size();
+}
+
+const feFrustumCullerStats& feFrustumCuller::GetFrameStats() const
+{
+	return m_Stats;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "../math/Frustum.h"
+
+class feThreadPool;
+
+// Bounding spheres with one array per component, so the culler loads four of them at once
+class feBoundingSphereArray final
+{
+public:
+	// Returns the index of the new sphere
+	size_t Add(const glm::vec3& center, float radius);
+	void Set(size_t index, const glm::vec3& center, float radius);
+	void Reserve(size_t capacity);
+	void Clear();
+
+	[[nodiscard]] size_t GetCount() const;
+	[[nodiscard]] glm::vec3 GetCenter(size_t index) const;
+	[[nodiscard]] float GetRadius(size_t index) const;
+
+	[[nodiscard]] const float* GetCentersX() const;
+	[[nodiscard]] const float* GetCentersY() const;
+	[[nodiscard]] const float* GetCentersZ() const;
+	[[nodiscard]] const float* GetRadii() const;
+private:
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_Radius;
+};
+
+struct feFrustumCullerCreateInfo final
+{
+	// Large sets are split across the pool when set
+	feThreadPool* threadPool = nullptr;
+	// Spheres per job, the visible indices of each job are compacted after all of them finish
+	size_t chunkSize = 4096;
+};
+
+struct feFrustumCullerStats final
+{
+	size_t tested = 0;
+	size_t visible = 0;
+	size_t culled = 0;
+};
+
+// Tests bounding spheres against the six frustum planes four at a time with SSE2, with a scalar fallback
+class feFrustumCuller final
+{
+public:
+	feFrustumCuller() = default;
+	feFrustumCuller(const feFrustumCullerCreateInfo& info);
+
+	// Writes the indices of the spheres touching the frustum to visible in increasing order and returns how many
+	// there are. visible is resized to fit.
+	size_t Cull(const feFrustum& frustum, const feBoundingSphereArray& spheres, std::vector<uint32_t>& visible);
+
+	// Of the last Cull
+	[[nodiscard]] const feFrustumCullerStats& GetFrameStats() const;
+private:
+	feFrustumCullerCreateInfo m_Info;
+	// Visible count of every chunk, their indices start at the chunk's first sphere until they are compacted
+	std::vector<size_t> m_ChunkCounts;
+	feFrustumCullerStats m_Stats;
+};
\ No newline at end of file
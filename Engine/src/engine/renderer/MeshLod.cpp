@@ -0,0 +1,145 @@
+#include "MeshLod.h"
+
+#include <cfloat>
+
+#include <glm/gtc/constants.hpp>
+
+#include "../Log.h"
+#include "../util/SphereGenerator.h"
+#include "../util/SphereMeshes.h"
+
+void feMeshLodChain::AddLevel(const feMeshAllocation& mesh, float minScreenSize, float inscribedRadius)
+{
+	if (!m_Levels.empty())
+	{
+		if (m_Levels.front().mesh.format.index != mesh.format.index)
+		{
+			feLog::Error("LOD levels have to share a mesh format");
+			return;
+		}
+
+		if (m_Levels.back().minScreenSize < minScreenSize) feLog::Warn("LOD level {} has a larger screen size than the level before it", m_Levels.size());
+	}
+
+	feMeshLodLevel level;
+	level.mesh = mesh;
+	level.minScreenSize = minScreenSize;
+	level.inscribedRadius = inscribedRadius;
+	m_Levels.push_back(level);
+}
+
+void feMeshLodChain::Free(feMeshHeap& heap)
+{
+	for (const feMeshLodLevel& level : m_Levels) heap.Free(level.mesh);
+	m_Levels.clear();
+}
+
+size_t feMeshLodChain::GetLevelCount() const
+{
+	return m_Levels.size();
+}
+
+const feMeshLodLevel& feMeshLodChain::GetLevel(size_t level) const
+{
+	return m_Levels[level];
+}
+
+const feMeshAllocation& feMeshLodChain::GetMesh(size_t level) const
+{
+	return m_Levels[level].mesh;
+}
+
+feMeshFormat feMeshLodChain::GetFormat() const
+{
+	return m_Levels.empty() ? feMeshFormat() : m_Levels.front().mesh.format;
+}
+
+bool feMeshLodChain::IsValid() const
+{
+	return !m_Levels.empty();
+}
+
+namespace feMeshLod
+{
+	feMeshLodChain UploadSphere(feMeshHeap& heap, feMeshFormat format, const feSphereGeneratorInfo& info, size_t levelCount, float maxEdgePixels)
+	{
+		feMeshLodChain chain;
+		chain.boundingRadius = info.radius;
+
+		std::vector<Sphere::PackedVertex> vertices;
+		std::vector<float> positions;
+		std::vector<unsigned int> indices;
+
+		feSphereGeneratorInfo levelInfo = info;
+
+		for (size_t i = 0; i < levelCount; ++i)
+		{
+			vertices.resize(feSphereGenerator::GetVertexCount(levelInfo));
+			positions.resize(vertices.size() * 8);
+			indices.resize(feSphereGenerator::GetIndexCount(levelInfo));
+
+			// Both write the same indices
+			feSphereGenerator::Generate(levelInfo, positions.data(), indices.data());
+			float inscribedRadius = levelInfo.radius - feSphereMeshes::MaxError(positions.data(), 8, indices.data(), indices.size(), levelInfo.radius);
+			feSphereGenerator::GeneratePacked(levelInfo, vertices.data(), indices.data());
+
+			feMeshAllocation mesh = heap.UploadOptimized(format, vertices.data(), vertices.size(), indices.data(), indices.size(), "Sphere LOD");
+			if (!mesh.IsValid())
+			{
+				feLog::Error("Sphere LOD level {} did not fit in the mesh heap", i);
+				break;
+			}
+
+			feSphereGeneratorInfo nextInfo = levelInfo;
+			nextInfo.sectorCount = levelInfo.sectorCount / 2 < 3 ? 3 : levelInfo.sectorCount / 2;
+			nextInfo.stackCount = levelInfo.stackCount / 2 < 2 ? 2 : levelInfo.stackCount / 2;
+
+			bool last = i + 1 == levelCount || (nextInfo.sectorCount == levelInfo.sectorCount && nextInfo.stackCount == levelInfo.stackCount);
+
+			// The next level takes over once its edges, a circumference split into its sectors, are short enough
+			float minScreenSize = last ? 0.0f : maxEdgePixels * nextInfo.sectorCount / glm::pi<float>();
+			chain.AddLevel(mesh, minScreenSize, inscribedRadius);
+
+			if (last) break;
+			levelInfo = nextInfo;
+		}
+
+		return chain;
+	}
+}
+
+void feLodSelector::SetProjection(const glm::mat4& projection, int viewportHeight)
+{
+	// projection[1][1] is cot(fovy / 2) for perspective and 2 / height for orthographic projections
+	m_Perspective = projection[2][3] != 0.0f;
+	m_Scale = projection[1][1] * static_cast<float>(viewportHeight);
+}
+
+float feLodSelector::GetScreenSize(float radius, float distance) const
+{
+	if (!m_Perspective) return radius * m_Scale;
+
+	// Inside the bounding sphere it covers the whole screen
+	if (distance <= radius) return FLT_MAX;
+
+	return radius * m_Scale / distance;
+}
+
+size_t feLodSelector::Select(const feMeshLodChain& chain, float screenSize, size_t current) const
+{
+	size_t count = chain.GetLevelCount();
+	if (count == 0) return 0;
+
+	size_t level = current < count ? current : 0;
+
+	// A finer level has to be clearly needed, a coarser one clearly enough
+	while (level > 0 && screenSize > chain.GetLevel(level - 1).minScreenSize * (1.0f + hysteresis)) --level;
+	while (level + 1 < count && screenSize < chain.GetLevel(level).minScreenSize * (1.0f - hysteresis)) ++level;
+
+	return level;
+}
+
+size_t feLodSelector::Select(const feMeshLodChain& chain, float radius, float distance, size_t current) const
+{
+	return Select(chain, GetScreenSize(radius, distance), current);
+}
\ No newline at end of file
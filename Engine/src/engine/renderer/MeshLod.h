@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BufferHeap.h"
+
+struct feSphereGeneratorInfo;
+
+struct feMeshLodLevel final
+{
+	feMeshAllocation mesh;
+	// Smallest projected diameter in pixels this level is drawn at, the last level has 0
+	float minScreenSize = 0.0f;
+	// Largest sphere around the origin that stays inside the mesh, 0 when unknown
+	float inscribedRadius = 0.0f;
+};
+
+// Levels from most to least detailed, all in one heap format. Switching level only changes the draw range, the
+// vertex array and buffers stay bound.
+class feMeshLodChain final
+{
+public:
+	// Levels have to be added from most to least detailed with decreasing minScreenSize
+	void AddLevel(const feMeshAllocation& mesh, float minScreenSize, float inscribedRadius = 0.0f);
+	void Free(feMeshHeap& heap);
+
+	[[nodiscard]] size_t GetLevelCount() const;
+	[[nodiscard]] const feMeshLodLevel& GetLevel(size_t level) const;
+	[[nodiscard]] const feMeshAllocation& GetMesh(size_t level) const;
+	[[nodiscard]] feMeshFormat GetFormat() const;
+	[[nodiscard]] bool IsValid() const;
+public:
+	// Bounding sphere of the most detailed level in model space
+	float boundingRadius = 0.0f;
+private:
+	std::vector<feMeshLodLevel> m_Levels;
+};
+
+namespace feMeshLod
+{
+	// Halves the sector and stack counts of info for every level after the first. A level is kept while its edges stay
+	// under maxEdgePixels long on screen. Inscribed radii are measured on the float positions, the heap stores halves
+	// that can lie a rounding step inside them.
+	feMeshLodChain UploadSphere(feMeshHeap& heap, feMeshFormat format, const feSphereGeneratorInfo& info, size_t levelCount, float maxEdgePixels = 12.0f);
+}
+
+// Picks chain levels from the projected size of a bounding sphere
+class feLodSelector final
+{
+public:
+	// Call once per frame with the camera projection and the viewport height in pixels
+	void SetProjection(const glm::mat4& projection, int viewportHeight);
+
+	// Projected diameter in pixels of a sphere of radius at distance from the camera
+	[[nodiscard]] float GetScreenSize(float radius, float distance) const;
+
+	// current is the level picked last frame, or SIZE_MAX the first time. A level only changes once the size is
+	// hysteresis past the threshold so objects near it do not pop back and forth.
+	[[nodiscard]] size_t Select(const feMeshLodChain& chain, float screenSize, size_t current) const;
+	[[nodiscard]] size_t Select(const feMeshLodChain& chain, float radius, float distance, size_t current) const;
+public:
+	// Fraction of the threshold
+	float hysteresis = 0.15f;
+private:
+	// Pixels per unit of radius at distance 1, or at any distance for orthographic projections
+	float m_Scale = 0.0f;
+	bool m_Perspective = true;
+};
\ No newline at end of file
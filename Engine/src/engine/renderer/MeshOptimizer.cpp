@@ -0,0 +1,407 @@
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+
+#include "../Log.h"
+#include "../util/Pack.h"
+
+namespace
+{
+	// Forsyth's tuning, the modelled LRU cache is larger than real FIFO caches on purpose
+	constexpr size_t ForsythCacheSize = 32;
+	constexpr float ForsythCacheDecayPower = 1.5f;
+	constexpr float ForsythLastTriangleScore = 0.75f;
+	constexpr float ForsythValenceBoostScale = 2.0f;
+	constexpr float ForsythValenceBoostPower = 0.5f;
+	constexpr size_t ForsythValenceTableSize = 32;
+
+	// Cache used to find cluster boundaries in the overdraw pass
+	constexpr size_t OverdrawCacheSize = 16;
+
+	struct ForsythTables final
+	{
+		float cache[ForsythCacheSize];
+		float valence[ForsythValenceTableSize];
+
+		ForsythTables()
+		{
+			for (size_t i = 0; i < ForsythCacheSize; ++i)
+			{
+				// The last triangle's vertices get a fixed score so the next triangle does not just reuse its edge
+				if (i < 3) cache[i] = ForsythLastTriangleScore;
+				else cache[i] = std::pow(1.0f - static_cast<float>(i - 3) / (ForsythCacheSize - 3), ForsythCacheDecayPower);
+			}
+
+			valence[0] = 0.0f;
+			for (size_t i = 1; i < ForsythValenceTableSize; ++i)
+			{
+				valence[i] = ForsythValenceBoostScale * std::pow(static_cast<float>(i), -ForsythValenceBoostPower);
+			}
+		}
+	};
+
+	float ForsythVertexScore(const ForsythTables& tables, int cachePosition, unsigned int remaining)
+	{
+		// No triangles left to use the vertex
+		if (remaining == 0) return -1.0f;
+
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+
+		if (remaining < ForsythValenceTableSize) score += tables.valence[remaining];
+		else score += ForsythValenceBoostScale * std::pow(static_cast<float>(remaining), -ForsythValenceBoostPower);
+
+		return score;
+	}
+
+	// FIFO cache through timestamps, a vertex is cached while fewer than cacheSize misses happened since its own.
+	// Returns the misses of the triangle.
+	unsigned int UpdateFifoCache(const unsigned int* triangle, std::vector<size_t>& timestamps, size_t& timestamp, size_t cacheSize)
+	{
+		unsigned int misses = 0;
+
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int vertex = triangle[k];
+			if (timestamp - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = timestamp++;
+				++misses;
+			}
+		}
+
+		return misses;
+	}
+}
+
+namespace feMeshOptimizer
+{
+	size_t Optimize(const feMeshOptimizerInfo& info, feMeshOptimizerStats* stats)
+	{
+		if (!info.vertices || !info.indices || info.indexCount % 3 != 0)
+		{
+			feLog::Error("Mesh optimizer needs vertices and a triangle list");
+			return info.vertexCount;
+		}
+
+		feMeshOptimizerStats result;
+		result.vertexCountBefore = info.vertexCount;
+		result.before = AnalyzeVertexCache(info.indices, info.indexCount, info.vertexCount);
+
+		std::vector<unsigned int> scratch = std::vector<unsigned int>(info.indexCount);
+
+		OptimizeVertexCache(scratch.data(), info.indices, info.indexCount, info.vertexCount);
+
+		if (info.overdrawThreshold > 0.0f)
+		{
+			std::vector<float> positions = std::vector<float>(info.vertexCount * 3);
+			const unsigned char* vertices = static_cast<const unsigned char*>(info.vertices);
+
+			for (size_t i = 0; i < info.vertexCount; ++i)
+			{
+				const unsigned char* position = vertices + i * info.vertexSize + info.positionOffset;
+
+				if (info.positionType == feVertexLayoutType::HalfFloat)
+				{
+					uint16_t halves[3];
+					std::memcpy(halves, position, sizeof(halves));
+					for (int k = 0; k < 3; ++k) positions[i * 3 + k] = fePack::FloatFromHalf(halves[k]);
+				}
+				else
+				{
+					std::memcpy(positions.data() + i * 3, position, 3 * sizeof(float));
+				}
+			}
+
+			OptimizeOverdraw(info.indices, scratch.data(), info.indexCount, positions.data(), 3 * sizeof(float), info.vertexCount, info.overdrawThreshold);
+		}
+		else
+		{
+			std::copy(scratch.begin(), scratch.end(), info.indices);
+		}
+
+		std::vector<unsigned char> vertices = std::vector<unsigned char>(static_cast<const unsigned char*>(info.vertices), static_cast<const unsigned char*>(info.vertices) + info.vertexCount * info.vertexSize);
+		result.vertexCountAfter = OptimizeVertexFetch(info.vertices, info.indices, info.indexCount, vertices.data(), info.vertexCount, info.vertexSize);
+		result.after = AnalyzeVertexCache(info.indices, info.indexCount, result.vertexCountAfter);
+
+		if (info.debugName)
+		{
+			feLog::Debug("{}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} vertices", info.debugName, result.before.acmr, result.after.acmr, result.before.atvr, result.after.atvr, result.vertexCountBefore, result.vertexCountAfter);
+		}
+
+		if (stats) *stats = result;
+		return result.vertexCountAfter;
+	}
+
+	void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+	{
+		static const ForsythTables tables;
+
+		size_t triangleCount = indexCount / 3;
+
+		// Triangles of every vertex, each list shrinks as its triangles are emitted
+		std::vector<unsigned int> remaining = std::vector<unsigned int>(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; ++i) ++remaining[indices[i]];
+
+		std::vector<unsigned int> offsets = std::vector<unsigned int>(vertexCount + 1, 0);
+		for (size_t i = 0; i < vertexCount; ++i) offsets[i + 1] = offsets[i] + remaining[i];
+
+		std::vector<unsigned int> adjacency = std::vector<unsigned int>(indexCount);
+		{
+			std::vector<unsigned int> fill = std::vector<unsigned int>(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i) adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		std::vector<int> cachePositions = std::vector<int>(vertexCount, -1);
+		std::vector<float> scores = std::vector<float>(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i) scores[i] = ForsythVertexScore(tables, -1, remaining[i]);
+
+		std::vector<bool> emitted = std::vector<bool>(triangleCount, false);
+
+		unsigned int cache[ForsythCacheSize + 3];
+		size_t cacheCount = 0;
+
+		size_t cursor = 0;
+		size_t best = SIZE_MAX;
+
+		for (size_t output = 0; output < triangleCount; ++output)
+		{
+			// Nothing in the cache has triangles left, continue with the next unused one in input order
+			if (best == SIZE_MAX)
+			{
+				while (emitted[cursor]) ++cursor;
+				best = cursor;
+			}
+
+			const unsigned int* triangle = indices + best * 3;
+			destination[output * 3 + 0] = triangle[0];
+			destination[output * 3 + 1] = triangle[1];
+			destination[output * 3 + 2] = triangle[2];
+			emitted[best] = true;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int vertex = triangle[k];
+				unsigned int* list = adjacency.data() + offsets[vertex];
+
+				for (unsigned int j = 0; j < remaining[vertex]; ++j)
+				{
+					if (list[j] != best) continue;
+
+					list[j] = list[remaining[vertex] - 1];
+					--remaining[vertex];
+					break;
+				}
+			}
+
+			// The triangle's vertices move to the front, everything else shifts back
+			unsigned int newCache[ForsythCacheSize + 3];
+			size_t newCount = 0;
+			newCache[newCount++] = triangle[0];
+			newCache[newCount++] = triangle[1];
+			newCache[newCount++] = triangle[2];
+
+			for (size_t i = 0; i < cacheCount; ++i)
+			{
+				unsigned int vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) newCache[newCount++] = vertex;
+			}
+
+			for (size_t i = 0; i < newCount; ++i)
+			{
+				unsigned int vertex = newCache[i];
+				cachePositions[vertex] = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+				scores[vertex] = ForsythVertexScore(tables, cachePositions[vertex], remaining[vertex]);
+			}
+
+			cacheCount = newCount < ForsythCacheSize ? newCount : ForsythCacheSize;
+			std::memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+
+			// Only triangles touching the cache changed score, the best one among them goes next
+			best = SIZE_MAX;
+			float bestScore = -1.0f;
+
+			for (size_t i = 0; i < cacheCount; ++i)
+			{
+				unsigned int vertex = cache[i];
+				const unsigned int* list = adjacency.data() + offsets[vertex];
+
+				for (unsigned int j = 0; j < remaining[vertex]; ++j)
+				{
+					const unsigned int* candidate = indices + list[j] * 3;
+					float score = scores[candidate[0]] + scores[candidate[1]] + scores[candidate[2]];
+
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = list[j];
+					}
+				}
+			}
+		}
+	}
+
+	void OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride, size_t vertexCount, float threshold)
+	{
+		size_t triangleCount = indexCount / 3;
+		size_t floatStride = positionStride / sizeof(float);
+
+		if (triangleCount == 0) return;
+
+		std::vector<size_t> timestamps = std::vector<size_t>(vertexCount, 0);
+		// Starting past the cache size makes every vertex a miss at first
+		size_t timestamp = OverdrawCacheSize + 1;
+
+		// Hard boundaries, a triangle that misses on all three vertices starts a disjoint patch
+		std::vector<size_t> hardClusters;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			unsigned int misses = UpdateFifoCache(indices + i * 3, timestamps, timestamp, OverdrawCacheSize);
+			if (i == 0 || misses == 3) hardClusters.push_back(i);
+		}
+
+		hardClusters.push_back(triangleCount);
+
+		// Soft boundaries, a patch is cut wherever its running ACMR is already within threshold of the whole patch
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+		{
+			size_t start = hardClusters[c];
+			size_t end = hardClusters[c + 1];
+
+			timestamp += OverdrawCacheSize + 1;
+
+			size_t clusterMisses = 0;
+			for (size_t i = start; i < end; ++i) clusterMisses += UpdateFifoCache(indices + i * 3, timestamps, timestamp, OverdrawCacheSize);
+
+			float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+			clusters.push_back(start);
+			timestamp += OverdrawCacheSize + 1;
+
+			size_t runningMisses = 0;
+			size_t runningTriangles = 0;
+
+			for (size_t i = start; i < end; ++i)
+			{
+				runningMisses += UpdateFifoCache(indices + i * 3, timestamps, timestamp, OverdrawCacheSize);
+				++runningTriangles;
+
+				if (i + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold)
+				{
+					clusters.push_back(i + 1);
+
+					// The next cluster may be drawn anywhere, it can not count on this one's vertices being cached
+					timestamp += OverdrawCacheSize + 1;
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+		}
+
+		size_t clusterCount = clusters.size();
+		clusters.push_back(triangleCount);
+
+		auto position = [positions, floatStride](unsigned int vertex)
+		{
+			const float* p = positions + vertex * floatStride;
+			return glm::vec3(p[0], p[1], p[2]);
+		};
+
+		glm::vec3 meshCentroid = glm::vec3(0.0f);
+		for (size_t i = 0; i < vertexCount; ++i) meshCentroid += position(static_cast<unsigned int>(i));
+		if (vertexCount > 0) meshCentroid /= static_cast<float>(vertexCount);
+
+		// Clusters facing away from the centre occlude the rest of the mesh and are drawn first
+		std::vector<float> sortKeys = std::vector<float>(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			glm::vec3 centroid = glm::vec3(0.0f);
+			glm::vec3 normal = glm::vec3(0.0f);
+			float area = 0.0f;
+
+			for (size_t i = clusters[c]; i < clusters[c + 1]; ++i)
+			{
+				glm::vec3 p0 = position(indices[i * 3 + 0]);
+				glm::vec3 p1 = position(indices[i * 3 + 1]);
+				glm::vec3 p2 = position(indices[i * 3 + 2]);
+
+				// Twice the area, area weighted by its length
+				glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(triangleNormal);
+
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += triangleNormal;
+				area += triangleArea;
+			}
+
+			float normalLength = glm::length(normal);
+			if (area > 0.0f) centroid /= area;
+			if (normalLength > 0.0f) normal /= normalLength;
+
+			sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+		}
+
+		std::vector<size_t> order = std::vector<size_t>(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		size_t output = 0;
+		for (size_t c : order)
+		{
+			size_t first = clusters[c] * 3;
+			size_t last = clusters[c + 1] * 3;
+			std::copy(indices + first, indices + last, destination + output);
+			output += last - first;
+		}
+	}
+
+	size_t OptimizeVertexFetch(void* destination, unsigned int* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize)
+	{
+		std::vector<unsigned int> remap = std::vector<unsigned int>(vertexCount, UINT32_MAX);
+
+		unsigned char* out = static_cast<unsigned char*>(destination);
+		const unsigned char* in = static_cast<const unsigned char*>(vertices);
+		unsigned int next = 0;
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			unsigned int vertex = indices[i];
+
+			if (remap[vertex] == UINT32_MAX)
+			{
+				std::memcpy(out + static_cast<size_t>(next) * vertexSize, in + static_cast<size_t>(vertex) * vertexSize, vertexSize);
+				remap[vertex] = next++;
+			}
+
+			indices[i] = remap[vertex];
+		}
+
+		return next;
+	}
+
+	feMeshCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+	{
+		feMeshCacheStats stats;
+
+		std::vector<size_t> timestamps = std::vector<size_t>(vertexCount, 0);
+		size_t timestamp = cacheSize + 1;
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3) stats.transforms += UpdateFifoCache(indices + i, timestamps, timestamp, cacheSize);
+
+		size_t usedVertices = 0;
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			if (timestamps[i] != 0) ++usedVertices;
+		}
+
+		if (indexCount >= 3) stats.acmr = static_cast<float>(stats.transforms) / static_cast<float>(indexCount / 3);
+		if (usedVertices > 0) stats.atvr = static_cast<float>(stats.transforms) / static_cast<float>(usedVertices);
+
+		return stats;
+	}
+}
\ No newline at end of file
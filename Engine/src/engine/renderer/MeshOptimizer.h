@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+#include "VertexLayout.h"
+
+struct feMeshCacheStats final
+{
+	// Vertex shader invocations per triangle, 0.5 is the ideal for large regular meshes and 3 the worst case
+	float acmr = 0.0f;
+	// Vertex shader invocations per referenced vertex, 1 is the ideal
+	float atvr = 0.0f;
+	size_t transforms = 0;
+};
+
+struct feMeshOptimizerStats final
+{
+	feMeshCacheStats before;
+	feMeshCacheStats after;
+	size_t vertexCountBefore = 0;
+	size_t vertexCountAfter = 0;
+};
+
+struct feMeshOptimizerInfo final
+{
+	// Rewritten in place
+	void* vertices = nullptr;
+	size_t vertexCount = 0;
+	size_t vertexSize = 0;
+	unsigned int* indices = nullptr;
+	size_t indexCount = 0;
+
+	// Three components of positionType, Float or HalfFloat, read for the overdraw ordering
+	unsigned int positionOffset = 0;
+	unsigned int positionType = feVertexLayoutType::Float;
+
+	// How much worse than the cache optimised order the overdraw order may make the ACMR, 0 skips the pass
+	float overdrawThreshold = 1.05f;
+
+	// Logs the statistics when set
+	const char* debugName = nullptr;
+};
+
+// Reorders triangle lists for the post-transform vertex cache, for early depth rejection and for vertex fetch
+// locality. Meant for load time or offline processing, every pass allocates scratch memory.
+namespace feMeshOptimizer
+{
+	// Runs the three passes below in order and returns the new vertex count, vertices no triangle uses are removed
+	size_t Optimize(const feMeshOptimizerInfo& info, feMeshOptimizerStats* stats = nullptr);
+
+	// Forsyth's linear speed vertex cache optimisation, destination can not alias indices
+	void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Splits the cache optimised order into clusters and sorts them so outward facing ones come first, as in Sander et
+	// al. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw". destination can not alias indices.
+	void OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride, size_t vertexCount, float threshold = 1.05f);
+
+	// Moves vertices into the order the indices first use them and remaps the indices in place. destination can not
+	// alias vertices. Returns the number of vertices written.
+	size_t OptimizeVertexFetch(void* destination, unsigned int* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize);
+
+	// Simulates a FIFO post-transform cache, 16 entries is typical of current hardware
+	feMeshCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+}
\ No newline at end of file
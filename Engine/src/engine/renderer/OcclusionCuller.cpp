@@ -0,0 +1,399 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_OCCLUSION_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "FrustumCuller.h"
+#include "../util/ThreadPool.h"
+
+namespace
+{
+	// Vertices closer to the camera plane than this, or in front of the near plane, are dropped with their triangles.
+	// Occluders only need to be conservative so they are never clipped.
+	constexpr float MinClipW = 1e-5f;
+	// Spheres per job when testing
+	constexpr size_t TestChunkSize = 1024;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+feOcclusionCuller::feOcclusionCuller(const feOcclusionCullerCreateInfo& info)
+	: m_Info(info)
+{
+	m_TilesX = std::max((m_Info.width + TileWidth - 1) / TileWidth, 1);
+	m_TilesY = std::max((m_Info.height + TileHeight - 1) / TileHeight, 1);
+	m_Info.width = m_TilesX * TileWidth;
+	m_Info.height = m_TilesY * TileHeight;
+
+	m_TileBins.resize(static_cast<size_t>(m_TilesX) * m_TilesY);
+	m_Depth.assign(static_cast<size_t>(m_Info.width) * m_Info.height, 1.0f);
+
+	// Levels halve until a single texel is left, odd sizes round up so no pixel is dropped
+	int levelWidth = m_Info.width;
+	int levelHeight = m_Info.height;
+	while (levelWidth > 1 || levelHeight > 1)
+	{
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+		m_Levels.emplace_back(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+	}
+}
+
+void feOcclusionCuller::Begin(const glm::mat4& viewProj)
+{
+	m_ViewProj = viewProj;
+	m_Triangles.clear();
+	for (std::vector<uint32_t>& bin : m_TileBins) bin.clear();
+
+	m_Stats = feOcclusionCullerStats();
+}
+
+void feOcclusionCuller::AddOccluder(const float* positions, size_t strideFloats, const unsigned int* indices, size_t indexCount, const glm::mat4& model)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	glm::mat4 modelViewProj = m_ViewProj * model;
+
+	size_t vertexCount = 0;
+	for (size_t i = 0; i < indexCount; ++i) vertexCount = std::max<size_t>(vertexCount, indices[i] + 1);
+
+	m_ClipVertices.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const float* position = positions + i * strideFloats;
+		m_ClipVertices[i] = modelViewProj * glm::vec4(position[0], position[1], position[2], 1.0f);
+	}
+
+	float width = static_cast<float>(m_Info.width);
+	float height = static_cast<float>(m_Info.height);
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec3 screen[3];
+		bool behind = false;
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const glm::vec4& clip = m_ClipVertices[indices[i + corner]];
+			behind = behind || clip.w < MinClipW || clip.z < -clip.w;
+
+			float inverseW = 1.0f / clip.w;
+			screen[corner] = glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height, clip.z * inverseW);
+		}
+
+		if (behind) continue;
+
+		// Twice the signed area, back faces are always farther than the front faces of a closed occluder
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+		if (!(area > 0.0f)) continue;
+
+		float minX = std::min({ screen[0].x, screen[1].x, screen[2].x });
+		float minY = std::min({ screen[0].y, screen[1].y, screen[2].y });
+		float maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+		float maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+
+		// Clamped as floats first, huge triangles would overflow the ints
+		feOcclusionTriangle triangle;
+		triangle.minX = static_cast<int>(std::floor(std::clamp(minX, 0.0f, width)));
+		triangle.minY = static_cast<int>(std::floor(std::clamp(minY, 0.0f, height)));
+		triangle.maxX = static_cast<int>(std::ceil(std::clamp(maxX, 0.0f, width)));
+		triangle.maxY = static_cast<int>(std::ceil(std::clamp(maxY, 0.0f, height)));
+
+		if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) continue;
+
+		// Edge i is opposite corner i and positive inside, so it doubles as the barycentric weight of that corner
+		float inverseArea = 1.0f / area;
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const glm::vec3& from = screen[(edge + 1) % 3];
+			const glm::vec3& to = screen[(edge + 2) % 3];
+
+			triangle.edgeA[edge] = from.y - to.y;
+			triangle.edgeB[edge] = to.x - from.x;
+			triangle.edgeC[edge] = from.x * to.y - from.y * to.x;
+		}
+
+		triangle.depthA = (triangle.edgeA[0] * screen[0].z + triangle.edgeA[1] * screen[1].z + triangle.edgeA[2] * screen[2].z) * inverseArea;
+		triangle.depthB = (triangle.edgeB[0] * screen[0].z + triangle.edgeB[1] * screen[1].z + triangle.edgeB[2] * screen[2].z) * inverseArea;
+		triangle.depthC = (triangle.edgeC[0] * screen[0].z + triangle.edgeC[1] * screen[1].z + triangle.edgeC[2] * screen[2].z) * inverseArea;
+
+		// Texels are tested at their centers, moving every edge in by half a texel only passes texels the triangle
+		// covers completely. Their depth is raised to the farthest corner, so the depth buffer never reaches past the
+		// occluder on screen or in depth.
+		for (int edge = 0; edge < 3; ++edge) triangle.edgeC[edge] -= 0.5f * (std::abs(triangle.edgeA[edge]) + std::abs(triangle.edgeB[edge]));
+		triangle.depthC += 0.5f * (std::abs(triangle.depthA) + std::abs(triangle.depthB));
+
+		uint32_t index = static_cast<uint32_t>(m_Triangles.size());
+		m_Triangles.push_back(triangle);
+
+		int tileMaxX = (triangle.maxX - 1) / TileWidth;
+		int tileMaxY = (triangle.maxY - 1) / TileHeight;
+		for (int tileY = triangle.minY / TileHeight; tileY <= tileMaxY; ++tileY)
+		{
+			for (int tileX = triangle.minX / TileWidth; tileX <= tileMaxX; ++tileX) m_TileBins[tileY * m_TilesX + tileX].push_back(index);
+		}
+	}
+
+	++m_Stats.occluders;
+	m_Stats.triangles += indexCount / 3;
+	m_Stats.rasterizeMilliseconds += MillisecondsSince(start);
+}
+
+void feOcclusionCuller::Rasterize()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	int tileCount = m_TilesX * m_TilesY;
+
+	if (m_Info.threadPool)
+	{
+		m_Info.threadPool->ParallelFor(static_cast<size_t>(tileCount), 1, [this](size_t begin, size_t end)
+		{
+			for (size_t tile = begin; tile < end; ++tile) RasterizeTile(static_cast<int>(tile));
+		});
+	}
+	else
+	{
+		for (int tile = 0; tile < tileCount; ++tile) RasterizeTile(tile);
+	}
+
+	BuildPyramid();
+
+	m_Stats.rasterized = m_Triangles.size();
+	m_Stats.rasterizeMilliseconds += MillisecondsSince(start);
+}
+
+bool feOcclusionCuller::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+	// The corners of the bounding box are the clip space center plus or minus each scaled axis
+	glm::vec4 clipCenter = m_ViewProj * glm::vec4(center, 1.0f);
+	glm::vec4 axes[3] = { m_ViewProj[0] * radius, m_ViewProj[1] * radius, m_ViewProj[2] * radius };
+
+	float minX = FLT_MAX, minY = FLT_MAX, minDepth = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec4 clip = clipCenter;
+		clip += (corner & 1) ? axes[0] : -axes[0];
+		clip += (corner & 2) ? axes[1] : -axes[1];
+		clip += (corner & 4) ? axes[2] : -axes[2];
+
+		// Crossing the camera plane the projected rectangle is meaningless
+		if (clip.w < MinClipW) return true;
+
+		float inverseW = 1.0f / clip.w;
+		minX = std::min(minX, clip.x * inverseW);
+		maxX = std::max(maxX, clip.x * inverseW);
+		minY = std::min(minY, clip.y * inverseW);
+		maxY = std::max(maxY, clip.y * inverseW);
+		minDepth = std::min(minDepth, clip.z * inverseW);
+	}
+
+	float width = static_cast<float>(m_Info.width);
+	float height = static_cast<float>(m_Info.height);
+
+	int x0 = static_cast<int>(std::floor(std::clamp((minX * 0.5f + 0.5f) * width, 0.0f, width)));
+	int y0 = static_cast<int>(std::floor(std::clamp((minY * 0.5f + 0.5f) * height, 0.0f, height)));
+	int x1 = static_cast<int>(std::ceil(std::clamp((maxX * 0.5f + 0.5f) * width, 0.0f, width)));
+	int y1 = static_cast<int>(std::ceil(std::clamp((maxY * 0.5f + 0.5f) * height, 0.0f, height)));
+
+	// Off screen is for the frustum culler to decide
+	if (x0 >= x1 || y0 >= y1) return true;
+
+	// The finest level where the rectangle covers at most two texels each way, four reads for any object size
+	size_t level = 0;
+	int shift = 1;
+	while (level + 1 < m_Levels.size() && (((x1 - 1) >> shift) - (x0 >> shift) > 1 || ((y1 - 1) >> shift) - (y0 >> shift) > 1))
+	{
+		++level;
+		++shift;
+	}
+
+	const std::vector<float>& depths = m_Levels[level];
+	int levelWidth = (m_Info.width + (1 << shift) - 1) >> shift;
+
+	float maxDepth = -FLT_MAX;
+	for (int y = y0 >> shift; y <= (y1 - 1) >> shift; ++y)
+	{
+		for (int x = x0 >> shift; x <= (x1 - 1) >> shift; ++x) maxDepth = std::max(maxDepth, depths[y * levelWidth + x]);
+	}
+
+	return minDepth <= maxDepth;
+}
+
+size_t feOcclusionCuller::Cull(const feBoundingSphereArray& spheres, std::vector<uint32_t>& indices)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	size_t count = indices.size();
+	m_Keep.resize(count);
+
+	auto testRange = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i) m_Keep[i] = IsSphereVisible(spheres.GetCenter(indices[i]), spheres.GetRadius(indices[i])) ? 1 : 0;
+	};
+
+	if (m_Info.threadPool && count > TestChunkSize) m_Info.threadPool->ParallelFor(count, TestChunkSize, testRange);
+	else testRange(0, count);
+
+	size_t visible = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		indices[visible] = indices[i];
+		visible += m_Keep[i];
+	}
+
+	indices.resize(visible);
+
+	m_Stats.tested += count;
+	m_Stats.visible += visible;
+	m_Stats.culled += count - visible;
+	m_Stats.testMilliseconds += MillisecondsSince(start);
+	return visible;
+}
+
+int feOcclusionCuller::GetWidth() const
+{
+	return m_Info.width;
+}
+
+int feOcclusionCuller::GetHeight() const
+{
+	return m_Info.height;
+}
+
+float feOcclusionCuller::GetDepth(int x, int y) const
+{
+	int tile = (y / TileHeight) * m_TilesX + x / TileWidth;
+	return m_Depth[static_cast<size_t>(tile) * TileWidth * TileHeight + (y % TileHeight) * TileWidth + x % TileWidth];
+}
+
+const feOcclusionCullerStats& feOcclusionCuller::GetFrameStats() const
+{
+	return m_Stats;
+}
+
+void feOcclusionCuller::RasterizeTile(int tile)
+{
+	int tileX = (tile % m_TilesX) * TileWidth;
+	int tileY = (tile / m_TilesX) * TileHeight;
+	float* depth = m_Depth.data() + static_cast<size_t>(tile) * TileWidth * TileHeight;
+
+	std::fill(depth, depth + TileWidth * TileHeight, 1.0f);
+
+	for (uint32_t index : m_TileBins[tile])
+	{
+		const feOcclusionTriangle& triangle = m_Triangles[index];
+
+		// Relative to the tile, starting x is aligned so every group of four stays inside the row
+		int x0 = (std::max(triangle.minX, tileX) - tileX) & ~3;
+		int x1 = std::min(triangle.maxX, tileX + TileWidth) - tileX;
+		int y0 = std::max(triangle.minY, tileY) - tileY;
+		int y1 = std::min(triangle.maxY, tileY + TileHeight) - tileY;
+
+		for (int y = y0; y < y1; ++y)
+		{
+			float* row = depth + y * TileWidth;
+			float py = static_cast<float>(tileY + y) + 0.5f;
+
+			int x = x0;
+
+#ifdef FE_OCCLUSION_CULLER_SSE
+			__m128 edgeA[3];
+			__m128 edgeRow[3];
+			for (int edge = 0; edge < 3; ++edge)
+			{
+				edgeA[edge] = _mm_set1_ps(triangle.edgeA[edge]);
+				edgeRow[edge] = _mm_set1_ps(triangle.edgeB[edge] * py + triangle.edgeC[edge]);
+			}
+
+			__m128 depthA = _mm_set1_ps(triangle.depthA);
+			__m128 depthRow = _mm_set1_ps(triangle.depthB * py + triangle.depthC);
+			__m128 zero = _mm_setzero_ps();
+
+			for (; x < x1; x += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(tileX + x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), edgeRow[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), edgeRow[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), edgeRow[2]), zero));
+
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(depthA, px), depthRow));
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+			}
+#endif
+
+			for (; x < x1; ++x)
+			{
+				float px = static_cast<float>(tileX + x) + 0.5f;
+
+				// Grouped like the SSE2 path so both write the same depths
+				bool inside = true;
+				for (int edge = 0; edge < 3; ++edge) inside = inside && triangle.edgeA[edge] * px + (triangle.edgeB[edge] * py + triangle.edgeC[edge]) >= 0.0f;
+
+				if (inside) row[x] = std::min(row[x], triangle.depthA * px + (triangle.depthB * py + triangle.depthC));
+			}
+		}
+	}
+}
+
+void feOcclusionCuller::BuildPyramid()
+{
+	// The first level reads the tiles, tile sizes are even so no texel straddles two of them
+	std::vector<float>& first = m_Levels[0];
+	int firstWidth = m_Info.width / 2;
+
+	for (int y = 0; y < m_Info.height / 2; ++y)
+	{
+		for (int x = 0; x < firstWidth; ++x)
+		{
+			float top = std::max(GetDepth(x * 2, y * 2 + 1), GetDepth(x * 2 + 1, y * 2 + 1));
+			float bottom = std::max(GetDepth(x * 2, y * 2), GetDepth(x * 2 + 1, y * 2));
+			first[y * firstWidth + x] = std::max(top, bottom);
+		}
+	}
+
+	int sourceWidth = firstWidth;
+	int sourceHeight = m_Info.height / 2;
+
+	for (size_t level = 1; level < m_Levels.size(); ++level)
+	{
+		const std::vector<float>& source = m_Levels[level - 1];
+		std::vector<float>& target = m_Levels[level];
+
+		int targetWidth = (sourceWidth + 1) / 2;
+		int targetHeight = (sourceHeight + 1) / 2;
+
+		for (int y = 0; y < targetHeight; ++y)
+		{
+			for (int x = 0; x < targetWidth; ++x)
+			{
+				// Past the edge of an odd source the last texel stands in for the missing one
+				int sx0 = x * 2, sx1 = std::min(x * 2 + 1, sourceWidth - 1);
+				int sy0 = y * 2, sy1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+				float top = std::max(source[sy1 * sourceWidth + sx0], source[sy1 * sourceWidth + sx1]);
+				float bottom = std::max(source[sy0 * sourceWidth + sx0], source[sy0 * sourceWidth + sx1]);
+				target[y * targetWidth + x] = std::max(top, bottom);
+			}
+		}
+
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+class feThreadPool;
+class feBoundingSphereArray;
+
+struct feOcclusionCullerCreateInfo final
+{
+	// Depth buffer size in pixels, rounded up to whole tiles
+	int width = 256;
+	int height = 128;
+
+	// Tiles are rasterized in parallel when set
+	feThreadPool* threadPool = nullptr;
+};
+
+struct feOcclusionCullerStats final
+{
+	size_t occluders = 0;
+	size_t triangles = 0;
+	// Front facing and in front of the camera, the rest never reach the tiles
+	size_t rasterized = 0;
+	size_t tested = 0;
+	size_t visible = 0;
+	size_t culled = 0;
+	// Occluder setup and rasterization, then the hierarchical tests
+	double rasterizeMilliseconds = 0.0;
+	double testMilliseconds = 0.0;
+};
+
+// Software occlusion culling entirely on the CPU. A few large occluders are rasterized into a small depth buffer split
+// into tiles, four pixels at a time with SSE2 and one tile per job, then reduced into a max depth pyramid. Objects are
+// hidden when their closest depth lies behind the farthest occluder depth over their screen rectangle. Occluders must
+// lie inside the geometry they stand for, or they hide objects that are visible.
+class feOcclusionCuller final
+{
+public:
+	static constexpr int TileWidth = 32;
+	static constexpr int TileHeight = 16;
+
+	feOcclusionCuller() = default;
+	feOcclusionCuller(const feOcclusionCullerCreateInfo& info);
+
+	// Clears the depth buffer, viewProj maps to OpenGL clip space
+	void Begin(const glm::mat4& viewProj);
+	// Positions start every strideFloats floats, indices form a triangle list wound counter clockwise
+	void AddOccluder(const float* positions, size_t strideFloats, const unsigned int* indices, size_t indexCount, const glm::mat4& model);
+	// Rasterizes every occluder added since Begin and builds the depth pyramid
+	void Rasterize();
+
+	// Only valid after Rasterize
+	[[nodiscard]] bool IsSphereVisible(const glm::vec3& center, float radius) const;
+	// Removes the hidden spheres from indices, keeping the order of the rest, and returns how many remain
+	size_t Cull(const feBoundingSphereArray& spheres, std::vector<uint32_t>& indices);
+
+	[[nodiscard]] int GetWidth() const;
+	[[nodiscard]] int GetHeight() const;
+	// Normalized device depth of the pixel, rows start at the bottom. 1 where no occluder was drawn.
+	[[nodiscard]] float GetDepth(int x, int y) const;
+
+	// Since the last Begin
+	[[nodiscard]] const feOcclusionCullerStats& GetFrameStats() const;
+private:
+	// Edge functions and the depth plane in pixels, all of them are a * x + b * y + c
+	struct feOcclusionTriangle final
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY;
+	};
+
+	void RasterizeTile(int tile);
+	void BuildPyramid();
+private:
+	feOcclusionCullerCreateInfo m_Info;
+	int m_TilesX = 0;
+	int m_TilesY = 0;
+
+	glm::mat4 m_ViewProj = glm::mat4(1.0f);
+	std::vector<glm::vec4> m_ClipVertices;
+	std::vector<feOcclusionTriangle> m_Triangles;
+	// Triangles overlapping each tile
+	std::vector<std::vector<uint32_t>> m_TileBins;
+
+	// Tile after tile, each TileWidth * TileHeight pixels in rows
+	std::vector<float> m_Depth;
+	// Level i holds the farthest depth of 2^(i + 1) pixels square, in rows
+	std::vector<std::vector<float>> m_Levels;
+	std::vector<uint8_t> m_Keep;
+
+	feOcclusionCullerStats m_Stats;
+};
\ No newline at end of file
@@ -0,0 +1,516 @@
+#include "Planet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "../util/Noise.h"
+#include "../util/Pack.h"
+#include "../util/SphereMeshes.h"
+#include "../util/ThreadPool.h"
+#include "Shader.h"
+
+namespace
+{
+	constexpr int MaxPlanetDepth = 28;
+
+	struct CubeFace final
+	{
+		glm::dvec3 normal;
+		glm::dvec3 u;
+		glm::dvec3 v;
+	};
+
+	// u x v = normal like feSphereMeshes::CubeSphere, so grids wound along u then v face outwards
+	const CubeFace Faces[6] = {
+		{ {  1,  0,  0 }, {  0,  0, -1 }, { 0, 1,  0 } },
+		{ { -1,  0,  0 }, {  0,  0,  1 }, { 0, 1,  0 } },
+		{ {  0,  1,  0 }, {  1,  0,  0 }, { 0, 0, -1 } },
+		{ {  0, -1,  0 }, {  1,  0,  0 }, { 0, 0,  1 } },
+		{ {  0,  0,  1 }, {  1,  0,  0 }, { 0, 1,  0 } },
+		{ {  0,  0, -1 }, { -1,  0,  0 }, { 0, 1,  0 } },
+	};
+
+	uint64_t PatchKey(int face, int level, uint32_t x, uint32_t y)
+	{
+		return (static_cast<uint64_t>(face) << 61) | (static_cast<uint64_t>(level) << 56) | (static_cast<uint64_t>(x) << 28) | y;
+	}
+
+	void UnpackKey(uint64_t key, int& face, int& level, uint32_t& x, uint32_t& y)
+	{
+		face = static_cast<int>(key >> 61);
+		level = static_cast<int>((key >> 56) & 0x1F);
+		x = static_cast<uint32_t>((key >> 28) & 0xFFFFFFF);
+		y = static_cast<uint32_t>(key & 0xFFFFFFF);
+	}
+
+	// Point on the unit sphere for face coordinates in [0, 1]. Coordinates are dyadic fractions, so neighbours at
+	// the same level compute identical edge vertices. Double throughout, a float direction stops telling vertices
+	// apart long before MaxPlanetDepth.
+	glm::dvec3 FaceDirection(int face, double a, double b)
+	{
+		const CubeFace& cubeFace = Faces[face];
+		glm::dvec3 point = cubeFace.normal + cubeFace.u * (2.0 * a - 1.0) + cubeFace.v * (2.0 * b - 1.0);
+		return feSphereMeshes::SpherifyCubePoint(point);
+	}
+
+	// Arc length of a patch edge on the smooth sphere
+	double PatchSize(double radius, int level)
+	{
+		return radius * 1.5707963267948966 / static_cast<double>(1u << level);
+	}
+
+	// Center of the patch on the smooth sphere, the patch vertices are stored relative to it
+	glm::dvec3 PatchOrigin(const glm::dvec3& center, double radius, int face, int level, uint32_t x, uint32_t y)
+	{
+		double scale = 1.0 / static_cast<double>(1u << level);
+		return center + FaceDirection(face, (x + 0.5) * scale, (y + 0.5) * scale) * radius;
+	}
+
+	// Everything a worker needs, copied so jobs never touch the planet
+	struct GenerationParams final
+	{
+		glm::dvec3 center;
+		double radius;
+		int resolution;
+		float noiseAmplitude;
+		float noiseFrequency;
+		int noiseOctaves;
+	};
+
+	// resolution^2 grid vertices, then the skirts of the bottom, top, left and right edges with resolution each
+	void GeneratePatch(const GenerationParams& params, uint64_t key, fePlanet::fePlanetGenerated& out)
+	{
+		int face, level;
+		uint32_t x, y;
+		UnpackKey(key, face, level, x, y);
+
+		const int resolution = params.resolution;
+		// One extra ring of samples around the grid for central difference normals
+		const int samples = resolution + 2;
+		const size_t sampleCount = static_cast<size_t>(samples) * samples;
+		const double step = 1.0 / (static_cast<double>(resolution - 1) * static_cast<double>(1u << level));
+
+		std::vector<double> dx = std::vector<double>(sampleCount);
+		std::vector<double> dy = std::vector<double>(sampleCount);
+		std::vector<double> dz = std::vector<double>(sampleCount);
+
+		for (int j = 0; j < samples; ++j)
+		{
+			for (int i = 0; i < samples; ++i)
+			{
+				double a = (static_cast<double>(x) * (resolution - 1) + (i - 1)) * step;
+				double b = (static_cast<double>(y) * (resolution - 1) + (j - 1)) * step;
+				glm::dvec3 direction = FaceDirection(face, a, b);
+
+				size_t index = static_cast<size_t>(j) * samples + i;
+				dx[index] = direction.x;
+				dy[index] = direction.y;
+				dz[index] = direction.z;
+			}
+		}
+
+		std::vector<float> heights = std::vector<float>(sampleCount, 0.0f);
+		// Noise is still sampled in float, on the deepest levels neighbouring samples can share a height
+		if (params.noiseAmplitude != 0.0f)
+		{
+			std::vector<float> nx = std::vector<float>(sampleCount);
+			std::vector<float> ny = std::vector<float>(sampleCount);
+			std::vector<float> nz = std::vector<float>(sampleCount);
+
+			for (size_t i = 0; i < sampleCount; ++i)
+			{
+				nx[i] = static_cast<float>(dx[i] * params.noiseFrequency);
+				ny[i] = static_cast<float>(dy[i] * params.noiseFrequency);
+				nz[i] = static_cast<float>(dz[i] * params.noiseFrequency);
+			}
+
+			feNoise::FbmBatch(nx.data(), ny.data(), nz.data(), heights.data(), sampleCount, params.noiseOctaves);
+		}
+
+		glm::dvec3 origin = PatchOrigin(params.center, params.radius, face, level, x, y);
+
+		// Relative to the origin in double, only the small offsets are rounded to float
+		std::vector<glm::dvec3> positions = std::vector<glm::dvec3>(sampleCount);
+		for (size_t i = 0; i < sampleCount; ++i)
+		{
+			double height = params.radius * (1.0 + static_cast<double>(params.noiseAmplitude) * heights[i]);
+			positions[i] = glm::dvec3(dx[i], dy[i], dz[i]) * height + params.center - origin;
+		}
+
+		out.key = key;
+		out.vertices.resize(static_cast<size_t>(resolution) * resolution + 4 * static_cast<size_t>(resolution));
+		out.boundingRadius = 0.0f;
+
+		for (int j = 0; j < resolution; ++j)
+		{
+			for (int i = 0; i < resolution; ++i)
+			{
+				size_t sample = static_cast<size_t>(j + 1) * samples + (i + 1);
+
+				glm::dvec3 du = positions[sample + 1] - positions[sample - 1];
+				glm::dvec3 dv = positions[sample + samples] - positions[sample - samples];
+				glm::dvec3 normal = glm::dvec3(du.y * dv.z - du.z * dv.y, du.z * dv.x - du.x * dv.z, du.x * dv.y - du.y * dv.x);
+				normal = normal / std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+
+				fePlanetVertex& vertex = out.vertices[static_cast<size_t>(j) * resolution + i];
+				vertex.position = glm::vec3(static_cast<float>(positions[sample].x), static_cast<float>(positions[sample].y), static_cast<float>(positions[sample].z));
+				vertex.normal.bits = fePack::Snorm1010102(static_cast<float>(normal.x), static_cast<float>(normal.y), static_cast<float>(normal.z));
+
+				out.boundingRadius = std::max(out.boundingRadius, glm::length(vertex.position));
+			}
+		}
+
+		// Deep enough to cover the height difference to a neighbour one level coarser
+		double skirtDepth = PatchSize(params.radius, level) * 0.1 + params.radius * params.noiseAmplitude / static_cast<double>(1u << level);
+
+		fePlanetVertex* skirt = out.vertices.data() + static_cast<size_t>(resolution) * resolution;
+		for (int edge = 0; edge < 4; ++edge)
+		{
+			for (int k = 0; k < resolution; ++k)
+			{
+				int i = edge < 2 ? k : (edge == 2 ? 0 : resolution - 1);
+				int j = edge < 2 ? (edge == 0 ? 0 : resolution - 1) : k;
+
+				size_t sample = static_cast<size_t>(j + 1) * samples + (i + 1);
+				glm::dvec3 direction = glm::dvec3(dx[sample], dy[sample], dz[sample]);
+				glm::dvec3 position = positions[sample] - direction * skirtDepth;
+
+				fePlanetVertex& vertex = skirt[edge * resolution + k];
+				vertex.position = glm::vec3(static_cast<float>(position.x), static_cast<float>(position.y), static_cast<float>(position.z));
+				// Lit like the edge it hangs from so it blends in where it shows
+				vertex.normal = out.vertices[static_cast<size_t>(j) * resolution + i].normal;
+
+				out.boundingRadius = std::max(out.boundingRadius, glm::length(vertex.position));
+			}
+		}
+	}
+
+	// The same for every patch, see GeneratePatch for the vertex order
+	std::vector<unsigned short> BuildPatchIndices(int resolution)
+	{
+		std::vector<unsigned short> indices;
+		indices.reserve(6 * static_cast<size_t>(resolution - 1) * (resolution - 1) + 24 * static_cast<size_t>(resolution - 1));
+
+		auto grid = [resolution](int i, int j) { return static_cast<unsigned short>(j * resolution + i); };
+		auto skirt = [resolution](int edge, int k) { return static_cast<unsigned short>(resolution * resolution + edge * resolution + k); };
+
+		for (int j = 0; j + 1 < resolution; ++j)
+		{
+			for (int i = 0; i + 1 < resolution; ++i)
+			{
+				indices.insert(indices.end(), { grid(i, j), grid(i + 1, j), grid(i + 1, j + 1),  grid(i, j), grid(i + 1, j + 1), grid(i, j + 1) });
+			}
+		}
+
+		// Skirts face away from the patch, the bottom and right edges keep the order of their edge and the top and left
+		// edges reverse it
+		for (int k = 0; k + 1 < resolution; ++k)
+		{
+			unsigned short e0 = grid(k, 0), e1 = grid(k + 1, 0), s0 = skirt(0, k), s1 = skirt(0, k + 1);
+			indices.insert(indices.end(), { e0, s0, e1,  e1, s0, s1 });
+
+			e0 = grid(k, resolution - 1); e1 = grid(k + 1, resolution - 1); s0 = skirt(1, k); s1 = skirt(1, k + 1);
+			indices.insert(indices.end(), { e0, e1, s0,  e1, s1, s0 });
+
+			e0 = grid(0, k); e1 = grid(0, k + 1); s0 = skirt(2, k); s1 = skirt(2, k + 1);
+			indices.insert(indices.end(), { e0, e1, s0,  e1, s1, s0 });
+
+			e0 = grid(resolution - 1, k); e1 = grid(resolution - 1, k + 1); s0 = skirt(3, k); s1 = skirt(3, k + 1);
+			indices.insert(indices.end(), { e0, s0, e1,  e1, s0, s1 });
+		}
+
+		return indices;
+	}
+
+	GenerationParams MakeParams(const fePlanetCreateInfo& info)
+	{
+		GenerationParams params;
+		params.center = info.center;
+		params.radius = info.radius;
+		params.resolution = info.patchResolution;
+		params.noiseAmplitude = info.noiseAmplitude;
+		params.noiseFrequency = info.noiseFrequency;
+		params.noiseOctaves = info.noiseOctaves;
+		return params;
+	}
+}
+
+fePlanet::fePlanet(const fePlanetCreateInfo& info)
+	: m_Info(info), m_Shared(std::make_shared<fePlanetShared>())
+{
+	// Grid and skirts have to fit 16 bit indices
+	m_Info.patchResolution = std::clamp(m_Info.patchResolution, 3, 125);
+	m_Info.maxDepth = std::clamp(m_Info.maxDepth, 0, MaxPlanetDepth);
+	m_Info.patchCapacity = std::max<size_t>(m_Info.patchCapacity, 6);
+
+	int resolution = m_Info.patchResolution;
+	m_PatchVertexCount = static_cast<size_t>(resolution) * resolution + 4 * static_cast<size_t>(resolution);
+
+	std::vector<unsigned short> indices = BuildPatchIndices(resolution);
+	m_PatchIndexCount = static_cast<unsigned int>(indices.size());
+
+	{
+		feBufferObjectCreateInfo bufferInfo;
+		bufferInfo.target = GL_ARRAY_BUFFER;
+		bufferInfo.size = m_Info.patchCapacity * m_PatchVertexCount * sizeof(fePlanetVertex);
+		bufferInfo.usage = GL_DYNAMIC_DRAW;
+		bufferInfo.debugName = info.debugName;
+
+		m_VertexBuffer = bufferInfo;
+	}
+
+	{
+		feBufferObjectCreateInfo bufferInfo;
+		bufferInfo.target = GL_ELEMENT_ARRAY_BUFFER;
+		bufferInfo.data = indices.data();
+		bufferInfo.size = indices.size() * sizeof(unsigned short);
+		bufferInfo.debugName = info.debugName;
+
+		m_IndexBuffer = bufferInfo;
+	}
+
+	{
+		constexpr const auto& layout = feVertexLayoutOf<fePlanetVertex>::value;
+
+		feVertexArrayCreateInfoBufferObjectInfo bufferInfo;
+		bufferInfo.buffer = &m_VertexBuffer;
+		bufferInfo.stride = layout.stride;
+
+		feVertexArrayCreateInfo vaoInfo;
+		vaoInfo.vertexBufferInfos = &bufferInfo;
+		vaoInfo.vertexBufferInfoCount = 1;
+		vaoInfo.attributeInfos = layout.attributes.data();
+		vaoInfo.attributeInfoCount = layout.count;
+		vaoInfo.indexBuffer = &m_IndexBuffer;
+		vaoInfo.indexType = GL_UNSIGNED_SHORT;
+		vaoInfo.count = m_PatchIndexCount;
+		vaoInfo.mode = GL_TRIANGLES;
+		vaoInfo.debugName = info.debugName;
+
+		m_VertexArray = vaoInfo;
+	}
+
+	m_FreeSlots.reserve(m_Info.patchCapacity);
+	for (size_t i = m_Info.patchCapacity; i > 0; --i) m_FreeSlots.push_back(static_cast<uint32_t>(i - 1));
+
+	// The six faces are always resident, there is always something to draw
+	GenerationParams params = MakeParams(m_Info);
+	for (int face = 0; face < 6; ++face)
+	{
+		uint64_t key = PatchKey(face, 0, 0, 0);
+
+		fePlanetPatch& patch = m_Patches[key];
+		patch.origin = PatchOrigin(m_Info.center, m_Info.radius, face, 0, 0, 0);
+
+		fePlanetGenerated generated;
+		GeneratePatch(params, key, generated);
+		Upload(generated);
+	}
+}
+
+void fePlanet::Update(const glm::dvec3& cameraPosition, const feFrustum* frustum)
+{
+	++m_Frame;
+	m_CameraPosition = cameraPosition;
+	m_Frustum = frustum;
+	m_Stats = fePlanetStats();
+	m_EvictionBudget = m_Info.maxEvictionsPerFrame;
+
+	UploadFinished();
+
+	m_DrawList.clear();
+	m_Requests.clear();
+
+	for (int face = 0; face < 6; ++face) Select(face, 0, 0, 0);
+
+	StartGeneration();
+	m_Frustum = nullptr;
+
+	m_Stats.drawn = m_DrawList.size();
+	m_Stats.resident = m_Info.patchCapacity - m_FreeSlots.size();
+	m_Stats.pending = m_Patches.size() - m_Stats.resident;
+}
+
+void fePlanet::Draw(feProgram& program, const glm::dvec3& cameraPosition) const
+{
+	if (m_DrawList.empty()) return;
+
+	feUniformSlot offsetSlot = program.GetUniformSlot("u_PatchOffset"_uniform);
+
+	m_VertexArray.Bind();
+
+	for (const fePlanetPatch* patch : m_DrawList)
+	{
+		glm::dvec3 offset = patch->origin - cameraPosition;
+		program.Uniform3f(offsetSlot, glm::vec3(static_cast<float>(offset.x), static_cast<float>(offset.y), static_cast<float>(offset.z)));
+		m_VertexArray.DrawBaseVertex(m_PatchIndexCount, 0, static_cast<int>(patch->slot * m_PatchVertexCount));
+	}
+}
+
+const feVertexArray& fePlanet::GetVertexArray() const
+{
+	return m_VertexArray;
+}
+
+const fePlanetStats& fePlanet::GetFrameStats() const
+{
+	return m_Stats;
+}
+
+void fePlanet::Select(int face, int level, uint32_t x, uint32_t y)
+{
+	auto it = m_Patches.find(PatchKey(face, level, x, y));
+	fePlanetPatch& patch = it->second;
+	patch.lastUsedFrame = m_Frame;
+
+	// Kept resident, turning around should not have to generate the patch again
+	if (m_Frustum && !m_Frustum->IntersectsSphere(glm::vec3(patch.origin), patch.boundingRadius))
+	{
+		++m_Stats.culled;
+		return;
+	}
+
+	double size = PatchSize(m_Info.radius, level);
+	double distance = glm::length(m_CameraPosition - patch.origin);
+
+	if (level < m_Info.maxDepth && distance < m_Info.splitDistance * size)
+	{
+		bool childrenReady = true;
+
+		for (uint32_t child = 0; child < 4; ++child)
+		{
+			uint32_t childX = x * 2 + (child & 1);
+			uint32_t childY = y * 2 + (child >> 1);
+
+			auto childIt = m_Patches.find(PatchKey(face, level + 1, childX, childY));
+			if (childIt == m_Patches.end())
+			{
+				childrenReady = false;
+
+				glm::dvec3 childOrigin = PatchOrigin(m_Info.center, m_Info.radius, face, level + 1, childX, childY);
+				Request(face, level + 1, childX, childY, glm::length(m_CameraPosition - childOrigin) / PatchSize(m_Info.radius, level + 1));
+			}
+			else if (childIt->second.slot == UINT32_MAX)
+			{
+				childrenReady = false;
+			}
+			else
+			{
+				// Resident siblings of a pending child stay cached until all four can be drawn
+				childIt->second.lastUsedFrame = m_Frame;
+			}
+		}
+
+		// Children replace the parent only all together, the parent keeps drawing until then
+		if (childrenReady)
+		{
+			for (uint32_t child = 0; child < 4; ++child) Select(face, level + 1, x * 2 + (child & 1), y * 2 + (child >> 1));
+			return;
+		}
+	}
+
+	m_DrawList.push_back(&patch);
+}
+
+void fePlanet::Request(int face, int level, uint32_t x, uint32_t y, double priority)
+{
+	m_Requests.push_back({ face, level, x, y, priority });
+}
+
+void fePlanet::StartGeneration()
+{
+	if (m_Requests.empty()) return;
+
+	// Closest relative to their size first
+	size_t count = std::min(m_Requests.size(), m_Info.maxGenerationsPerFrame);
+	std::partial_sort(m_Requests.begin(), m_Requests.begin() + count, m_Requests.end(), [](const fePlanetRequest& a, const fePlanetRequest& b) { return a.priority < b.priority; });
+
+	GenerationParams params = MakeParams(m_Info);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const fePlanetRequest& request = m_Requests[i];
+		uint64_t key = PatchKey(request.face, request.level, request.x, request.y);
+
+		fePlanetPatch& patch = m_Patches[key];
+		patch.origin = PatchOrigin(m_Info.center, m_Info.radius, request.face, request.level, request.x, request.y);
+		patch.lastUsedFrame = m_Frame;
+
+		std::shared_ptr<fePlanetShared> shared = m_Shared;
+		auto job = [shared, params, key]()
+		{
+			fePlanetGenerated generated;
+			GeneratePatch(params, key, generated);
+
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			shared->finished.push_back(std::move(generated));
+		};
+
+		if (m_Info.threadPool) m_Info.threadPool->Submit(std::move(job));
+		else job();
+
+		++m_Stats.generated;
+	}
+}
+
+void fePlanet::UploadFinished()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Shared->mutex);
+		for (fePlanetGenerated& generated : m_Shared->finished) m_Backlog.push_back(std::move(generated));
+		m_Shared->finished.clear();
+	}
+
+	// Without a free slot the rest waits for patches to fall out of use
+	size_t uploaded = 0;
+	while (uploaded < m_Backlog.size() && uploaded < m_Info.maxUploadsPerFrame && Upload(m_Backlog[uploaded])) ++uploaded;
+
+	m_Backlog.erase(m_Backlog.begin(), m_Backlog.begin() + uploaded);
+	m_Stats.uploaded = uploaded;
+}
+
+bool fePlanet::Upload(fePlanetGenerated& generated)
+{
+	if (m_FreeSlots.empty() && !EvictOne()) return false;
+
+	uint32_t slot = m_FreeSlots.back();
+	m_FreeSlots.pop_back();
+
+	size_t size = m_PatchVertexCount * sizeof(fePlanetVertex);
+	m_VertexBuffer.SetData(slot * size, size, generated.vertices.data());
+
+	fePlanetPatch& patch = m_Patches[generated.key];
+	patch.slot = slot;
+	patch.boundingRadius = generated.boundingRadius;
+
+	std::vector<fePlanetVertex>().swap(generated.vertices);
+	return true;
+}
+
+bool fePlanet::EvictOne()
+{
+	if (m_EvictionBudget == 0) return false;
+
+	// Least recently drawn resident patch that was not needed last frame, the six faces always stay
+	auto victim = m_Patches.end();
+	for (auto it = m_Patches.begin(); it != m_Patches.end(); ++it)
+	{
+		const fePlanetPatch& patch = it->second;
+		if (patch.slot == UINT32_MAX || patch.lastUsedFrame + 1 >= m_Frame) continue;
+		if (((it->first >> 56) & 0x1F) == 0) continue;
+
+		if (victim == m_Patches.end() || patch.lastUsedFrame < victim->second.lastUsedFrame) victim = it;
+	}
+
+	if (victim == m_Patches.end()) return false;
+
+	m_FreeSlots.push_back(victim->second.slot);
+	m_Patches.erase(victim);
+
+	--m_EvictionBudget;
+	++m_Stats.evicted;
+	return true;
+}
\ No newline at end of file
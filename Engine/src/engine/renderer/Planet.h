@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BufferObject.h"
+#include "VertexArray.h"
+#include "VertexLayout.h"
+#include "../math/Frustum.h"
+
+class feProgram;
+class feThreadPool;
+
+// Positions are relative to the patch origin, which is drawn relative to the camera so they stay precise on large
+// planets far from the world origin
+struct fePlanetVertex final
+{
+	glm::vec3 position;
+	feSnorm1010102 normal;
+};
+
+FE_VERTEX_LAYOUT(fePlanetVertex,
+	FE_VERTEX_ATTRIBUTE(fePlanetVertex, position),
+	FE_VERTEX_ATTRIBUTE(fePlanetVertex, normal));
+
+struct fePlanetCreateInfo final
+{
+	glm::dvec3 center = glm::dvec3(0.0);
+	double radius = 100.0;
+
+	// Vertices along a patch edge, every patch has (patchResolution - 1)^2 quads and a skirt on each edge
+	int patchResolution = 33;
+	// At most 28 levels below the six cube faces
+	int maxDepth = 12;
+	// A patch splits while the camera is closer than splitDistance times its edge length
+	float splitDistance = 2.0f;
+
+	// Surface height is radius * (1 + noiseAmplitude * fbm(direction * noiseFrequency)), 0 keeps the sphere smooth
+	float noiseAmplitude = 0.02f;
+	float noiseFrequency = 4.0f;
+	int noiseOctaves = 6;
+
+	// Slots in the pooled vertex buffer, the most patches that can be resident at once
+	size_t patchCapacity = 512;
+	// Per frame budgets, they keep the frame time flat while the tree changes under a moving camera
+	size_t maxGenerationsPerFrame = 8;
+	size_t maxUploadsPerFrame = 8;
+	size_t maxEvictionsPerFrame = 8;
+
+	// Patches are generated on the pool when set, otherwise during Update
+	feThreadPool* threadPool = nullptr;
+
+	const char* debugName = nullptr;
+};
+
+struct fePlanetStats final
+{
+	size_t drawn = 0;
+	// Patches outside the frustum, their subtrees are neither drawn nor refined
+	size_t culled = 0;
+	size_t resident = 0;
+	size_t pending = 0;
+	size_t generated = 0;
+	size_t uploaded = 0;
+	size_t evicted = 0;
+};
+
+// Cube sphere planet whose six faces are quadtrees split by camera distance. Patches are generated in the background
+// and share one pooled vertex buffer and one index buffer, drawing a patch only picks its slot through the base vertex.
+// Skirts hanging below every patch edge hide the cracks between neighbours of different levels.
+class fePlanet final
+{
+public:
+	fePlanet() = default;
+	fePlanet(const fePlanetCreateInfo& info);
+
+	fePlanet(const fePlanet&) = delete;
+	fePlanet& operator=(const fePlanet&) = delete;
+
+	fePlanet(fePlanet&& other) noexcept = default;
+	fePlanet& operator=(fePlanet&& other) noexcept = default;
+
+	// Uploads finished patches, picks the patches to draw and starts generating the ones the camera needs next, all
+	// within the per frame budgets. Patches outside the frustum are skipped when it is set.
+	void Update(const glm::dvec3& cameraPosition, const feFrustum* frustum = nullptr);
+	// Draws the patches picked by Update, the program reads vertices relative to u_PatchOffset (see planet.vert)
+	void Draw(feProgram& program, const glm::dvec3& cameraPosition) const;
+
+	[[nodiscard]] const feVertexArray& GetVertexArray() const;
+	[[nodiscard]] const fePlanetStats& GetFrameStats() const;
+public:
+	struct fePlanetGenerated final
+	{
+		uint64_t key = 0;
+		std::vector<fePlanetVertex> vertices;
+		float boundingRadius = 0.0f;
+	};
+
+	// Written by the workers, outlives the planet while jobs are still running
+	struct fePlanetShared final
+	{
+		std::mutex mutex;
+		std::vector<fePlanetGenerated> finished;
+	};
+private:
+	struct fePlanetPatch final
+	{
+		glm::dvec3 origin = glm::dvec3(0.0);
+		float boundingRadius = 0.0f;
+		// UINT32_MAX while the patch is being generated
+		uint32_t slot = UINT32_MAX;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	void Select(int face, int level, uint32_t x, uint32_t y);
+	void Request(int face, int level, uint32_t x, uint32_t y, double priority);
+	void StartGeneration();
+	void UploadFinished();
+	bool Upload(fePlanetGenerated& generated);
+	bool EvictOne();
+private:
+	fePlanetCreateInfo m_Info;
+
+	size_t m_PatchVertexCount = 0;
+	unsigned int m_PatchIndexCount = 0;
+
+	feBufferObject m_VertexBuffer;
+	feBufferObject m_IndexBuffer;
+	feVertexArray m_VertexArray;
+
+	std::unordered_map<uint64_t, fePlanetPatch> m_Patches;
+	std::vector<uint32_t> m_FreeSlots;
+	std::shared_ptr<fePlanetShared> m_Shared;
+	// Finished patches waiting for an upload budget or a free slot
+	std::vector<fePlanetGenerated> m_Backlog;
+
+	struct fePlanetRequest final
+	{
+		int face;
+		int level;
+		uint32_t x;
+		uint32_t y;
+		double priority;
+	};
+
+	std::vector<fePlanetRequest> m_Requests;
+	std::vector<const fePlanetPatch*> m_DrawList;
+
+	glm::dvec3 m_CameraPosition = glm::dvec3(0.0);
+	const feFrustum* m_Frustum = nullptr;
+	uint64_t m_Frame = 0;
+	size_t m_EvictionBudget = 0;
+	fePlanetStats m_Stats;
+};
\ No newline at end of file
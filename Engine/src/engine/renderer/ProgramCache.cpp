@@ -0,0 +1,187 @@
+#include "ProgramCache.h"
+
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <filesystem>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "../ResourceLoader.h"
+#include "../util/Hash.h"
+#include "Util.h"
+
+static constexpr uint32_t s_Magic = 0x42504546; // "FEPB"
+static constexpr uint32_t s_FileVersion = 1;
+
+struct feProgramCacheHeader final
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t size;
+};
+
+feProgramCache::feProgramCache(const feProgramCacheCreateInfo& info)
+	: m_Directory(info.directory)
+{
+	if (!info.enabled) return;
+
+	if (feRenderUtil::GetSupportedVersion() < 41)
+	{
+		feLog::Warn("Program binaries are not supported, the program cache is disabled");
+		return;
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	if (formatCount <= 0)
+	{
+		feLog::Warn("Driver exposes no program binary formats, the program cache is disabled");
+		return;
+	}
+
+	// Binaries are only valid for the driver that produced them
+	m_DriverHash = feHash::Fnv1a64(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	m_DriverHash = feHash::Fnv1a64(reinterpret_cast<const char*>(glGetString(GL_VERSION)), m_DriverHash);
+
+	m_Supported = true;
+}
+
+bool feProgramCache::IsSupported() const
+{
+	return m_Supported;
+}
+
+uint64_t feProgramCache::ComputeKey(const feShaderCreateInfo* shaderInfos, size_t shaderInfoCount) const
+{
+	uint64_t key = m_DriverHash;
+
+	for (size_t i = 0; i < shaderInfoCount; ++i)
+	{
+		const feShaderCreateInfo& info = shaderInfos[i];
+
+		key = feHash::Fnv1a64(std::string_view(reinterpret_cast<const char*>(&info.type), sizeof(info.type)), key);
+
+		for (size_t j = 0; j < info.sourceCount; ++j)
+		{
+			key = feHash::Fnv1a64(info.sources[j], key);
+			// Separate sources so moving text between them changes the key
+			key = feHash::Fnv1a64(std::string_view("\0", 1), key);
+		}
+	}
+
+	return key;
+}
+
+std::optional<feProgram> feProgramCache::Load(uint64_t key, const char* debugName)
+{
+	if (!m_Supported) return {};
+
+	std::optional<std::vector<unsigned char>> contents = feResourceLoader::LoadBinaryFile(GetPath(key));
+
+	if (!contents)
+	{
+		++m_Stats.misses;
+		return {};
+	}
+
+	feProgramCacheHeader header;
+
+	if (contents->size() < sizeof(header))
+	{
+		++m_Stats.misses;
+		return {};
+	}
+
+	std::memcpy(&header, contents->data(), sizeof(header));
+
+	if (header.magic != s_Magic || header.version != s_FileVersion || header.key != key || header.size != contents->size() - sizeof(header))
+	{
+		++m_Stats.misses;
+		return {};
+	}
+
+	feProgramBinaryCreateInfo info;
+	info.format = header.format;
+	info.data = contents->data() + sizeof(header);
+	info.size = header.size;
+	info.debugName = debugName;
+
+	feProgram program = info;
+
+	if (!program.IsLinked())
+	{
+		++m_Stats.rejected;
+		++m_Stats.misses;
+		return {};
+	}
+
+	++m_Stats.hits;
+	return program;
+}
+
+void feProgramCache::Store(uint64_t key, const feProgram& program)
+{
+	if (!m_Supported) return;
+
+	unsigned int format = 0;
+	std::vector<unsigned char> binary;
+
+	if (!program.GetBinary(format, binary)) return;
+
+	feProgramCacheHeader header;
+	header.magic = s_Magic;
+	header.version = s_FileVersion;
+	header.key = key;
+	header.format = format;
+	header.size = static_cast<uint32_t>(binary.size());
+
+	std::vector<unsigned char> contents = std::vector<unsigned char>(sizeof(header) + binary.size());
+	std::memcpy(contents.data(), &header, sizeof(header));
+	std::memcpy(contents.data() + sizeof(header), binary.data(), binary.size());
+
+	std::error_code error;
+	std::filesystem::create_directories(m_Directory, error);
+
+	if (error || !feResourceLoader::WriteBinaryFile(GetPath(key), contents.data(), contents.size()))
+	{
+		feLog::Warn("Failed to write program binary to {}", m_Directory);
+		return;
+	}
+
+	++m_Stats.stored;
+}
+
+feProgram feProgramCache::Create(const feShaderCreateInfo* shaderInfos, size_t shaderInfoCount, const char* debugName)
+{
+	uint64_t key = ComputeKey(shaderInfos, shaderInfoCount);
+
+	if (std::optional<feProgram> cached = Load(key, debugName)) return std::move(*cached);
+
+	std::unique_ptr<feShader[]> shaders = std::make_unique<feShader[]>(shaderInfoCount);
+	for (size_t i = 0; i < shaderInfoCount; ++i) shaders[i] = feShader(shaderInfos[i]);
+
+	feProgramCreateInfo info;
+	info.shaders = shaders.get();
+	info.shaderCount = shaderInfoCount;
+	info.retrievable = m_Supported;
+	info.debugName = debugName;
+
+	feProgram program = info;
+	Store(key, program);
+	return program;
+}
+
+const feProgramCacheStats& feProgramCache::GetStats() const
+{
+	return m_Stats;
+}
+
+std::string feProgramCache::GetPath(uint64_t key) const
+{
+	return fmt::format("{}/{:016x}.bin", m_Directory, key);
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "Shader.h"
+
+struct feProgramCacheCreateInfo final
+{
+	std::string_view directory = "cache/programs";
+	bool enabled = true;
+};
+
+struct feProgramCacheStats final
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	// Binaries found on disk that the driver refused to load
+	uint64_t rejected = 0;
+	uint64_t stored = 0;
+};
+
+// Stores linked program binaries on disk keyed by their sources and the driver, so later runs can skip compilation
+class feProgramCache final
+{
+public:
+	feProgramCache() = default;
+	feProgramCache(const feProgramCacheCreateInfo& info);
+
+	feProgramCache(const feProgramCache&) = delete;
+	feProgramCache& operator=(const feProgramCache&) = delete;
+
+	feProgramCache(feProgramCache&& other) noexcept = default;
+	feProgramCache& operator=(feProgramCache&& other) noexcept = default;
+
+	[[nodiscard]] bool IsSupported() const;
+	[[nodiscard]] uint64_t ComputeKey(const feShaderCreateInfo* shaderInfos, size_t shaderInfoCount) const;
+
+	std::optional<feProgram> Load(uint64_t key, const char* debugName);
+	void Store(uint64_t key, const feProgram& program);
+
+	// Loads the program from the cache, otherwise compiles it from source and stores the result
+	feProgram Create(const feShaderCreateInfo* shaderInfos, size_t shaderInfoCount, const char* debugName);
+
+	const feProgramCacheStats& GetStats() const;
+private:
+	std::string GetPath(uint64_t key) const;
+private:
+	std::string m_Directory;
+	uint64_t m_DriverHash = 0;
+	bool m_Supported = false;
+	feProgramCacheStats m_Stats;
+};
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "ProgramCompiler.h"
+
+#include <utility>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "ProgramCache.h"
+#include "Util.h"
+
+// From GL_KHR_parallel_shader_compile, the ARB extension uses the same values
+#define FE_GL_MAX_SHADER_COMPILER_THREADS 0x91B0
+#define FE_GL_COMPLETION_STATUS 0x91B1
+
+// Same calling convention as the GL entry points, which is stdcall on 32-bit Windows
+typedef void (GLAD_API_PTR *feMaxShaderCompilerThreadsProc)(GLuint count);
+
+feProgramCompiler::feProgramCompiler(const feProgramCompilerCreateInfo& info)
+	: m_Cache(info.cache), m_MaxBlockingPerPoll(info.maxBlockingPerPoll)
+{
+	const char* procName = nullptr;
+
+	if (feRenderUtil::IsExtensionSupported("GL_KHR_parallel_shader_compile")) procName = "glMaxShaderCompilerThreadsKHR";
+	else if (feRenderUtil::IsExtensionSupported("GL_ARB_parallel_shader_compile")) procName = "glMaxShaderCompilerThreadsARB";
+
+	if (procName)
+	{
+		feMaxShaderCompilerThreadsProc maxThreads = reinterpret_cast<feMaxShaderCompilerThreadsProc>(feRenderUtil::GetProcAddress(procName));
+
+		// Let the driver pick as many threads as it wants
+		if (maxThreads) maxThreads(0xFFFFFFFF);
+		m_Parallel = true;
+	}
+
+	feLog::Debug("Parallel shader compilation is {}", m_Parallel ? "supported" : "not supported, status queries are spread across frames");
+}
+
+void feProgramCompiler::Submit(const feProgramCompilerRequest* requests, size_t requestCount, feProgramCompilerHandle* handles)
+{
+	// Issue every compile before any link so the driver sees the whole batch at once
+	size_t first = m_Entries.size();
+
+	for (size_t i = 0; i < requestCount; ++i)
+	{
+		const feProgramCompilerRequest& request = requests[i];
+
+		feProgramCompilerEntry& entry = m_Entries.emplace_back();
+		entry.debugName = request.debugName ? request.debugName : "";
+		handles[i].index = m_Entries.size() - 1;
+
+		if (m_Cache && m_Cache->IsSupported())
+		{
+			entry.cacheKey = m_Cache->ComputeKey(request.shaderInfos, request.shaderInfoCount);
+
+			if (std::optional<feProgram> cached = m_Cache->Load(entry.cacheKey, request.debugName))
+			{
+				entry.program = std::move(*cached);
+				entry.state = feProgramCompilerState::Ready;
+				continue;
+			}
+		}
+
+		entry.shaders.reserve(request.shaderInfoCount);
+
+		for (size_t j = 0; j < request.shaderInfoCount; ++j)
+		{
+			feShaderCreateInfo shaderInfo = request.shaderInfos[j];
+			shaderInfo.deferStatus = true;
+			entry.shaders.emplace_back(shaderInfo);
+		}
+	}
+
+	for (size_t i = first; i < m_Entries.size(); ++i)
+	{
+		feProgramCompilerEntry& entry = m_Entries[i];
+
+		if (entry.state != feProgramCompilerState::Pending) continue;
+
+		feProgramCreateInfo programInfo;
+		programInfo.shaders = entry.shaders.data();
+		programInfo.shaderCount = entry.shaders.size();
+		programInfo.retrievable = m_Cache && m_Cache->IsSupported();
+		programInfo.deferStatus = true;
+		programInfo.debugName = entry.debugName.empty() ? nullptr : entry.debugName.c_str();
+
+		entry.program = programInfo;
+		m_Pending.push_back(i);
+	}
+}
+
+feProgramCompilerHandle feProgramCompiler::Submit(const feProgramCompilerRequest& request)
+{
+	feProgramCompilerHandle handle;
+	Submit(&request, 1, &handle);
+	return handle;
+}
+
+void feProgramCompiler::Poll()
+{
+	if (m_Pending.empty()) return;
+
+	size_t blocking = 0;
+	size_t kept = 0;
+
+	// Only pending entries are visited, finished ones drop out of the list in submission order
+	for (size_t index : m_Pending)
+	{
+		feProgramCompilerEntry& entry = m_Entries[index];
+		bool complete = false;
+
+		if (m_Parallel)
+		{
+			GLint status = GL_FALSE;
+			glGetProgramiv(entry.program.GetHandle(), FE_GL_COMPLETION_STATUS, &status);
+			complete = status == GL_TRUE;
+		}
+		else
+		{
+			complete = blocking++ < m_MaxBlockingPerPoll;
+		}
+
+		if (complete) Complete(entry);
+		else m_Pending[kept++] = index;
+	}
+
+	m_Pending.resize(kept);
+}
+
+feProgramCompilerState feProgramCompiler::GetState(feProgramCompilerHandle handle) const
+{
+	if (handle.index >= m_Entries.size()) return feProgramCompilerState::Failed;
+	return m_Entries[handle.index].state;
+}
+
+bool feProgramCompiler::IsReady(feProgramCompilerHandle handle) const
+{
+	return GetState(handle) == feProgramCompilerState::Ready;
+}
+
+bool feProgramCompiler::IsParallel() const
+{
+	return m_Parallel;
+}
+
+size_t feProgramCompiler::GetPendingCount() const
+{
+	return m_Pending.size();
+}
+
+feProgram feProgramCompiler::Take(feProgramCompilerHandle handle)
+{
+	if (!IsReady(handle))
+	{
+		feLog::Warn("Attempting to take a program that is not ready");
+		feLog::Break();
+		return feProgram();
+	}
+
+	feProgramCompilerEntry& entry = m_Entries[handle.index];
+	entry.state = feProgramCompilerState::Taken;
+	return std::move(entry.program);
+}
+
+void feProgramCompiler::Complete(feProgramCompilerEntry& entry)
+{
+	bool compiled = true;
+	for (const feShader& shader : entry.shaders) compiled &= shader.CheckStatus();
+
+	bool linked = compiled && entry.program.CompleteLink();
+
+	entry.shaders.clear();
+
+	if (!linked)
+	{
+		feLog::Error("Failed to build program {}", entry.debugName);
+		entry.program = feProgram();
+		entry.state = feProgramCompilerState::Failed;
+		return;
+	}
+
+	if (m_Cache) m_Cache->Store(entry.cacheKey, entry.program);
+
+	entry.state = feProgramCompilerState::Ready;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Shader.h"
+
+class feProgramCache;
+
+struct feProgramCompilerCreateInfo final
+{
+	// Optional, ready binaries are loaded from and finished programs are stored into it
+	feProgramCache* cache = nullptr;
+	// Without parallel compile support every status query blocks, this limits how many are done per Poll
+	size_t maxBlockingPerPoll = 1;
+};
+
+struct feProgramCompilerRequest final
+{
+	const feShaderCreateInfo* shaderInfos = nullptr;
+	size_t shaderInfoCount = 0;
+
+	const char* debugName = nullptr;
+};
+
+struct feProgramCompilerHandle final
+{
+	size_t index = SIZE_MAX;
+};
+
+enum class feProgramCompilerState
+{
+	Pending,
+	Ready,
+	Failed,
+	Taken
+};
+
+// Submits compile and link work without waiting on it, results are collected in Poll as the driver finishes them
+class feProgramCompiler final
+{
+public:
+	feProgramCompiler() = default;
+	feProgramCompiler(const feProgramCompilerCreateInfo& info);
+
+	feProgramCompiler(const feProgramCompiler&) = delete;
+	feProgramCompiler& operator=(const feProgramCompiler&) = delete;
+
+	feProgramCompiler(feProgramCompiler&& other) noexcept = default;
+	feProgramCompiler& operator=(feProgramCompiler&& other) noexcept = default;
+
+	void Submit(const feProgramCompilerRequest* requests, size_t requestCount, feProgramCompilerHandle* handles);
+	feProgramCompilerHandle Submit(const feProgramCompilerRequest& request);
+
+	// Call once per frame
+	void Poll();
+
+	[[nodiscard]] feProgramCompilerState GetState(feProgramCompilerHandle handle) const;
+	[[nodiscard]] bool IsReady(feProgramCompilerHandle handle) const;
+	[[nodiscard]] bool IsParallel() const;
+	[[nodiscard]] size_t GetPendingCount() const;
+
+	// Moves a ready program out of the compiler
+	feProgram Take(feProgramCompilerHandle handle);
+private:
+	struct feProgramCompilerEntry final
+	{
+		feProgram program;
+		std::vector<feShader> shaders;
+		std::string debugName;
+		uint64_t cacheKey = 0;
+		feProgramCompilerState state = feProgramCompilerState::Pending;
+	};
+
+	void Complete(feProgramCompilerEntry& entry);
+private:
+	// A deque keeps entries in place when more requests are submitted
+	std::deque<feProgramCompilerEntry> m_Entries;
+	// Indices of the entries still compiling, so Poll never walks finished ones
+	std::vector<size_t> m_Pending;
+	feProgramCache* m_Cache = nullptr;
+	size_t m_MaxBlockingPerPoll = 1;
+	bool m_Parallel = false;
+};
\ No newline at end of file
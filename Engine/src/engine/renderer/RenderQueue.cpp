@@ -0,0 +1,227 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "Shader.h"
+#include "RenderState.h"
+
+static constexpr uint32_t s_DepthMax = (1u << 24) - 1;
+
+feRenderQueue::feRenderQueue(const feRenderQueueCreateInfo& info)
+{
+	m_Heap = info.heap;
+	m_DepthProgram = info.depthProgram;
+	m_MaxDepth = info.maxDepth > 0.0f ? info.maxDepth : 1.0f;
+
+	SetDepthPrepass(info.depthPrepass);
+}
+
+void feRenderQueue::Begin(const glm::vec3& viewPosition)
+{
+	m_ViewPosition = viewPosition;
+	m_Commands.clear();
+	m_Entries.clear();
+	m_Stats = feRenderQueueStats();
+}
+
+void feRenderQueue::Submit(const feRenderCommand& command)
+{
+	if (!command.program || !command.mesh.IsValid()) return;
+
+	float distance = glm::length(glm::vec3(command.model[3]) - m_ViewPosition);
+	uint32_t depth = static_cast<uint32_t>(std::min(distance / m_MaxDepth, 1.0f) * s_DepthMax);
+
+	feRenderQueueEntry entry;
+	entry.key = MakeKey(command.layer, command.translucent, GetProgramId(command.program), static_cast<uint16_t>(command.mesh.format.index), depth);
+	entry.command = static_cast<uint32_t>(m_Commands.size());
+
+	m_Entries.push_back(entry);
+	m_Commands.push_back(command);
+}
+
+void feRenderQueue::Execute()
+{
+	if (m_Commands.empty()) return;
+
+	m_Stats.commands = m_Commands.size();
+	CountUnsortedChanges();
+	SortKeys();
+
+	if (m_DepthPrepass) ExecuteDepthPrepass();
+
+	const feProgram* program = nullptr;
+	size_t format = SIZE_MAX;
+	bool translucent = false;
+	feUniformSlot model;
+	feUniformSlot color;
+	feUniformSlot alpha;
+
+	feRenderState::SetBlend(false);
+	feRenderState::SetDepthWrite(!m_DepthPrepass);
+
+	for (const feRenderQueueEntry& entry : m_Entries)
+	{
+		const feRenderCommand& command = m_Commands[entry.command];
+
+		if (command.translucent != translucent)
+		{
+			translucent = command.translucent;
+
+			feRenderState::SetBlend(translucent);
+			if (translucent) feRenderState::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			// Translucent surfaces must not hide each other, after a prepass opaque depth is already complete
+			feRenderState::SetDepthWrite(!translucent && !m_DepthPrepass);
+		}
+
+		if (command.program != program)
+		{
+			program = command.program;
+			command.program->Bind();
+			model = command.program->GetUniformSlot("u_Model"_uniform);
+			color = command.program->GetUniformSlot("u_Color"_uniform);
+			alpha = command.program->GetUniformSlot("u_Alpha"_uniform);
+			++m_Stats.programChanges;
+		}
+
+		if (command.mesh.format.index != format)
+		{
+			format = command.mesh.format.index;
+			m_Heap->Bind(command.mesh.format);
+			++m_Stats.formatChanges;
+		}
+
+		command.program->UniformMat4f(model, command.model);
+		command.program->Uniform3f(color, glm::vec3(command.color));
+		command.program->Uniform1f(alpha, command.color.w);
+		m_Heap->Draw(command.mesh);
+	}
+
+	feRenderState::SetBlend(false);
+	feRenderState::SetDepthWrite(true);
+}
+
+void feRenderQueue::SetDepthPrepass(bool enabled)
+{
+	if (enabled && !m_DepthProgram)
+	{
+		feLog::Warn("Depth prepass requires a depth program");
+		enabled = false;
+	}
+
+	m_DepthPrepass = enabled;
+}
+
+const feRenderQueueStats& feRenderQueue::GetFrameStats() const
+{
+	return m_Stats;
+}
+
+uint64_t feRenderQueue::MakeKey(unsigned int layer, bool translucent, uint16_t program, uint16_t format, uint32_t depth)
+{
+	uint64_t key = static_cast<uint64_t>(layer & 0xF) << 60;
+	depth &= s_DepthMax;
+
+	if (translucent)
+	{
+		key |= 1ull << 59;
+		key |= static_cast<uint64_t>(s_DepthMax - depth) << 35;
+		key |= static_cast<uint64_t>(program) << 19;
+		key |= static_cast<uint64_t>(format) << 3;
+	}
+	else
+	{
+		key |= static_cast<uint64_t>(program) << 43;
+		key |= static_cast<uint64_t>(format) << 27;
+		key |= static_cast<uint64_t>(depth) << 3;
+	}
+
+	return key;
+}
+
+uint16_t feRenderQueue::GetProgramId(const feProgram* program)
+{
+	auto it = m_ProgramIds.find(program);
+	if (it != m_ProgramIds.end()) return it->second;
+
+	if (m_ProgramIds.size() > UINT16_MAX) feLog::Warn("Render queue has run out of program ids, sorting by program degrades");
+
+	uint16_t id = static_cast<uint16_t>(m_ProgramIds.size());
+	m_ProgramIds.emplace(program, id);
+	return id;
+}
+
+void feRenderQueue::SortKeys()
+{
+	// Least significant digit radix sort, one byte per pass. Passes where every key has the same byte are skipped,
+	// which is most of them when only a few programs and formats are in use.
+	m_Scratch.resize(m_Entries.size());
+
+	uint64_t differing = 0;
+	for (const feRenderQueueEntry& entry : m_Entries) differing |= entry.key ^ m_Entries[0].key;
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		if (((differing >> shift) & 0xFF) == 0) continue;
+
+		size_t counts[256] = {};
+		for (const feRenderQueueEntry& entry : m_Entries) ++counts[(entry.key >> shift) & 0xFF];
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			size_t next = offset + count;
+			count = offset;
+			offset = next;
+		}
+
+		for (const feRenderQueueEntry& entry : m_Entries) m_Scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+
+		m_Entries.swap(m_Scratch);
+	}
+}
+
+void feRenderQueue::ExecuteDepthPrepass()
+{
+	m_DepthProgram->Bind();
+	feUniformSlot model = m_DepthProgram->GetUniformSlot("u_Model"_uniform);
+
+	feRenderState::SetColorWrite(false);
+	feRenderState::SetDepthWrite(true);
+
+	size_t format = SIZE_MAX;
+
+	for (const feRenderQueueEntry& entry : m_Entries)
+	{
+		const feRenderCommand& command = m_Commands[entry.command];
+		if (command.translucent) continue;
+
+		if (command.mesh.format.index != format)
+		{
+			format = command.mesh.format.index;
+			m_Heap->Bind(command.mesh.format);
+		}
+
+		m_DepthProgram->UniformMat4f(model, command.model);
+		m_Heap->Draw(command.mesh);
+	}
+
+	feRenderState::SetColorWrite(true);
+}
+
+void feRenderQueue::CountUnsortedChanges()
+{
+	const feProgram* program = nullptr;
+	size_t format = SIZE_MAX;
+
+	for (const feRenderCommand& command : m_Commands)
+	{
+		if (command.program != program) ++m_Stats.unsortedProgramChanges;
+		if (command.mesh.format.index != format) ++m_Stats.unsortedFormatChanges;
+
+		program = command.program;
+		format = command.mesh.format.index;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BufferHeap.h"
+
+class feProgram;
+
+struct feRenderQueueCreateInfo final
+{
+	// Meshes drawn through the queue must live in this heap
+	const feMeshHeap* heap = nullptr;
+	// Lays down depth for every opaque command before shading, needs depthProgram
+	bool depthPrepass = false;
+	// Only has to write depth, takes u_Model like the programs it stands in for
+	feProgram* depthProgram = nullptr;
+	// View distances beyond this all share the last depth bucket
+	float maxDepth = 1000.0f;
+};
+
+// Programs take u_Model, u_Color and optionally u_Alpha
+struct feRenderCommand final
+{
+	feProgram* program = nullptr;
+	feMeshAllocation mesh;
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec4 color = glm::vec4(1.0f);
+	// Lower layers are drawn first, 0 to 15
+	unsigned int layer = 0;
+	// Drawn after the opaque commands of the same layer, back to front with blending
+	bool translucent = false;
+};
+
+struct feRenderQueueStats final
+{
+	uint64_t commands = 0;
+	uint64_t programChanges = 0;
+	uint64_t formatChanges = 0;
+	// What the same commands would have cost drawn in submission order
+	uint64_t unsortedProgramChanges = 0;
+	uint64_t unsortedFormatChanges = 0;
+};
+
+// Sorts the frame's draws by a packed 64 bit key and executes them in that order. From the top bit down the key is
+// layer (4), translucency (1), then program (16), format (16) and front to back depth (24) for opaque commands, or
+// back to front depth (24), program and format for translucent ones.
+class feRenderQueue final
+{
+public:
+	feRenderQueue() = default;
+	feRenderQueue(const feRenderQueueCreateInfo& info);
+
+	feRenderQueue(const feRenderQueue&) = delete;
+	feRenderQueue& operator=(const feRenderQueue&) = delete;
+
+	feRenderQueue(feRenderQueue&& other) noexcept = default;
+	feRenderQueue& operator=(feRenderQueue&& other) noexcept = default;
+
+	// Depth is measured from viewPosition to the translation of each command's model matrix
+	void Begin(const glm::vec3& viewPosition);
+	// The program has to stay alive until Execute
+	void Submit(const feRenderCommand& command);
+	void Execute();
+
+	void SetDepthPrepass(bool enabled);
+	[[nodiscard]] const feRenderQueueStats& GetFrameStats() const;
+
+	static uint64_t MakeKey(unsigned int layer, bool translucent, uint16_t program, uint16_t format, uint32_t depth);
+private:
+	uint16_t GetProgramId(const feProgram* program);
+	void SortKeys();
+	void ExecuteDepthPrepass();
+	void CountUnsortedChanges();
+private:
+	struct feRenderQueueEntry final
+	{
+		uint64_t key = 0;
+		uint32_t command = 0;
+	};
+
+	const feMeshHeap* m_Heap = nullptr;
+	bool m_DepthPrepass = false;
+	feProgram* m_DepthProgram = nullptr;
+	float m_MaxDepth = 0.0f;
+	glm::vec3 m_ViewPosition = glm::vec3(0.0f);
+	std::vector<feRenderCommand> m_Commands;
+	std::vector<feRenderQueueEntry> m_Entries;
+	std::vector<feRenderQueueEntry> m_Scratch;
+	// Small ids keep program pointers out of the key, they are handed out in first use order
+	std::unordered_map<const feProgram*, uint16_t> m_ProgramIds;
+	feRenderQueueStats m_Stats;
+};
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "RenderState.h"
+
+#include <glad/gl.h>
+
+static constexpr unsigned int s_Unknown = 0xFFFFFFFF;
+static constexpr size_t s_IndexedBindingCount = 16;
+
+enum feBufferTargetIndex : size_t
+{
+	FE_BUFFER_TARGET_ARRAY,
+	FE_BUFFER_TARGET_ELEMENT_ARRAY,
+	FE_BUFFER_TARGET_UNIFORM,
+	FE_BUFFER_TARGET_SHADER_STORAGE,
+	FE_BUFFER_TARGET_DRAW_INDIRECT,
+	FE_BUFFER_TARGET_COPY_READ,
+	FE_BUFFER_TARGET_COPY_WRITE,
+	FE_BUFFER_TARGET_PIXEL_PACK,
+	FE_BUFFER_TARGET_PIXEL_UNPACK,
+	FE_BUFFER_TARGET_COUNT,
+	FE_BUFFER_TARGET_UNTRACKED = FE_BUFFER_TARGET_COUNT
+};
+
+// Booleans are stored as 0 or 1, s_Unknown marks anything that has to be sent regardless
+static struct feRenderStateShadow final
+{
+	unsigned int program = s_Unknown;
+	unsigned int vertexArray = s_Unknown;
+	unsigned int buffers[FE_BUFFER_TARGET_COUNT];
+	unsigned int uniformBindings[s_IndexedBindingCount];
+	unsigned int storageBindings[s_IndexedBindingCount];
+
+	unsigned int depthTest = s_Unknown;
+	unsigned int depthWrite = s_Unknown;
+	unsigned int depthFunc = s_Unknown;
+	unsigned int cullFace = s_Unknown;
+	unsigned int cullMode = s_Unknown;
+	unsigned int blend = s_Unknown;
+	unsigned int blendSrc = s_Unknown;
+	unsigned int blendDst = s_Unknown;
+	unsigned int colorWrite = s_Unknown;
+	int viewport[4] = { -1, -1, -1, -1 };
+
+	feRenderStateShadow()
+	{
+		for (unsigned int& buffer : buffers) buffer = s_Unknown;
+		for (unsigned int& binding : uniformBindings) binding = s_Unknown;
+		for (unsigned int& binding : storageBindings) binding = s_Unknown;
+	}
+} s_Shadow;
+
+static feRenderStateStats s_FrameStats;
+static feRenderStateStats s_TotalStats;
+
+static size_t GetTargetIndex(unsigned int target)
+{
+	switch (target)
+	{
+		case GL_ARRAY_BUFFER: return FE_BUFFER_TARGET_ARRAY;
+		case GL_ELEMENT_ARRAY_BUFFER: return FE_BUFFER_TARGET_ELEMENT_ARRAY;
+		case GL_UNIFORM_BUFFER: return FE_BUFFER_TARGET_UNIFORM;
+		case GL_SHADER_STORAGE_BUFFER: return FE_BUFFER_TARGET_SHADER_STORAGE;
+		case GL_DRAW_INDIRECT_BUFFER: return FE_BUFFER_TARGET_DRAW_INDIRECT;
+		case GL_COPY_READ_BUFFER: return FE_BUFFER_TARGET_COPY_READ;
+		case GL_COPY_WRITE_BUFFER: return FE_BUFFER_TARGET_COPY_WRITE;
+		case GL_PIXEL_PACK_BUFFER: return FE_BUFFER_TARGET_PIXEL_PACK;
+		case GL_PIXEL_UNPACK_BUFFER: return FE_BUFFER_TARGET_PIXEL_UNPACK;
+		default: return FE_BUFFER_TARGET_UNTRACKED;
+	}
+}
+
+static unsigned int* GetIndexedBindings(unsigned int target)
+{
+	switch (target)
+	{
+		case GL_UNIFORM_BUFFER: return s_Shadow.uniformBindings;
+		case GL_SHADER_STORAGE_BUFFER: return s_Shadow.storageBindings;
+		default: return nullptr;
+	}
+}
+
+// Returns true when the call has to be issued and records the new value
+static bool Update(unsigned int& shadow, unsigned int value)
+{
+	if (shadow == value)
+	{
+		++s_FrameStats.elided;
+		return false;
+	}
+
+	shadow = value;
+	++s_FrameStats.issued;
+	return true;
+}
+
+static void SetCapability(unsigned int& shadow, unsigned int capability, bool enabled)
+{
+	if (!Update(shadow, enabled ? 1 : 0)) return;
+
+	if (enabled) glEnable(capability);
+	else glDisable(capability);
+}
+
+namespace feRenderState
+{
+	void Invalidate()
+	{
+		s_Shadow = feRenderStateShadow();
+	}
+
+	void UseProgram(unsigned int handle)
+	{
+		if (Update(s_Shadow.program, handle)) glUseProgram(handle);
+	}
+
+	void BindVertexArray(unsigned int handle)
+	{
+		if (!Update(s_Shadow.vertexArray, handle)) return;
+
+		glBindVertexArray(handle);
+
+		// The element array binding belongs to the vertex array
+		s_Shadow.buffers[FE_BUFFER_TARGET_ELEMENT_ARRAY] = s_Unknown;
+	}
+
+	void BindBuffer(unsigned int target, unsigned int handle)
+	{
+		size_t index = GetTargetIndex(target);
+
+		if (index == FE_BUFFER_TARGET_UNTRACKED)
+		{
+			++s_FrameStats.issued;
+			glBindBuffer(target, handle);
+			return;
+		}
+
+		if (Update(s_Shadow.buffers[index], handle)) glBindBuffer(target, handle);
+	}
+
+	void BindBufferBase(unsigned int target, unsigned int index, unsigned int handle)
+	{
+		unsigned int* bindings = GetIndexedBindings(target);
+
+		if (!bindings || index >= s_IndexedBindingCount)
+		{
+			++s_FrameStats.issued;
+			glBindBufferBase(target, index, handle);
+		}
+		else if (Update(bindings[index], handle))
+		{
+			glBindBufferBase(target, index, handle);
+		}
+		else
+		{
+			return;
+		}
+
+		// Binding to an indexed point also replaces the generic binding
+		size_t targetIndex = GetTargetIndex(target);
+		if (targetIndex != FE_BUFFER_TARGET_UNTRACKED) s_Shadow.buffers[targetIndex] = handle;
+	}
+
+	void BindBufferRange(unsigned int target, unsigned int index, unsigned int handle, size_t offset, size_t size)
+	{
+		// Ranges move every frame when streaming, so they are always issued and only invalidate the shadow
+		++s_FrameStats.issued;
+		glBindBufferRange(target, index, handle, offset, size);
+
+		unsigned int* bindings = GetIndexedBindings(target);
+		if (bindings && index < s_IndexedBindingCount) bindings[index] = s_Unknown;
+
+		size_t targetIndex = GetTargetIndex(target);
+		if (targetIndex != FE_BUFFER_TARGET_UNTRACKED) s_Shadow.buffers[targetIndex] = handle;
+	}
+
+	void SetDepthTest(bool enabled)
+	{
+		SetCapability(s_Shadow.depthTest, GL_DEPTH_TEST, enabled);
+	}
+
+	void SetDepthWrite(bool enabled)
+	{
+		if (Update(s_Shadow.depthWrite, enabled ? 1 : 0)) glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+
+	void SetDepthFunc(unsigned int func)
+	{
+		if (Update(s_Shadow.depthFunc, func)) glDepthFunc(func);
+	}
+
+	void SetCullFace(bool enabled)
+	{
+		SetCapability(s_Shadow.cullFace, GL_CULL_FACE, enabled);
+	}
+
+	void SetCullMode(unsigned int face)
+	{
+		if (Update(s_Shadow.cullMode, face)) glCullFace(face);
+	}
+
+	void SetColorWrite(bool enabled)
+	{
+		GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+		if (Update(s_Shadow.colorWrite, enabled ? 1 : 0)) glColorMask(mask, mask, mask, mask);
+	}
+
+	void SetBlend(bool enabled)
+	{
+		SetCapability(s_Shadow.blend, GL_BLEND, enabled);
+	}
+
+	void SetBlendFunc(unsigned int src, unsigned int dst)
+	{
+		if (s_Shadow.blendSrc == src && s_Shadow.blendDst == dst)
+		{
+			++s_FrameStats.elided;
+			return;
+		}
+
+		s_Shadow.blendSrc = src;
+		s_Shadow.blendDst = dst;
+		++s_FrameStats.issued;
+		glBlendFunc(src, dst);
+	}
+
+	void SetViewport(int x, int y, int w, int h)
+	{
+		int* viewport = s_Shadow.viewport;
+
+		if (viewport[0] == x && viewport[1] == y && viewport[2] == w && viewport[3] == h)
+		{
+			++s_FrameStats.elided;
+			return;
+		}
+
+		viewport[0] = x;
+		viewport[1] = y;
+		viewport[2] = w;
+		viewport[3] = h;
+		++s_FrameStats.issued;
+		glViewport(x, y, w, h);
+	}
+
+	void OnDeleteProgram(unsigned int handle)
+	{
+		// A program in use is only flagged for deletion and stays bound, so the next bind has to reach GL even for 0
+		if (s_Shadow.program == handle) s_Shadow.program = s_Unknown;
+	}
+
+	void OnDeleteVertexArray(unsigned int handle)
+	{
+		if (s_Shadow.vertexArray != handle) return;
+
+		s_Shadow.vertexArray = 0;
+		s_Shadow.buffers[FE_BUFFER_TARGET_ELEMENT_ARRAY] = s_Unknown;
+	}
+
+	void OnDeleteBuffer(unsigned int handle)
+	{
+		for (unsigned int& buffer : s_Shadow.buffers) if (buffer == handle) buffer = 0;
+		for (unsigned int& binding : s_Shadow.uniformBindings) if (binding == handle) binding = 0;
+		for (unsigned int& binding : s_Shadow.storageBindings) if (binding == handle) binding = 0;
+	}
+
+	void BeginFrame()
+	{
+		s_TotalStats.issued += s_FrameStats.issued;
+		s_TotalStats.elided += s_FrameStats.elided;
+		s_FrameStats = feRenderStateStats();
+	}
+
+	const feRenderStateStats& GetFrameStats()
+	{
+		return s_FrameStats;
+	}
+
+	const feRenderStateStats& GetTotalStats()
+	{
+		return s_TotalStats;
+	}
+}
\ No newline at end of file
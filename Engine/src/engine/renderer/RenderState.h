@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+struct feRenderStateStats final
+{
+	uint64_t issued = 0;
+	uint64_t elided = 0;
+};
+
+// Shadows bound objects and fixed function state so that calls which would not change anything never reach the driver.
+// Every renderer class binds through here, raw GL binds elsewhere must be followed by Invalidate.
+namespace feRenderState
+{
+	// Forget everything that is shadowed, required after a new context is made current
+	void Invalidate();
+
+	void UseProgram(unsigned int handle);
+	void BindVertexArray(unsigned int handle);
+	void BindBuffer(unsigned int target, unsigned int handle);
+	void BindBufferBase(unsigned int target, unsigned int index, unsigned int handle);
+	void BindBufferRange(unsigned int target, unsigned int index, unsigned int handle, size_t offset, size_t size);
+
+	void SetDepthTest(bool enabled);
+	void SetDepthWrite(bool enabled);
+	void SetDepthFunc(unsigned int func);
+	void SetCullFace(bool enabled);
+	void SetCullMode(unsigned int face);
+	// All four channels at once
+	void SetColorWrite(bool enabled);
+	void SetBlend(bool enabled);
+	void SetBlendFunc(unsigned int src, unsigned int dst);
+	void SetViewport(int x, int y, int w, int h);
+
+	// Deleting a bound object implicitly unbinds it, these keep the shadow state in sync
+	void OnDeleteProgram(unsigned int handle);
+	void OnDeleteVertexArray(unsigned int handle);
+	void OnDeleteBuffer(unsigned int handle);
+
+	// Starts counting a new frame, the previous frame is added to the totals
+	void BeginFrame();
+	const feRenderStateStats& GetFrameStats();
+	const feRenderStateStats& GetTotalStats();
+};
\ No newline at end of file
@@ -2,12 +2,64 @@
 
 #include <utility>
 #include <memory>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
 
 #include <glad/gl.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "../Log.h"
 #include "Util.h"
+#include "UniformBuffer.h"
+#include "RenderState.h"
+
+// Size in bytes of a single element of a uniform type, 0 for types that are not shadowed
+static size_t GetUniformTypeSize(GLenum type)
+{
+	switch (type)
+	{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_BOOL:
+			return 4;
+		case GL_FLOAT_VEC2:
+		case GL_INT_VEC2:
+		case GL_UNSIGNED_INT_VEC2:
+		case GL_BOOL_VEC2:
+			return 8;
+		case GL_FLOAT_VEC3:
+		case GL_INT_VEC3:
+		case GL_UNSIGNED_INT_VEC3:
+		case GL_BOOL_VEC3:
+			return 12;
+		case GL_FLOAT_VEC4:
+		case GL_INT_VEC4:
+		case GL_UNSIGNED_INT_VEC4:
+		case GL_BOOL_VEC4:
+		case GL_FLOAT_MAT2:
+			return 16;
+		case GL_FLOAT_MAT3:
+			return 36;
+		case GL_FLOAT_MAT4:
+			return 64;
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+			return 4;
+		default:
+			return 0;
+	}
+}
 
 feShader::feShader(unsigned int handle)
 	: m_Handle(handle)
@@ -25,19 +77,7 @@ feShader::feShader(const feShaderCreateInfo& info)
 
 	glCompileShader(m_Handle);
 
-	GLint status;
-	glGetShaderiv(m_Handle, GL_COMPILE_STATUS, &status);
-
-	if (status != GL_TRUE)
-	{
-		GLint length;
-		glGetShaderiv(m_Handle, GL_INFO_LOG_LENGTH, &length);
-
-		std::unique_ptr<GLchar[]> message = std::make_unique<GLchar[]>(length);
-		glGetShaderInfoLog(m_Handle, length, &length, message.get());
-
-		feLog::Error("Shader compilation failed: {}", message.get());
-	}
+	if (!info.deferStatus) CheckStatus();
 
 	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_SHADER, m_Handle, -1, info.debugName);
 
@@ -64,8 +104,27 @@ feShader& feShader::operator=(feShader&& other) noexcept
 	return *this;
 }
 
+bool feShader::CheckStatus() const
+{
+	GLint status;
+	glGetShaderiv(m_Handle, GL_COMPILE_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		GLint length;
+		glGetShaderiv(m_Handle, GL_INFO_LOG_LENGTH, &length);
+
+		std::unique_ptr<GLchar[]> message = std::make_unique<GLchar[]>(length);
+		glGetShaderInfoLog(m_Handle, length, &length, message.get());
+
+		feLog::Error("Shader compilation failed: {}", message.get());
+	}
+
+	return status == GL_TRUE;
+}
+
 feProgram::feProgram(unsigned int handle)
-	: m_Handle(handle)
+	: m_Handle(handle), m_Linked(handle != 0)
 {
 }
 
@@ -73,6 +132,8 @@ feProgram::feProgram(const feProgramCreateInfo& info)
 {
 	m_Handle = glCreateProgram();
 
+	if (info.retrievable) glProgramParameteri(m_Handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	for (size_t i = 0; i < info.shaderCount; ++i)
 		glAttachShader(m_Handle, info.shaders[i].m_Handle);
 
@@ -81,24 +142,38 @@ feProgram::feProgram(const feProgramCreateInfo& info)
 	for (size_t i = 0; i < info.shaderCount; ++i)
 		glDetachShader(m_Handle, info.shaders[i].m_Handle);
 
+	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_PROGRAM, m_Handle, -1, info.debugName);
+
+	feLog::Trace("Created Program");
+
+	if (!info.deferStatus) CompleteLink();
+}
+
+feProgram::feProgram(const feProgramBinaryCreateInfo& info)
+{
+	m_Handle = glCreateProgram();
+
+	glProgramBinary(m_Handle, info.format, info.data, static_cast<GLsizei>(info.size));
+
 	GLint status;
 	glGetProgramiv(m_Handle, GL_LINK_STATUS, &status);
 
+	// Drivers reject binaries after updates or hardware changes, this is expected so the caller is left to fall back
 	if (status != GL_TRUE)
 	{
-		GLint length;
-		glGetProgramiv(m_Handle, GL_INFO_LOG_LENGTH, &length);
-
-		std::unique_ptr<GLchar[]> message = std::make_unique<GLchar[]>(length);
-		glGetProgramInfoLog(m_Handle, length, &length, message.get());
-
-		feLog::Error("Program linking failed: {}", message.get());
+		feLog::Trace("Program binary was rejected by the driver");
+		return;
 	}
 
 	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_PROGRAM, m_Handle, -1, info.debugName);
 
-	feLog::Trace("Created Program");
+	feLog::Trace("Created Program from binary");
 
+	m_Linked = LoadUniforms();
+}
+
+bool feProgram::LoadUniforms()
+{
 	// Load uniforms from shaders into cache
 
 	GLint uniformCount = 0;
@@ -113,22 +188,75 @@ feProgram::feProgram(const feProgramCreateInfo& info)
 		glGetProgramiv(m_Handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_len);
 
 		std::unique_ptr<char[]> uniform_name = std::make_unique<char[]>(max_name_len);
+		std::unordered_map<uint32_t, std::string> names;
 
 		for (GLint i = 0; i < uniformCount; ++i)
 		{
 			glGetActiveUniform(m_Handle, i, max_name_len, &length, &count, &type, uniform_name.get());
 
-			std::string name = std::string(uniform_name.get());
-			GLint location = glGetUniformLocation(m_Handle, name.c_str());
-			m_Uniforms.emplace(std::make_pair(std::move(name), location));
+			GLint location = glGetUniformLocation(m_Handle, uniform_name.get());
+
+			// Members of uniform blocks have no location, they are sourced from uniform buffers
+			if (location < 0) continue;
+
+			size_t size = GetUniformTypeSize(type);
+			uint32_t hash = feHash::Fnv1a32(std::string_view(uniform_name.get(), length));
+
+			// Two names on one slot would silently write to the same uniform, the program is unusable until one is renamed
+			auto [collision, inserted] = names.emplace(hash, uniform_name.get());
+			if (!inserted)
+			{
+				feLog::Error("Uniforms {} and {} have the same name hash, rename one of them", collision->second, uniform_name.get());
+				m_Uniforms.clear();
+				m_UniformShadow.clear();
+				return false;
+			}
+
+			m_Uniforms.push_back(feProgramUniform{ hash, location, m_UniformShadow.size(), size, false });
+			m_UniformShadow.resize(m_UniformShadow.size() + size);
+
+			feLog::Trace(uniform_name.get());
 		}
+
+		std::sort(m_Uniforms.begin(), m_Uniforms.end(), [](const feProgramUniform& a, const feProgramUniform& b)
+		{
+			return a.hash < b.hash;
+		});
 	}
 
-	feLog::Trace("Loaded {} uniforms", uniformCount);
-	for (const auto& [k, v] : m_Uniforms)
+	feLog::Trace("Loaded {} uniforms", m_Uniforms.size());
+
+	// Bind uniform blocks to the fixed binding points of the shared uniform buffers
+
+	GLint blockCount = 0;
+	glGetProgramiv(m_Handle, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+
+	if (blockCount > 0)
 	{
-		feLog::Trace(k);
+		GLint max_name_len = 0;
+		GLsizei length = 0;
+		glGetProgramiv(m_Handle, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_name_len);
+
+		std::unique_ptr<char[]> block_name = std::make_unique<char[]>(max_name_len);
+
+		for (GLint i = 0; i < blockCount; ++i)
+		{
+			glGetActiveUniformBlockName(m_Handle, i, max_name_len, &length, block_name.get());
+
+			int binding = feUniformBlocks::GetBinding(std::string_view(block_name.get(), length));
+
+			if (binding < 0)
+			{
+				feLog::Warn("Uniform block {} has no known binding point", block_name.get());
+				continue;
+			}
+
+			glUniformBlockBinding(m_Handle, i, binding);
+			feLog::Trace("Bound uniform block {} to {}", block_name.get(), binding);
+		}
 	}
+
+	return true;
 }
 
 feProgram::~feProgram() noexcept
@@ -137,91 +265,197 @@ feProgram::~feProgram() noexcept
 	{
 		feLog::Trace("Deleted Program");
 		glDeleteProgram(m_Handle);
+		feRenderState::OnDeleteProgram(m_Handle);
 	}
 }
 
 feProgram::feProgram(feProgram&& other) noexcept
 {
 	std::swap(m_Handle, other.m_Handle);
+	std::swap(m_Linked, other.m_Linked);
 	std::swap(m_Uniforms, other.m_Uniforms);
+	std::swap(m_UniformShadow, other.m_UniformShadow);
+	std::swap(m_UploadStats, other.m_UploadStats);
 }
 
 feProgram& feProgram::operator=(feProgram&& other) noexcept
 {
 	std::swap(m_Handle, other.m_Handle);
+	std::swap(m_Linked, other.m_Linked);
 	std::swap(m_Uniforms, other.m_Uniforms);
+	std::swap(m_UniformShadow, other.m_UniformShadow);
+	std::swap(m_UploadStats, other.m_UploadStats);
 	return *this;
 }
 
 void feProgram::Bind() const
 {
-	glUseProgram(m_Handle);
+	feRenderState::UseProgram(m_Handle);
+}
+
+bool feProgram::CompleteLink()
+{
+	GLint status;
+	glGetProgramiv(m_Handle, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		GLint length;
+		glGetProgramiv(m_Handle, GL_INFO_LOG_LENGTH, &length);
+
+		std::unique_ptr<GLchar[]> message = std::make_unique<GLchar[]>(length);
+		glGetProgramInfoLog(m_Handle, length, &length, message.get());
+
+		feLog::Error("Program linking failed: {}", message.get());
+	}
+
+	m_Linked = status == GL_TRUE && LoadUniforms();
+
+	return m_Linked;
+}
+
+bool feProgram::IsLinked() const
+{
+	return m_Linked;
 }
 
-static std::string s_TempUniformContainer(64, '!');
+unsigned int feProgram::GetHandle() const
+{
+	return m_Handle;
+}
 
-int feProgram::GetUniformLocation(std::string_view name) const
+bool feProgram::GetBinary(unsigned int& format, std::vector<unsigned char>& binary) const
 {
-	s_TempUniformContainer = name;
+	if (!m_Linked) return false;
 
-	auto result = m_Uniforms.find(s_TempUniformContainer);
+	GLint length = 0;
+	glGetProgramiv(m_Handle, GL_PROGRAM_BINARY_LENGTH, &length);
 
-	if (result != m_Uniforms.end()) return result->second;
+	if (length <= 0) return false;
 
-	return -1;
+	binary.resize(length);
+
+	GLenum binaryFormat = GL_NONE;
+	glGetProgramBinary(m_Handle, length, &length, &binaryFormat, binary.data());
+	binary.resize(length);
+	format = binaryFormat;
+
+	return length > 0;
 }
 
-void feProgram::Uniform1f(std::string_view name, float v0) const
+feUniformSlot feProgram::GetUniformSlot(feUniformName name) const
 {
-	glUniform1f(GetUniformLocation(name), v0);
+	auto result = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), name.hash, [](const feProgramUniform& uniform, uint32_t hash)
+	{
+		return uniform.hash < hash;
+	});
+
+	if (result != m_Uniforms.end() && result->hash == name.hash) return feUniformSlot{ static_cast<int>(result - m_Uniforms.begin()) };
+
+	return feUniformSlot();
 }
 
-void feProgram::Uniform2f(std::string_view name, const glm::vec2& v0) const
+feUniformSlot feProgram::GetUniformSlot(std::string_view name) const
 {
-	glUniform2fv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	return GetUniformSlot(feUniformName{ feHash::Fnv1a32(name) });
+}
+
+int feProgram::GetUniformLocation(feUniformSlot slot) const
+{
+	if (slot.index < 0 || static_cast<size_t>(slot.index) >= m_Uniforms.size()) return -1;
+
+	return m_Uniforms[slot.index].location;
 }
 
-void feProgram::Uniform3f(std::string_view name, const glm::vec3& v0) const
+void feProgram::Uniform1f(feUniformSlot slot, float v0)
 {
-	glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform1f(GetUniformLocation(slot), v0);
 }
 
-void feProgram::Uniform4f(std::string_view name, const glm::vec4& v0) const
+void feProgram::Uniform2f(feUniformSlot slot, const glm::vec2& v0)
 {
-	glUniform4fv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform2fv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::Uniform1i(std::string_view name, int v0) const
+void feProgram::Uniform3f(feUniformSlot slot, const glm::vec3& v0)
 {
-	glUniform1i(GetUniformLocation(name), v0);
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform3fv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::Uniform2i(std::string_view name, const glm::ivec2& v0) const
+void feProgram::Uniform4f(feUniformSlot slot, const glm::vec4& v0)
 {
-	glUniform2iv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform4fv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::Uniform3i(std::string_view name, const glm::ivec3& v0) const
+void feProgram::Uniform1i(feUniformSlot slot, int v0)
 {
-	glUniform3iv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform1i(GetUniformLocation(slot), v0);
 }
 
-void feProgram::Uniform4i(std::string_view name, const glm::ivec4& v0) const
+void feProgram::Uniform2i(feUniformSlot slot, const glm::ivec2& v0)
 {
-	glUniform4iv(GetUniformLocation(name), 1, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform2iv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::UniformMat2f(std::string_view name, const glm::mat2& v0) const
+void feProgram::Uniform3i(feUniformSlot slot, const glm::ivec3& v0)
 {
-	glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform3iv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::UniformMat3f(std::string_view name, const glm::mat3& v0) const
+void feProgram::Uniform4i(feUniformSlot slot, const glm::ivec4& v0)
 {
-	glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniform4iv(GetUniformLocation(slot), 1, glm::value_ptr(v0));
 }
 
-void feProgram::UniformMat4f(std::string_view name, const glm::mat4& v0) const
+void feProgram::UniformMat2f(feUniformSlot slot, const glm::mat2& v0)
 {
-	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(v0));
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniformMatrix2fv(GetUniformLocation(slot), 1, GL_FALSE, glm::value_ptr(v0));
+}
+
+void feProgram::UniformMat3f(feUniformSlot slot, const glm::mat3& v0)
+{
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniformMatrix3fv(GetUniformLocation(slot), 1, GL_FALSE, glm::value_ptr(v0));
+}
+
+void feProgram::UniformMat4f(feUniformSlot slot, const glm::mat4& v0)
+{
+	if (ShouldUpload(slot, &v0, sizeof(v0))) glUniformMatrix4fv(GetUniformLocation(slot), 1, GL_FALSE, glm::value_ptr(v0));
+}
+
+const feUniformUploadStats& feProgram::GetUploadStats() const
+{
+	return m_UploadStats;
+}
+
+void feProgram::ResetUploadStats()
+{
+	m_UploadStats = feUniformUploadStats();
+}
+
+bool feProgram::ShouldUpload(feUniformSlot slot, const void* data, size_t size)
+{
+	// Uploading to location -1 is a no-op in OpenGL, so unknown slots can be dropped entirely
+	if (slot.index < 0 || static_cast<size_t>(slot.index) >= m_Uniforms.size()) return false;
+
+	feProgramUniform& uniform = m_Uniforms[slot.index];
+
+	// Mismatched types are left to OpenGL to report
+	if (uniform.size != size)
+	{
+		++m_UploadStats.issued;
+		return true;
+	}
+
+	unsigned char* shadow = m_UniformShadow.data() + uniform.offset;
+
+	if (uniform.shadowed && std::memcmp(shadow, data, size) == 0)
+	{
+		++m_UploadStats.skipped;
+		return false;
+	}
+
+	std::memcpy(shadow, data, size);
+	uniform.shadowed = true;
+	++m_UploadStats.issued;
+	return true;
 }
\ No newline at end of file
@@ -1,18 +1,20 @@
 #pragma once
 
 #include <string_view>
-#include <unordered_map>
-#include <string>
-#include <string_view>
-#include <functional>
+#include <vector>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
+#include "../util/Hash.h"
+
 struct feShaderCreateInfo final
 {
 	unsigned int type = 0;
 	std::string_view* sources = nullptr;
 	size_t sourceCount = 0;
+	// Skip querying the compile status so the driver can keep working, call CheckStatus later
+	bool deferStatus = false;
 
 	const char* debugName = nullptr;
 };
@@ -29,16 +31,55 @@ public:
 
 	feShader(feShader&& other) noexcept;
 	feShader& operator=(feShader&& other) noexcept;
+
+	// Blocks until compilation finished, logs and returns false on failure
+	bool CheckStatus() const;
 private:
 	friend class feProgram;
 
 	unsigned int m_Handle = 0;
 };
 
+// Hashed uniform name, prefer the "u_Name"_uniform literal so the hash is computed at compile time
+struct feUniformName final
+{
+	uint32_t hash = 0;
+};
+
+constexpr feUniformName operator""_uniform(const char* name, size_t length)
+{
+	return feUniformName{ feHash::Fnv1a32(std::string_view(name, length)) };
+}
+
+// Index into the uniform table of a single program, resolve once and reuse every draw
+struct feUniformSlot final
+{
+	int index = -1;
+};
+
+struct feUniformUploadStats final
+{
+	uint64_t issued = 0;
+	uint64_t skipped = 0;
+};
+
 struct feProgramCreateInfo final
 {
 	feShader* shaders = nullptr;
 	size_t shaderCount = 0;
+	// Hint that GetBinary will be called so the driver keeps the binary around
+	bool retrievable = false;
+	// Skip querying the link status so the driver can keep working, call CompleteLink later
+	bool deferStatus = false;
+
+	const char* debugName = nullptr;
+};
+
+struct feProgramBinaryCreateInfo final
+{
+	unsigned int format = 0;
+	const void* data = nullptr;
+	size_t size = 0;
 
 	const char* debugName = nullptr;
 };
@@ -48,6 +89,7 @@ class feProgram final
 public:
 	feProgram(unsigned int handle = 0);
 	feProgram(const feProgramCreateInfo& info);
+	feProgram(const feProgramBinaryCreateInfo& info);
 	~feProgram() noexcept;
 
 	feProgram(const feProgram&) = delete;
@@ -57,20 +99,50 @@ public:
 	feProgram& operator=(feProgram&& other) noexcept;
 
 	void Bind() const;
+	// Blocks until linking finished and loads the uniforms, logs and returns false on failure
+	bool CompleteLink();
+	[[nodiscard]] bool IsLinked() const;
+	[[nodiscard]] unsigned int GetHandle() const;
+	bool GetBinary(unsigned int& format, std::vector<unsigned char>& binary) const;
+
+	feUniformSlot GetUniformSlot(feUniformName name) const;
+	feUniformSlot GetUniformSlot(std::string_view name) const;
+	int GetUniformLocation(feUniformSlot slot) const;
+
+	// The program must be bound, uploads are skipped when the value matches the last one sent
+	void Uniform1f(feUniformSlot slot, float v0);
+	void Uniform2f(feUniformSlot slot, const glm::vec2& v0);
+	void Uniform3f(feUniformSlot slot, const glm::vec3& v0);
+	void Uniform4f(feUniformSlot slot, const glm::vec4& v0);
+	void Uniform1i(feUniformSlot slot, int v0);
+	void Uniform2i(feUniformSlot slot, const glm::ivec2& v0);
+	void Uniform3i(feUniformSlot slot, const glm::ivec3& v0);
+	void Uniform4i(feUniformSlot slot, const glm::ivec4& v0);
+	void UniformMat2f(feUniformSlot slot, const glm::mat2& v0);
+	void UniformMat3f(feUniformSlot slot, const glm::mat3& v0);
+	void UniformMat4f(feUniformSlot slot, const glm::mat4& v0);
 
-	int GetUniformLocation(std::string_view name) const;
-	void Uniform1f(std::string_view name, float v0) const;
-	void Uniform2f(std::string_view name, const glm::vec2& v0) const;
-	void Uniform3f(std::string_view name, const glm::vec3& v0) const;
-	void Uniform4f(std::string_view name, const glm::vec4& v0) const;
-	void Uniform1i(std::string_view name, int v0) const;
-	void Uniform2i(std::string_view name, const glm::ivec2& v0) const;
-	void Uniform3i(std::string_view name, const glm::ivec3& v0) const;
-	void Uniform4i(std::string_view name, const glm::ivec4& v0) const;
-	void UniformMat2f(std::string_view name, const glm::mat2& v0) const;
-	void UniformMat3f(std::string_view name, const glm::mat3& v0) const;
-	void UniformMat4f(std::string_view name, const glm::mat4& v0) const;
+	const feUniformUploadStats& GetUploadStats() const;
+	void ResetUploadStats();
 private:
+	// Returns false if two uniform names share a hash
+	bool LoadUniforms();
+	bool ShouldUpload(feUniformSlot slot, const void* data, size_t size);
+private:
+	struct feProgramUniform final
+	{
+		uint32_t hash;
+		int location;
+		// Location of the shadowed value in m_UniformShadow, only the first array element is shadowed
+		size_t offset;
+		size_t size;
+		bool shadowed;
+	};
+
 	unsigned int m_Handle = 0;
-	std::unordered_map<std::string, int> m_Uniforms;
+	bool m_Linked = false;
+	// Sorted by hash, a slot is the index into this table
+	std::vector<feProgramUniform> m_Uniforms;
+	std::vector<unsigned char> m_UniformShadow;
+	feUniformUploadStats m_UploadStats;
 };
\ No newline at end of file
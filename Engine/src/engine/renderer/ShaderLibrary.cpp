@@ -0,0 +1,126 @@
+#include "ShaderLibrary.h"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include "../Log.h"
+#include "../util/Hash.h"
+#include "ProgramCache.h"
+
+static uint64_t HashValue(uint64_t hash, const void* data, size_t size)
+{
+	return feHash::Fnv1a64(std::string_view(static_cast<const char*>(data), size), hash);
+}
+
+static uint64_t HashString(uint64_t hash, std::string_view string)
+{
+	// Include the terminator so "ab" + "c" and "a" + "bc" differ
+	return feHash::Fnv1a64(std::string_view("\0", 1), feHash::Fnv1a64(string, hash));
+}
+
+feShaderLibrary::feShaderLibrary(const feShaderLibraryCreateInfo& info)
+	: m_Cache(info.cache)
+{
+}
+
+std::shared_ptr<feProgram> feShaderLibrary::GetProgram(const feShaderVariantInfo& info)
+{
+	std::vector<feShaderDefine> defines = std::vector<feShaderDefine>(info.defines, info.defines + info.defineCount);
+	std::sort(defines.begin(), defines.end(), [](const feShaderDefine& a, const feShaderDefine& b)
+	{
+		return a.name < b.name;
+	});
+
+	uint64_t variantKey = feHash::Fnv1a64("");
+
+	for (size_t i = 0; i < info.fileCount; ++i)
+	{
+		variantKey = HashValue(variantKey, &info.files[i].type, sizeof(info.files[i].type));
+		variantKey = HashString(variantKey, info.files[i].filename);
+	}
+
+	for (const feShaderDefine& define : defines)
+	{
+		variantKey = HashString(variantKey, define.name);
+		variantKey = HashString(variantKey, define.value);
+	}
+
+	auto variant = m_Variants.find(variantKey);
+
+	if (variant != m_Variants.end())
+	{
+		++m_Stats.variantHits;
+		return variant->second;
+	}
+
+	std::vector<std::string> expanded;
+	expanded.reserve(info.fileCount);
+
+	uint64_t sourceKey = feHash::Fnv1a64("");
+
+	for (size_t i = 0; i < info.fileCount; ++i)
+	{
+		std::optional<std::string> source = m_Preprocessor.Process(info.files[i].filename, defines.data(), defines.size());
+		if (!source) return nullptr;
+
+		sourceKey = HashValue(sourceKey, &info.files[i].type, sizeof(info.files[i].type));
+		sourceKey = HashString(sourceKey, *source);
+		expanded.push_back(std::move(*source));
+	}
+
+	// Defines that no file reads still produce distinct keys, but identical sources only need one program
+	auto shared = m_Sources.find(sourceKey);
+
+	if (shared != m_Sources.end())
+	{
+		++m_Stats.sourceHits;
+		m_Variants.emplace(variantKey, shared->second);
+		return shared->second;
+	}
+
+	std::vector<std::string_view> sources = std::vector<std::string_view>(expanded.begin(), expanded.end());
+	std::vector<feShaderCreateInfo> shaderInfos = std::vector<feShaderCreateInfo>(info.fileCount);
+
+	for (size_t i = 0; i < info.fileCount; ++i)
+	{
+		shaderInfos[i].type = info.files[i].type;
+		shaderInfos[i].sources = &sources[i];
+		shaderInfos[i].sourceCount = 1;
+	}
+
+	std::shared_ptr<feProgram> program;
+
+	if (m_Cache)
+	{
+		program = std::make_shared<feProgram>(m_Cache->Create(shaderInfos.data(), shaderInfos.size(), info.debugName));
+	}
+	else
+	{
+		std::vector<feShader> shaders;
+		shaders.reserve(shaderInfos.size());
+		for (const feShaderCreateInfo& shaderInfo : shaderInfos) shaders.emplace_back(shaderInfo);
+
+		feProgramCreateInfo programInfo;
+		programInfo.shaders = shaders.data();
+		programInfo.shaderCount = shaders.size();
+		programInfo.debugName = info.debugName;
+
+		program = std::make_shared<feProgram>(programInfo);
+	}
+
+	++m_Stats.compiled;
+	m_Sources.emplace(sourceKey, program);
+	m_Variants.emplace(variantKey, program);
+	return program;
+}
+
+feShaderPreprocessor& feShaderLibrary::GetPreprocessor()
+{
+	return m_Preprocessor;
+}
+
+const feShaderLibraryStats& feShaderLibrary::GetStats() const
+{
+	return m_Stats;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+
+class feProgramCache;
+
+struct feShaderStageFile final
+{
+	unsigned int type = 0;
+	std::string_view filename;
+};
+
+struct feShaderVariantInfo final
+{
+	const feShaderStageFile* files = nullptr;
+	size_t fileCount = 0;
+	const feShaderDefine* defines = nullptr;
+	size_t defineCount = 0;
+
+	const char* debugName = nullptr;
+};
+
+struct feShaderLibraryCreateInfo final
+{
+	// Optional, variants are loaded from and stored into it
+	feProgramCache* cache = nullptr;
+};
+
+struct feShaderLibraryStats final
+{
+	// Requests answered by an already built variant with the same files and defines
+	uint64_t variantHits = 0;
+	// Requests with a different key whose expanded sources matched an already built program
+	uint64_t sourceHits = 0;
+	uint64_t compiled = 0;
+};
+
+// Builds each (file set, define set) permutation once per process and shares it between every user
+class feShaderLibrary final
+{
+public:
+	feShaderLibrary() = default;
+	feShaderLibrary(const feShaderLibraryCreateInfo& info);
+
+	feShaderLibrary(const feShaderLibrary&) = delete;
+	feShaderLibrary& operator=(const feShaderLibrary&) = delete;
+
+	feShaderLibrary(feShaderLibrary&& other) noexcept = default;
+	feShaderLibrary& operator=(feShaderLibrary&& other) noexcept = default;
+
+	// Returns nullptr if a file could not be loaded, define order does not matter
+	std::shared_ptr<feProgram> GetProgram(const feShaderVariantInfo& info);
+
+	feShaderPreprocessor& GetPreprocessor();
+	const feShaderLibraryStats& GetStats() const;
+private:
+	feShaderPreprocessor m_Preprocessor;
+	feProgramCache* m_Cache = nullptr;
+	std::unordered_map<uint64_t, std::shared_ptr<feProgram>> m_Variants;
+	std::unordered_map<uint64_t, std::shared_ptr<feProgram>> m_Sources;
+	feShaderLibraryStats m_Stats;
+};
\ No newline at end of file
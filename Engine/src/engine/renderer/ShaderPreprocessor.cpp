@@ -0,0 +1,148 @@
+#include "ShaderPreprocessor.h"
+
+#include "../Log.h"
+#include "../ResourceLoader.h"
+
+static std::string_view TrimLeft(std::string_view string)
+{
+	size_t start = string.find_first_not_of(" \t");
+	if (start == std::string_view::npos) return {};
+	return string.substr(start);
+}
+
+static bool HasVersionDirective(std::string_view source)
+{
+	while (!source.empty())
+	{
+		size_t end = source.find('\n');
+		if (TrimLeft(source.substr(0, end)).substr(0, 8) == "#version") return true;
+		source = end == std::string_view::npos ? std::string_view() : source.substr(end + 1);
+	}
+
+	return false;
+}
+
+static std::string GetDirectory(const std::string& filename)
+{
+	size_t slash = filename.find_last_of("/\\");
+	if (slash == std::string::npos) return {};
+	return filename.substr(0, slash + 1);
+}
+
+std::optional<std::string> feShaderPreprocessor::Process(std::string_view filename, const feShaderDefine* defines, size_t defineCount)
+{
+	std::string injected;
+
+	for (size_t i = 0; i < defineCount; ++i)
+	{
+		injected += "#define ";
+		injected += defines[i].name;
+
+		if (!defines[i].value.empty())
+		{
+			injected += ' ';
+			injected += defines[i].value;
+		}
+
+		injected += '\n';
+	}
+
+	std::string output;
+	std::vector<std::string> files;
+	std::unordered_set<std::string> included;
+
+	if (!Expand(std::string(filename), output, files, included, injected)) return {};
+
+	// GLSL #line only accepts source string numbers, so log which number belongs to which file
+	for (size_t i = 0; i < files.size(); ++i) feLog::Trace("Shader source {} is {}", i, files[i]);
+
+	return output;
+}
+
+void feShaderPreprocessor::ClearFileCache()
+{
+	m_Files.clear();
+}
+
+const std::string* feShaderPreprocessor::LoadFile(const std::string& filename)
+{
+	auto result = m_Files.find(filename);
+	if (result != m_Files.end()) return &result->second;
+
+	std::optional<std::string> contents = feResourceLoader::LoadTextFile(filename);
+	if (!contents) return nullptr;
+
+	return &m_Files.emplace(filename, std::move(*contents)).first->second;
+}
+
+bool feShaderPreprocessor::Expand(const std::string& filename, std::string& output, std::vector<std::string>& files, std::unordered_set<std::string>& included, const std::string& injected)
+{
+	if (!included.insert(filename).second) return true;
+
+	const std::string* contents = LoadFile(filename);
+
+	if (!contents)
+	{
+		feLog::Error("Failed to load shader file {}", filename);
+		return false;
+	}
+
+	size_t fileIndex = files.size();
+	files.push_back(filename);
+
+	std::string directory = GetDirectory(filename);
+	std::string_view source = *contents;
+	size_t lineNumber = 0;
+
+	// Only the root file is expected to contain #version, includes start their own numbering
+	if (fileIndex > 0) output += fmt::format("#line 1 {}\n", fileIndex);
+
+	// Defines go after #version, which has to come first. Without one they go at the top instead of being dropped.
+	bool injectAtVersion = fileIndex == 0 && !injected.empty() && HasVersionDirective(source);
+	if (fileIndex == 0 && !injected.empty() && !injectAtVersion)
+	{
+		feLog::Warn("Shader {} has no #version, its defines are added at the top", filename);
+		output += injected;
+		output += "#line 1 0\n";
+	}
+
+	while (!source.empty())
+	{
+		size_t end = source.find('\n');
+		std::string_view line = source.substr(0, end);
+		source = end == std::string_view::npos ? std::string_view() : source.substr(end + 1);
+		++lineNumber;
+
+		std::string_view directive = TrimLeft(line);
+
+		if (directive.substr(0, 8) == "#include")
+		{
+			size_t open = directive.find('"');
+			size_t close = open == std::string_view::npos ? open : directive.find('"', open + 1);
+
+			if (close == std::string_view::npos)
+			{
+				feLog::Error("Malformed #include in {} on line {}", filename, lineNumber);
+				return false;
+			}
+
+			std::string includeName = directory + std::string(directive.substr(open + 1, close - open - 1));
+
+			if (!Expand(includeName, output, files, included, injected)) return false;
+
+			output += fmt::format("#line {} {}\n", lineNumber + 1, fileIndex);
+			continue;
+		}
+
+		output += line;
+		output += '\n';
+
+		if (injectAtVersion && directive.substr(0, 8) == "#version")
+		{
+			output += injected;
+			output += fmt::format("#line {} 0\n", lineNumber + 1);
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
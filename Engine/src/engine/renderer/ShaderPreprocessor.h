@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct feShaderDefine final
+{
+	std::string_view name;
+	std::string_view value;
+};
+
+// Resolves #include "file" directives and injects #define sets after the #version line
+class feShaderPreprocessor final
+{
+public:
+	// Each file is included at most once per expansion, paths are relative to the including file
+	std::optional<std::string> Process(std::string_view filename, const feShaderDefine* defines, size_t defineCount);
+
+	// Forget loaded files so edits on disk are picked up
+	void ClearFileCache();
+private:
+	const std::string* LoadFile(const std::string& filename);
+	bool Expand(const std::string& filename, std::string& output, std::vector<std::string>& files, std::unordered_set<std::string>& included, const std::string& injected);
+private:
+	std::unordered_map<std::string, std::string> m_Files;
+};
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "StreamBuffer.h"
+
+#include <utility>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "Util.h"
+#include "RenderState.h"
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+feStreamBuffer::feStreamBuffer(const feStreamBufferCreateInfo& info)
+{
+	m_Target = info.target;
+
+	GLint alignment = 1;
+	if (m_Target == GL_UNIFORM_BUFFER) glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	else if (m_Target == GL_SHADER_STORAGE_BUFFER && feRenderUtil::GetSupportedVersion() >= 43) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_MinAlignment = alignment > 0 ? alignment : 1;
+
+	// Keep every section start aligned for range binds
+	m_FrameSize = AlignUp(info.frameSize, m_MinAlignment > 256 ? m_MinAlignment : 256);
+
+	glGenBuffers(1, &m_Handle);
+	BindForEdit();
+
+	if (feRenderUtil::GetSupportedVersion() >= 44)
+	{
+		m_FrameCount = info.frameCount > 0 ? info.frameCount : 1;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_Target, m_FrameSize * m_FrameCount, nullptr, flags);
+		m_Mapped = static_cast<unsigned char*>(glMapBufferRange(m_Target, 0, m_FrameSize * m_FrameCount, flags));
+
+		if (!m_Mapped) feLog::Error("Failed to persistently map stream buffer");
+
+		m_Fences.resize(m_FrameCount, nullptr);
+	}
+	else
+	{
+		// Orphaning gives the driver a fresh allocation each frame, so one section is enough
+		m_FrameCount = 1;
+		glBufferData(m_Target, m_FrameSize, nullptr, GL_STREAM_DRAW);
+		m_Staging.resize(m_FrameSize);
+	}
+
+	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_BUFFER, m_Handle, -1, info.debugName);
+
+	feLog::Trace("Created StreamBuffer");
+}
+
+feStreamBuffer::~feStreamBuffer() noexcept
+{
+	for (void* fence : m_Fences) if (fence) glDeleteSync(static_cast<GLsync>(fence));
+
+	if (m_Handle)
+	{
+		// Deleting a mapped buffer unmaps it
+		feLog::Trace("Deleted StreamBuffer");
+		glDeleteBuffers(1, &m_Handle);
+		feRenderState::OnDeleteBuffer(m_Handle);
+	}
+}
+
+feStreamBuffer::feStreamBuffer(feStreamBuffer&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+feStreamBuffer& feStreamBuffer::operator=(feStreamBuffer&& other) noexcept
+{
+	std::swap(m_Handle, other.m_Handle);
+	std::swap(m_Target, other.m_Target);
+	std::swap(m_FrameSize, other.m_FrameSize);
+	std::swap(m_FrameCount, other.m_FrameCount);
+	std::swap(m_Frame, other.m_Frame);
+	std::swap(m_Head, other.m_Head);
+	std::swap(m_MinAlignment, other.m_MinAlignment);
+	std::swap(m_Mapped, other.m_Mapped);
+	std::swap(m_Staging, other.m_Staging);
+	std::swap(m_Fences, other.m_Fences);
+	std::swap(m_WaitCount, other.m_WaitCount);
+	return *this;
+}
+
+void feStreamBuffer::BeginFrame()
+{
+	m_Head = 0;
+
+	if (m_Fences.empty()) return;
+
+	m_Frame = (m_Frame + 1) % m_FrameCount;
+
+	GLsync fence = static_cast<GLsync>(m_Fences[m_Frame]);
+	if (!fence) return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		++m_WaitCount;
+
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(fence);
+	m_Fences[m_Frame] = nullptr;
+}
+
+feStreamAllocation feStreamBuffer::Allocate(size_t size, size_t alignment)
+{
+	// Mapping failed, there is nowhere to write to
+	if (!m_Mapped && m_Staging.empty()) return feStreamAllocation();
+
+	if (alignment < m_MinAlignment) alignment = m_MinAlignment;
+
+	size_t start = AlignUp(m_Head, alignment);
+
+	if (start + size > m_FrameSize)
+	{
+		feLog::Warn("Stream buffer is out of space for this frame");
+		return feStreamAllocation();
+	}
+
+	m_Head = start + size;
+
+	feStreamAllocation allocation;
+	allocation.size = size;
+
+	if (m_Mapped)
+	{
+		allocation.offset = m_Frame * m_FrameSize + start;
+		allocation.data = m_Mapped + allocation.offset;
+	}
+	else
+	{
+		allocation.offset = start;
+		allocation.data = m_Staging.data() + start;
+	}
+
+	return allocation;
+}
+
+void feStreamBuffer::Flush()
+{
+	// Coherent mappings are visible to the GPU without any further calls
+	if (m_Mapped || m_Head == 0) return;
+
+	BindForEdit();
+	glBufferData(m_Target, m_FrameSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(m_Target, 0, m_Head, m_Staging.data());
+}
+
+void feStreamBuffer::EndFrame()
+{
+	if (m_Fences.empty()) return;
+
+	if (m_Fences[m_Frame]) glDeleteSync(static_cast<GLsync>(m_Fences[m_Frame]));
+	m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void feStreamBuffer::Bind() const
+{
+	feRenderState::BindBuffer(m_Target, m_Handle);
+}
+
+void feStreamBuffer::BindRange(unsigned int index, const feStreamAllocation& allocation) const
+{
+	feRenderState::BindBufferRange(m_Target, index, m_Handle, allocation.offset, allocation.size);
+}
+
+unsigned int feStreamBuffer::GetHandle() const
+{
+	return m_Handle;
+}
+
+bool feStreamBuffer::IsPersistent() const
+{
+	return m_Mapped != nullptr;
+}
+
+uint64_t feStreamBuffer::GetWaitCount() const
+{
+	return m_WaitCount;
+}
+
+void feStreamBuffer::BindForEdit() const
+{
+	// Binding an element array buffer would attach it to whatever vertex array is bound
+	if (m_Target == GL_ELEMENT_ARRAY_BUFFER) feRenderState::BindVertexArray(0);
+
+	feRenderState::BindBuffer(m_Target, m_Handle);
+}
\ No newline at end of file
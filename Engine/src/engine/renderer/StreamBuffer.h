@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct feStreamBufferCreateInfo final
+{
+	unsigned int target = 0;
+	// Bytes available to a single frame
+	size_t frameSize = 0;
+	// Sections in flight, the CPU writes one while the GPU reads the others
+	size_t frameCount = 3;
+
+	const char* debugName = nullptr;
+};
+
+struct feStreamAllocation final
+{
+	void* data = nullptr;
+	// Offset from the start of the GL buffer
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+// Per-frame dynamic data such as instance transforms. With GL 4.4 the buffer is persistently mapped and split into
+// fenced sections, older contexts orphan the buffer and upload a CPU staging copy in Flush.
+class feStreamBuffer final
+{
+public:
+	feStreamBuffer() = default;
+	feStreamBuffer(const feStreamBufferCreateInfo& info);
+	~feStreamBuffer() noexcept;
+
+	feStreamBuffer(const feStreamBuffer&) = delete;
+	feStreamBuffer& operator=(const feStreamBuffer&) = delete;
+
+	feStreamBuffer(feStreamBuffer&& other) noexcept;
+	feStreamBuffer& operator=(feStreamBuffer&& other) noexcept;
+
+	// Waits until the GPU no longer reads the section this frame writes to
+	void BeginFrame();
+	// Returns an allocation with null data when the frame is out of space
+	feStreamAllocation Allocate(size_t size, size_t alignment = 16);
+	// Makes this frame's writes visible to the GPU, call after allocating and before drawing
+	void Flush();
+	// Fences the section, call after the last draw reading from it
+	void EndFrame();
+
+	void Bind() const;
+	void BindRange(unsigned int index, const feStreamAllocation& allocation) const;
+	[[nodiscard]] unsigned int GetHandle() const;
+	[[nodiscard]] bool IsPersistent() const;
+	// Number of times BeginFrame had to block on the GPU
+	[[nodiscard]] uint64_t GetWaitCount() const;
+private:
+	void BindForEdit() const;
+private:
+	unsigned int m_Handle = 0;
+	unsigned int m_Target = 0;
+	size_t m_FrameSize = 0;
+	size_t m_FrameCount = 0;
+	size_t m_Frame = 0;
+	size_t m_Head = 0;
+	size_t m_MinAlignment = 1;
+	unsigned char* m_Mapped = nullptr;
+	std::vector<unsigned char> m_Staging;
+	// GLsync objects, one per section
+	std::vector<void*> m_Fences;
+	uint64_t m_WaitCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "UniformBuffer.h"
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+
+namespace feUniformBlocks
+{
+	int GetBinding(std::string_view name)
+	{
+		if (name == feUniformBlockCamera::name) return feUniformBlockCamera::binding;
+		if (name == feUniformBlockGlobal::name) return feUniformBlockGlobal::binding;
+		return -1;
+	}
+}
+
+feUniformBuffer::feUniformBuffer(const feUniformBufferCreateInfo& info)
+{
+	feBufferObjectCreateInfo bufferInfo;
+	bufferInfo.target = GL_UNIFORM_BUFFER;
+	bufferInfo.size = info.size;
+	bufferInfo.usage = GL_DYNAMIC_DRAW;
+	bufferInfo.debugName = info.debugName;
+
+	m_Buffer = bufferInfo;
+	m_Binding = info.binding;
+	m_Size = info.size;
+}
+
+void feUniformBuffer::SetData(const void* data, size_t size) const
+{
+	if (size > m_Size)
+	{
+		feLog::Warn("Attempting to write {} bytes into a {} byte uniform buffer", size, m_Size);
+		feLog::Break();
+		return;
+	}
+
+	m_Buffer.SetData(0, size, data);
+}
+
+void feUniformBuffer::Bind() const
+{
+	m_Buffer.BindBase(m_Binding);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "BufferObject.h"
+
+// Fixed binding points, feProgram binds blocks with a matching name to these while loading its uniforms
+enum feUniformBlockBinding : unsigned int
+{
+	FE_UNIFORM_BLOCK_CAMERA = 0,
+	FE_UNIFORM_BLOCK_GLOBAL = 1
+};
+
+// std140 layout, every member is already aligned so the C++ and GLSL layouts match
+struct feUniformBlockCamera final
+{
+	static constexpr std::string_view name = "fe_Camera";
+	static constexpr feUniformBlockBinding binding = FE_UNIFORM_BLOCK_CAMERA;
+
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::mat4 viewProj;
+	glm::vec4 position;
+};
+
+static_assert(offsetof(feUniformBlockCamera, proj) == 64, "feUniformBlockCamera does not match std140");
+static_assert(offsetof(feUniformBlockCamera, viewProj) == 128, "feUniformBlockCamera does not match std140");
+static_assert(offsetof(feUniformBlockCamera, position) == 192, "feUniformBlockCamera does not match std140");
+static_assert(sizeof(feUniformBlockCamera) == 208, "feUniformBlockCamera does not match std140");
+
+struct feUniformBlockGlobal final
+{
+	static constexpr std::string_view name = "fe_Global";
+	static constexpr feUniformBlockBinding binding = FE_UNIFORM_BLOCK_GLOBAL;
+
+	float time;
+	float deltaTime;
+	glm::vec2 viewportSize;
+};
+
+static_assert(offsetof(feUniformBlockGlobal, viewportSize) == 8, "feUniformBlockGlobal does not match std140");
+static_assert(sizeof(feUniformBlockGlobal) == 16, "feUniformBlockGlobal does not match std140");
+
+namespace feUniformBlocks
+{
+	// Returns the fixed binding point for a block name, or -1 if the block is not known
+	int GetBinding(std::string_view name);
+}
+
+struct feUniformBufferCreateInfo final
+{
+	unsigned int binding = 0;
+	size_t size = 0;
+
+	const char* debugName = nullptr;
+};
+
+class feUniformBuffer final
+{
+public:
+	template<typename t_Block>
+	static feUniformBufferCreateInfo CreateInfo(const char* debugName = nullptr)
+	{
+		feUniformBufferCreateInfo info;
+		info.binding = t_Block::binding;
+		info.size = sizeof(t_Block);
+		info.debugName = debugName;
+		return info;
+	}
+public:
+	feUniformBuffer() = default;
+	feUniformBuffer(const feUniformBufferCreateInfo& info);
+
+	feUniformBuffer(const feUniformBuffer&) = delete;
+	feUniformBuffer& operator=(const feUniformBuffer&) = delete;
+
+	feUniformBuffer(feUniformBuffer&& other) noexcept = default;
+	feUniformBuffer& operator=(feUniformBuffer&& other) noexcept = default;
+
+	template<typename t_Block>
+	void Update(const t_Block& block) const
+	{
+		static_assert(sizeof(t_Block) % 16 == 0, "std140 blocks must be padded to 16 bytes");
+		SetData(&block, sizeof(t_Block));
+	}
+
+	void SetData(const void* data, size_t size) const;
+
+	// Binds the buffer to its fixed binding point, programs using the block then read from it without any per-program uploads
+	void Bind() const;
+private:
+	feBufferObject m_Buffer;
+	unsigned int m_Binding = 0;
+	size_t m_Size = 0;
+};
\ No newline at end of file
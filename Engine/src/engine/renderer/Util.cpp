@@ -2,17 +2,21 @@
 
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 
 #include <glad/gl.h>
 
 #include "../Log.h"
+#include "../Window.h"
+#include "RenderState.h"
 
 #define FE_EXPAND_GL(x) { x, #x }
 
 static struct feRenderUtilLoadedFlags final
 {
 	std::optional<unsigned char> version;
+	std::optional<std::unordered_set<std::string>> extensions;
 } s_Flags;
 
 static std::string GetOpenGLString(unsigned int value)
@@ -64,6 +68,7 @@ namespace feRenderUtil
 	void ClearLoadedFlag()
 	{
 		s_Flags = feRenderUtilLoadedFlags();
+		feRenderState::Invalidate();
 	}
 
 	unsigned char GetSupportedVersion()
@@ -79,9 +84,32 @@ namespace feRenderUtil
 		return version;
 	}
 
+	bool IsExtensionSupported(std::string_view name)
+	{
+		if (!s_Flags.extensions)
+		{
+			std::unordered_set<std::string> extensions;
+
+			GLint numExt;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+
+			for (int i = 0; i < numExt; ++i)
+				extensions.emplace(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+
+			s_Flags.extensions = std::move(extensions);
+		}
+
+		return s_Flags.extensions->find(std::string(name)) != s_Flags.extensions->end();
+	}
+
+	feProc GetProcAddress(const char* name)
+	{
+		return feWindow::ProcAddress()(name);
+	}
+
 	void Viewport(int x, int y, int w, int h)
 	{
-		glViewport(x, y, w, h);
+		feRenderState::SetViewport(x, y, w, h);
 	}
 
 	void Clear()
@@ -93,13 +121,15 @@ namespace feRenderUtil
 	{
 		glClearColor(r, g, b, a);
 		glClearDepth(1);
-		glDepthFunc(GL_LEQUAL);
-		glEnable(GL_CULL_FACE);
-		glEnable(GL_DEPTH_TEST);
+		feRenderState::SetDepthFunc(GL_LEQUAL);
+		feRenderState::SetCullFace(true);
+		feRenderState::SetDepthTest(true);
+		feRenderState::SetDepthWrite(true);
+		feRenderState::SetBlend(false);
 		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 		glEnable(GL_FRAMEBUFFER_SRGB);
 		glFrontFace(GL_CCW);
-		glCullFace(GL_BACK);
+		feRenderState::SetCullMode(GL_BACK);
 	}
 
 	void LogOpenGLInfo()
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <string_view>
+
+typedef void (*feProc)(void);
+
 namespace feRenderUtil
 {
 	void ClearLoadedFlag();
 	unsigned char GetSupportedVersion();
+	bool IsExtensionSupported(std::string_view name);
+	// For extension functions that are not part of the loaded core profile
+	feProc GetProcAddress(const char* name);
 
 	void Viewport(int x, int y, int w, int h);
 	void Clear();
@@ -6,44 +6,57 @@
 
 #include "../Log.h"
 #include "Util.h"
+#include "RenderState.h"
 
-feVertexArray::feVertexArray(unsigned int handle)
-	: m_Handle(handle)
-{
-}
-
-feVertexArray::feVertexArray(const feVertexArrayCreateInfo& info)
+// Size of one column of an attribute
+static unsigned int GetColumnSize(unsigned int size, unsigned int type)
 {
-	glGenVertexArrays(1, &m_Handle);
-	glBindVertexArray(m_Handle);
-
-	for (size_t i = 0; i < info.attributeInfoCount; ++i)
+	switch (type)
 	{
-		feVertexArrayCreateInfoAttributeInfo* attributeInfo = info.attributeInfos + i;
-		feVertexArrayCreateInfoBufferObjectInfo* bufferInfo = info.vertexBufferInfos + attributeInfo->buffer;
+	case GL_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+		// Every component is packed into one 32 bit value
+		return 4;
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return size;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		return size * 2;
+	case GL_DOUBLE:
+		return size * 8;
+	default:
+		return size * 4;
+	}
+}
 
-		if (attributeInfo->buffer >= info.vertexBufferInfoCount)
-		{
-			feLog::Warn("Attempting to access out of bound buffer");
-			feLog::Break();
+// Set once the missing base instance has been reported, every draw would repeat it otherwise
+static bool s_BaseInstanceWarned = false;
 
-			// Do not attempt to read from this location
-			continue;
-		}
+static bool IsBaseInstanceSupported(unsigned int baseInstance)
+{
+	if (baseInstance == 0 || feRenderUtil::GetSupportedVersion() >= 42) return true;
 
-		bufferInfo->buffer->Bind();
-		glEnableVertexAttribArray(static_cast<GLuint>(i));
-		glVertexAttribPointer(static_cast<GLuint>(i), attributeInfo->size, attributeInfo->type, GL_FALSE, bufferInfo->stride, (const void*) (intptr_t) attributeInfo->offset);
-	}
+	if (!s_BaseInstanceWarned) feLog::Warn("Base instance is not supported, drawing from instance 0");
+	s_BaseInstanceWarned = true;
+	return false;
+}
 
-	if (info.indexBuffer) info.indexBuffer->Bind();
+feVertexArray::feVertexArray(unsigned int handle)
+	: m_Handle(handle)
+{
+}
 
-	glBindVertexArray(0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+feVertexArray::feVertexArray(const feVertexArrayCreateInfo& info)
+{
+	if (feBufferObject::IsDirectStateAccessSupported()) CreateDirect(info);
+	else CreateBound(info);
 
 	m_Count = info.count;
 	m_Mode = info.mode;
+	m_IndexType = info.indexType ? info.indexType : GL_UNSIGNED_INT;
 	m_HasIndexBuffer = info.indexBuffer != nullptr;
 
 	if (info.debugName && feRenderUtil::GetSupportedVersion() >= 43) glObjectLabel(GL_VERTEX_ARRAY, m_Handle, -1, info.debugName);
@@ -57,6 +70,7 @@ feVertexArray::~feVertexArray() noexcept
 	{
 		feLog::Trace("Deleted VertexArray");
 		glDeleteVertexArrays(1, &m_Handle);
+		feRenderState::OnDeleteVertexArray(m_Handle);
 	}
 }
 
@@ -65,6 +79,7 @@ feVertexArray::feVertexArray(feVertexArray&& other) noexcept
 	std::swap(m_Handle, other.m_Handle);
 	std::swap(m_Mode, other.m_Mode);
 	std::swap(m_Count, other.m_Count);
+	std::swap(m_IndexType, other.m_IndexType);
 	std::swap(m_HasIndexBuffer, other.m_HasIndexBuffer);
 }
 
@@ -73,17 +88,175 @@ feVertexArray& feVertexArray::operator=(feVertexArray&& other) noexcept
 	std::swap(m_Handle, other.m_Handle);
 	std::swap(m_Mode, other.m_Mode);
 	std::swap(m_Count, other.m_Count);
+	std::swap(m_IndexType, other.m_IndexType);
 	std::swap(m_HasIndexBuffer, other.m_HasIndexBuffer);
 	return *this;
 }
 
+void feVertexArray::CreateDirect(const feVertexArrayCreateInfo& info)
+{
+	glCreateVertexArrays(1, &m_Handle);
+
+	// Each buffer gets its own binding point, attributes reference them by index
+	for (size_t i = 0; i < info.vertexBufferInfoCount; ++i)
+	{
+		const feVertexArrayCreateInfoBufferObjectInfo* bufferInfo = info.vertexBufferInfos + i;
+		glVertexArrayVertexBuffer(m_Handle, static_cast<GLuint>(i), bufferInfo->GetHandle(), 0, bufferInfo->stride);
+	}
+
+	GLuint location = 0;
+
+	for (size_t i = 0; i < info.attributeInfoCount; ++i)
+	{
+		const feVertexArrayCreateInfoAttributeInfo* attributeInfo = info.attributeInfos + i;
+
+		if (attributeInfo->buffer >= info.vertexBufferInfoCount)
+		{
+			feLog::Warn("Attempting to access out of bound buffer");
+			feLog::Break();
+
+			// Do not attempt to read from this location
+			location += attributeInfo->columns;
+			continue;
+		}
+
+		unsigned int columnSize = GetColumnSize(attributeInfo->size, attributeInfo->type);
+
+		for (unsigned int column = 0; column < attributeInfo->columns; ++column, ++location)
+		{
+			unsigned int offset = attributeInfo->offset + column * columnSize;
+
+			glEnableVertexArrayAttrib(m_Handle, location);
+			if (attributeInfo->integer) glVertexArrayAttribIFormat(m_Handle, location, attributeInfo->size, attributeInfo->type, offset);
+			else glVertexArrayAttribFormat(m_Handle, location, attributeInfo->size, attributeInfo->type, attributeInfo->normalized ? GL_TRUE : GL_FALSE, offset);
+			glVertexArrayAttribBinding(m_Handle, location, static_cast<GLuint>(attributeInfo->buffer));
+		}
+
+		// Divisors belong to the buffer binding here rather than the attribute
+		glVertexArrayBindingDivisor(m_Handle, static_cast<GLuint>(attributeInfo->buffer), attributeInfo->divisor);
+	}
+
+	if (info.indexBuffer) glVertexArrayElementBuffer(m_Handle, info.indexBuffer->GetHandle());
+}
+
+void feVertexArray::CreateBound(const feVertexArrayCreateInfo& info)
+{
+	glGenVertexArrays(1, &m_Handle);
+	feRenderState::BindVertexArray(m_Handle);
+
+	GLuint location = 0;
+
+	for (size_t i = 0; i < info.attributeInfoCount; ++i)
+	{
+		const feVertexArrayCreateInfoAttributeInfo* attributeInfo = info.attributeInfos + i;
+		feVertexArrayCreateInfoBufferObjectInfo* bufferInfo = info.vertexBufferInfos + attributeInfo->buffer;
+
+		if (attributeInfo->buffer >= info.vertexBufferInfoCount)
+		{
+			feLog::Warn("Attempting to access out of bound buffer");
+			feLog::Break();
+
+			// Do not attempt to read from this location
+			location += attributeInfo->columns;
+			continue;
+		}
+
+		feRenderState::BindBuffer(GL_ARRAY_BUFFER, bufferInfo->GetHandle());
+
+		unsigned int columnSize = GetColumnSize(attributeInfo->size, attributeInfo->type);
+
+		for (unsigned int column = 0; column < attributeInfo->columns; ++column, ++location)
+		{
+			const void* offset = (const void*) (intptr_t) (attributeInfo->offset + column * columnSize);
+
+			glEnableVertexAttribArray(location);
+			if (attributeInfo->integer) glVertexAttribIPointer(location, attributeInfo->size, attributeInfo->type, bufferInfo->stride, offset);
+			else glVertexAttribPointer(location, attributeInfo->size, attributeInfo->type, attributeInfo->normalized ? GL_TRUE : GL_FALSE, bufferInfo->stride, offset);
+			glVertexAttribDivisor(location, attributeInfo->divisor);
+		}
+	}
+
+	if (info.indexBuffer) info.indexBuffer->Bind();
+
+	// Unbind so later element array binds cannot modify this vertex array
+	feRenderState::BindVertexArray(0);
+}
+
 void feVertexArray::Bind() const
 {
-	glBindVertexArray(m_Handle);
+	feRenderState::BindVertexArray(m_Handle);
+}
+
+unsigned int feVertexArray::GetMode() const
+{
+	return m_Mode;
+}
+
+unsigned int feVertexArray::GetIndexType() const
+{
+	return m_IndexType;
+}
+
+unsigned int feVertexArray::PickIndexType(size_t vertexCount)
+{
+	return vertexCount < 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+unsigned int feVertexArray::GetIndexSize(unsigned int indexType)
+{
+	switch (indexType)
+	{
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	default:
+		return 4;
+	}
 }
 
 void feVertexArray::Draw() const
 {
-	if (m_HasIndexBuffer) glDrawElements(m_Mode, m_Count, GL_UNSIGNED_INT, nullptr);
+	if (m_HasIndexBuffer) glDrawElements(m_Mode, m_Count, m_IndexType, nullptr);
 	else glDrawArrays(m_Mode, 0, m_Count);
+}
+
+void feVertexArray::DrawRange(unsigned int count, unsigned int first) const
+{
+	if (m_HasIndexBuffer) glDrawElements(m_Mode, count, m_IndexType, (const void*) (intptr_t) (first * GetIndexSize(m_IndexType)));
+	else glDrawArrays(m_Mode, first, count);
+}
+
+void feVertexArray::DrawBaseVertex(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int indexType) const
+{
+	if (!indexType) indexType = m_IndexType;
+
+	glDrawElementsBaseVertex(m_Mode, count, indexType, (const void*) (intptr_t) (firstIndex * GetIndexSize(indexType)), baseVertex);
+}
+
+void feVertexArray::DrawInstanced(unsigned int instanceCount, unsigned int baseInstance) const
+{
+	if (!IsBaseInstanceSupported(baseInstance)) baseInstance = 0;
+
+	if (baseInstance == 0)
+	{
+		if (m_HasIndexBuffer) glDrawElementsInstanced(m_Mode, m_Count, m_IndexType, nullptr, instanceCount);
+		else glDrawArraysInstanced(m_Mode, 0, m_Count, instanceCount);
+		return;
+	}
+
+	if (m_HasIndexBuffer) glDrawElementsInstancedBaseInstance(m_Mode, m_Count, m_IndexType, nullptr, instanceCount, baseInstance);
+	else glDrawArraysInstancedBaseInstance(m_Mode, 0, m_Count, instanceCount, baseInstance);
+}
+
+void feVertexArray::DrawInstancedBaseVertex(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int instanceCount, unsigned int baseInstance, unsigned int indexType) const
+{
+	if (!indexType) indexType = m_IndexType;
+
+	const void* indices = (const void*) (intptr_t) (firstIndex * GetIndexSize(indexType));
+
+	if (!IsBaseInstanceSupported(baseInstance)) baseInstance = 0;
+
+	if (baseInstance == 0) glDrawElementsInstancedBaseVertex(m_Mode, count, indexType, indices, instanceCount, baseVertex);
+	else glDrawElementsInstancedBaseVertexBaseInstance(m_Mode, count, indexType, indices, instanceCount, baseVertex, baseInstance);
 }
\ No newline at end of file
@@ -5,24 +5,39 @@
 struct feVertexArrayCreateInfoBufferObjectInfo final
 {
 	feBufferObject* buffer = nullptr;
+	// Read instead when buffer is null, for buffers owned elsewhere such as a feStreamBuffer
+	unsigned int handle = 0;
 	unsigned int stride = 0;
+
+	[[nodiscard]] unsigned int GetHandle() const { return buffer ? buffer->GetHandle() : handle; }
 };
 
+// Attributes take consecutive locations in order, an attribute with several columns takes one location per column
 struct feVertexArrayCreateInfoAttributeInfo final
 {
 	size_t buffer = 0;
 	unsigned int size = 0;
 	unsigned int type = 0;
 	unsigned int offset = 0;
+	// 0 advances per vertex, N advances once every N instances. Attributes sharing a buffer must use the same divisor
+	unsigned int divisor = 0;
+	// 4 for a mat4 stored as four consecutive vec4 columns
+	unsigned int columns = 1;
+	// Fixed point values are mapped to [0, 1] or [-1, 1], required for GL_INT_2_10_10_10_REV normals
+	bool normalized = false;
+	// Read as ivec or uvec in the shader instead of being converted to float
+	bool integer = false;
 };
 
 struct feVertexArrayCreateInfo final
 {
 	feVertexArrayCreateInfoBufferObjectInfo* vertexBufferInfos = nullptr;
 	size_t vertexBufferInfoCount = 0;
-	feVertexArrayCreateInfoAttributeInfo* attributeInfos = nullptr;
+	const feVertexArrayCreateInfoAttributeInfo* attributeInfos = nullptr;
 	size_t attributeInfoCount = 0;
 	feBufferObject* indexBuffer = nullptr;
+	// Defaults to GL_UNSIGNED_INT
+	unsigned int indexType = 0;
 	unsigned int count = 0;
 	unsigned int mode = 0;
 
@@ -43,9 +58,28 @@ public:
 
 	void Bind() const;
 	void Draw() const;
+	// Draws a sub range, first is an index into the index buffer if there is one, otherwise a vertex
+	void DrawRange(unsigned int count, unsigned int first) const;
+	// Index values are offset by baseVertex, lets many meshes share one vertex and index buffer.
+	// An indexType of 0 uses the vertex array's own, firstIndex counts indices of that type.
+	void DrawBaseVertex(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int indexType = 0) const;
+	// Instanced attributes start reading at baseInstance, which needs GL 4.2 when non zero
+	void DrawInstanced(unsigned int instanceCount, unsigned int baseInstance = 0) const;
+	void DrawInstancedBaseVertex(unsigned int count, unsigned int firstIndex, int baseVertex, unsigned int instanceCount, unsigned int baseInstance = 0, unsigned int indexType = 0) const;
+
+	[[nodiscard]] unsigned int GetMode() const;
+	[[nodiscard]] unsigned int GetIndexType() const;
+
+	// GL_UNSIGNED_SHORT below 65536 vertices, otherwise GL_UNSIGNED_INT
+	[[nodiscard]] static unsigned int PickIndexType(size_t vertexCount);
+	[[nodiscard]] static unsigned int GetIndexSize(unsigned int indexType);
+private:
+	void CreateDirect(const feVertexArrayCreateInfo& info);
+	void CreateBound(const feVertexArrayCreateInfo& info);
 private:
 	unsigned int m_Handle = 0;
 	unsigned int m_Mode = 0;
 	unsigned int m_Count = 0;
+	unsigned int m_IndexType = 0;
 	bool m_HasIndexBuffer = false;
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "VertexLayout.h"
+
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "../Log.h"
+#include "Shader.h"
+
+static_assert(feVertexLayoutType::UnsignedByte == GL_UNSIGNED_BYTE, "feVertexLayoutType does not match GL");
+static_assert(feVertexLayoutType::Int == GL_INT, "feVertexLayoutType does not match GL");
+static_assert(feVertexLayoutType::UnsignedInt == GL_UNSIGNED_INT, "feVertexLayoutType does not match GL");
+static_assert(feVertexLayoutType::Float == GL_FLOAT, "feVertexLayoutType does not match GL");
+static_assert(feVertexLayoutType::HalfFloat == GL_HALF_FLOAT, "feVertexLayoutType does not match GL");
+static_assert(feVertexLayoutType::Int2101010Rev == GL_INT_2_10_10_10_REV, "feVertexLayoutType does not match GL");
+
+static bool IsIntegerType(GLenum type)
+{
+	switch (type)
+	{
+	case GL_INT:
+	case GL_INT_VEC2:
+	case GL_INT_VEC3:
+	case GL_INT_VEC4:
+	case GL_UNSIGNED_INT:
+	case GL_UNSIGNED_INT_VEC2:
+	case GL_UNSIGNED_INT_VEC3:
+	case GL_UNSIGNED_INT_VEC4:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Locations taken by one element of an attribute
+static unsigned int GetLocationCount(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT_MAT2:
+	case GL_FLOAT_MAT2x3:
+	case GL_FLOAT_MAT2x4:
+		return 2;
+	case GL_FLOAT_MAT3:
+	case GL_FLOAT_MAT3x2:
+	case GL_FLOAT_MAT3x4:
+		return 3;
+	case GL_FLOAT_MAT4:
+	case GL_FLOAT_MAT4x2:
+	case GL_FLOAT_MAT4x3:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+namespace feVertexLayoutUtil
+{
+	bool Validate(const feProgram& program, const feVertexArrayCreateInfoAttributeInfo* attributeInfos, size_t count, const char* debugName)
+	{
+		if (!program.IsLinked()) return true;
+
+		if (!debugName) debugName = "Vertex layout";
+
+		// Same assignment as feVertexArray, one location per column
+		std::vector<const feVertexArrayCreateInfoAttributeInfo*> locations;
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (unsigned int column = 0; column < attributeInfos[i].columns; ++column) locations.push_back(attributeInfos + i);
+		}
+
+		GLuint handle = program.GetHandle();
+
+		GLint activeCount = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTES, &activeCount);
+		glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+		std::string name = std::string(maxLength > 0 ? maxLength : 1, '\0');
+		bool valid = true;
+
+		for (GLint i = 0; i < activeCount; ++i)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveAttrib(handle, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+			std::string_view attributeName = std::string_view(name.data(), length);
+
+			// Built in inputs such as gl_VertexID have no location
+			if (attributeName.substr(0, 3) == "gl_") continue;
+
+			GLint location = glGetAttribLocation(handle, name.c_str());
+			if (location < 0) continue;
+
+			unsigned int locationCount = GetLocationCount(type) * static_cast<unsigned int>(size);
+
+			for (unsigned int j = 0; j < locationCount; ++j)
+			{
+				size_t index = static_cast<size_t>(location) + j;
+
+				if (index >= locations.size())
+				{
+					feLog::Warn("{}: shader input {} at location {} is not provided", debugName, attributeName, index);
+					valid = false;
+					break;
+				}
+
+				if (locations[index]->integer != IsIntegerType(type))
+				{
+					feLog::Warn("{}: shader input {} at location {} is {} but the layout provides {}", debugName, attributeName, index, IsIntegerType(type) ? "integer" : "float", locations[index]->integer ? "integers" : "floats");
+					valid = false;
+					break;
+				}
+			}
+		}
+
+		return valid;
+	}
+}
\ No newline at end of file
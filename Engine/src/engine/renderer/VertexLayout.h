@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "VertexArray.h"
+#include "../util/Hash.h"
+
+class feProgram;
+
+// Storage types for packed attributes, use them as the member type or through FE_VERTEX_ATTRIBUTE_AS
+struct feHalf2 final { uint16_t x, y; };
+struct feHalf3 final { uint16_t x, y, z; };
+struct feHalf4 final { uint16_t x, y, z, w; };
+// Normalized GL_INT_2_10_10_10_REV, see fePack::Snorm1010102
+struct feSnorm1010102 final { uint32_t bits; };
+// Normalized GL_UNSIGNED_BYTE x4, colors
+struct feUnorm8x4 final { uint8_t r, g, b, a; };
+
+// GL enum values, this header is included without the loader. VertexLayout.cpp checks them against glad.
+namespace feVertexLayoutType
+{
+	constexpr unsigned int UnsignedByte = 0x1401;
+	constexpr unsigned int Int = 0x1404;
+	constexpr unsigned int UnsignedInt = 0x1405;
+	constexpr unsigned int Float = 0x1406;
+	constexpr unsigned int HalfFloat = 0x140B;
+	constexpr unsigned int Int2101010Rev = 0x8D9F;
+}
+
+// How a C++ type is fed to the vertex shader
+template<typename T>
+struct feVertexAttributeTraits;
+
+template<unsigned int Size, unsigned int Type, bool Normalized = false, bool Integer = false, unsigned int Columns = 1>
+struct feVertexAttributeTraitsBase
+{
+	static constexpr unsigned int size = Size;
+	static constexpr unsigned int type = Type;
+	static constexpr bool normalized = Normalized;
+	static constexpr bool integer = Integer;
+	static constexpr unsigned int columns = Columns;
+};
+
+template<> struct feVertexAttributeTraits<float> : feVertexAttributeTraitsBase<1, feVertexLayoutType::Float> {};
+template<> struct feVertexAttributeTraits<glm::vec2> : feVertexAttributeTraitsBase<2, feVertexLayoutType::Float> {};
+template<> struct feVertexAttributeTraits<glm::vec3> : feVertexAttributeTraitsBase<3, feVertexLayoutType::Float> {};
+template<> struct feVertexAttributeTraits<glm::vec4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::Float> {};
+template<> struct feVertexAttributeTraits<glm::mat4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::Float, false, false, 4> {};
+template<> struct feVertexAttributeTraits<int> : feVertexAttributeTraitsBase<1, feVertexLayoutType::Int, false, true> {};
+template<> struct feVertexAttributeTraits<glm::ivec2> : feVertexAttributeTraitsBase<2, feVertexLayoutType::Int, false, true> {};
+template<> struct feVertexAttributeTraits<glm::ivec3> : feVertexAttributeTraitsBase<3, feVertexLayoutType::Int, false, true> {};
+template<> struct feVertexAttributeTraits<glm::ivec4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::Int, false, true> {};
+template<> struct feVertexAttributeTraits<unsigned int> : feVertexAttributeTraitsBase<1, feVertexLayoutType::UnsignedInt, false, true> {};
+template<> struct feVertexAttributeTraits<glm::uvec2> : feVertexAttributeTraitsBase<2, feVertexLayoutType::UnsignedInt, false, true> {};
+template<> struct feVertexAttributeTraits<glm::uvec3> : feVertexAttributeTraitsBase<3, feVertexLayoutType::UnsignedInt, false, true> {};
+template<> struct feVertexAttributeTraits<glm::uvec4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::UnsignedInt, false, true> {};
+template<> struct feVertexAttributeTraits<feHalf2> : feVertexAttributeTraitsBase<2, feVertexLayoutType::HalfFloat> {};
+template<> struct feVertexAttributeTraits<feHalf3> : feVertexAttributeTraitsBase<3, feVertexLayoutType::HalfFloat> {};
+template<> struct feVertexAttributeTraits<feHalf4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::HalfFloat> {};
+template<> struct feVertexAttributeTraits<feSnorm1010102> : feVertexAttributeTraitsBase<4, feVertexLayoutType::Int2101010Rev, true> {};
+template<> struct feVertexAttributeTraits<feUnorm8x4> : feVertexAttributeTraitsBase<4, feVertexLayoutType::UnsignedByte, true> {};
+
+struct feVertexAttributeDesc final
+{
+	std::string_view name;
+	feVertexArrayCreateInfoAttributeInfo info;
+};
+
+template<typename As, typename Member>
+constexpr feVertexAttributeDesc feMakeVertexAttribute(std::string_view name, size_t offset)
+{
+	static_assert(sizeof(As) <= sizeof(Member), "Vertex attribute reads past its member");
+
+	using Traits = feVertexAttributeTraits<As>;
+
+	feVertexAttributeDesc desc;
+	desc.name = name;
+	desc.info.size = Traits::size;
+	desc.info.type = Traits::type;
+	desc.info.offset = static_cast<unsigned int>(offset);
+	desc.info.columns = Traits::columns;
+	desc.info.normalized = Traits::normalized;
+	desc.info.integer = Traits::integer;
+	return desc;
+}
+
+namespace feVertexLayoutUtil
+{
+	// Covers everything that decides how vertices are fetched, names do not take part
+	constexpr uint64_t Hash(const feVertexArrayCreateInfoAttributeInfo* attributeInfos, size_t count, uint64_t hash = feHash::Fnv1a64Value(0))
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const feVertexArrayCreateInfoAttributeInfo& info = attributeInfos[i];
+			hash = feHash::Fnv1a64Value(info.buffer, hash);
+			hash = feHash::Fnv1a64Value(info.size, hash);
+			hash = feHash::Fnv1a64Value(info.type, hash);
+			hash = feHash::Fnv1a64Value(info.offset, hash);
+			hash = feHash::Fnv1a64Value(info.divisor, hash);
+			hash = feHash::Fnv1a64Value(info.columns, hash);
+			hash = feHash::Fnv1a64Value((info.normalized ? 1 : 0) | (info.integer ? 2 : 0), hash);
+		}
+
+		return hash;
+	}
+
+	// Logs every attribute the program reads that the layout does not provide, or provides as float where the shader
+	// expects integers and the other way around. Locations are assigned the way feVertexArray does.
+	bool Validate(const feProgram& program, const feVertexArrayCreateInfoAttributeInfo* attributeInfos, size_t count, const char* debugName = nullptr);
+}
+
+// Compile time description of a vertex struct, see FE_VERTEX_LAYOUT
+template<size_t Count>
+struct feVertexLayout final
+{
+	unsigned int stride = 0;
+	std::array<feVertexArrayCreateInfoAttributeInfo, Count> attributes = {};
+	std::array<std::string_view, Count> names = {};
+	uint64_t hash = 0;
+
+	static constexpr size_t count = Count;
+
+	constexpr bool IsValid() const
+	{
+		for (const feVertexArrayCreateInfoAttributeInfo& attribute : attributes)
+		{
+			if (attribute.offset >= stride) return false;
+		}
+
+		return true;
+	}
+
+	bool Validate(const feProgram& program, const char* debugName = nullptr) const
+	{
+		return feVertexLayoutUtil::Validate(program, attributes.data(), Count, debugName);
+	}
+};
+
+template<typename Vertex, typename... Attributes>
+constexpr feVertexLayout<sizeof...(Attributes)> feMakeVertexLayout(Attributes... descs)
+{
+	feVertexLayout<sizeof...(Attributes)> layout;
+	layout.stride = static_cast<unsigned int>(sizeof(Vertex));
+
+	feVertexAttributeDesc list[] = { descs... };
+	for (size_t i = 0; i < sizeof...(Attributes); ++i)
+	{
+		layout.attributes[i] = list[i].info;
+		layout.names[i] = list[i].name;
+	}
+
+	layout.hash = feVertexLayoutUtil::Hash(layout.attributes.data(), layout.count, feHash::Fnv1a64Value(layout.stride));
+	return layout;
+}
+
+// Specialised by FE_VERTEX_LAYOUT, value is the feVertexLayout of Vertex
+template<typename Vertex>
+struct feVertexLayoutOf;
+
+#define FE_VERTEX_ATTRIBUTE(Vertex, member) feMakeVertexAttribute<decltype(Vertex::member), decltype(Vertex::member)>(#member, offsetof(Vertex, member))
+// Reads the member as another type, such as feHalf3 for a uint16_t[4] position
+#define FE_VERTEX_ATTRIBUTE_AS(Vertex, member, As) feMakeVertexAttribute<As, decltype(Vertex::member)>(#member, offsetof(Vertex, member))
+
+// Attributes take consecutive locations in the order they are listed. Use at global scope:
+// FE_VERTEX_LAYOUT(feVertexPNT, FE_VERTEX_ATTRIBUTE(feVertexPNT, position), FE_VERTEX_ATTRIBUTE(feVertexPNT, normal));
+#define FE_VERTEX_LAYOUT(Vertex, ...) \
+	template<> \
+	struct feVertexLayoutOf<Vertex> \
+	{ \
+		static constexpr auto value = feMakeVertexLayout<Vertex>(__VA_ARGS__); \
+		static_assert(value.IsValid(), "Vertex attribute offset is outside of the vertex"); \
+	}
+
+// Position, normal and texture coordinates in full floats, the interleaved layout of Sphere
+struct feVertexPNT final
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+};
+
+FE_VERTEX_LAYOUT(feVertexPNT,
+	FE_VERTEX_ATTRIBUTE(feVertexPNT, position),
+	FE_VERTEX_ATTRIBUTE(feVertexPNT, normal),
+	FE_VERTEX_ATTRIBUTE(feVertexPNT, texCoord));
+
+static_assert(feVertexLayoutOf<feVertexPNT>::value.attributes[2].offset == 6 * sizeof(float), "feVertexPNT layout is wrong");
+
+// A model matrix per instance, four vec4 columns
+struct feInstanceTransform final
+{
+	glm::mat4 model;
+};
+
+FE_VERTEX_LAYOUT(feInstanceTransform,
+	FE_VERTEX_ATTRIBUTE(feInstanceTransform, model));
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace feHash
+{
+	// 32-bit FNV-1a, usable in constant expressions so names can be hashed at compile time
+	constexpr uint32_t Fnv1a32(std::string_view string, uint32_t hash = 2166136261u)
+	{
+		for (char c : string)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	// 64-bit FNV-1a, chain calls by passing the previous result as the hash
+	constexpr uint64_t Fnv1a64(std::string_view string, uint64_t hash = 14695981039346656037ull)
+	{
+		for (char c : string)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	// 64-bit FNV-1a over the bytes of an integer, lowest byte first so the result is the same on every platform
+	constexpr uint64_t Fnv1a64Value(uint64_t value, uint64_t hash = 14695981039346656037ull)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "Noise.h"
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_NOISE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t PrimeX = 0x8da6b343;
+	constexpr uint32_t PrimeY = 0xd8163841;
+	constexpr uint32_t PrimeZ = 0xcb1ab31f;
+	constexpr uint32_t MixA = 0x2c1b3c6d;
+	constexpr uint32_t MixB = 0x297a2d39;
+	constexpr float ValueScale = 2.0f / 16777215.0f;
+
+	float Lattice(int32_t x, int32_t y, int32_t z)
+	{
+		uint32_t h = (static_cast<uint32_t>(x) * PrimeX) ^ (static_cast<uint32_t>(y) * PrimeY) ^ (static_cast<uint32_t>(z) * PrimeZ);
+		h ^= h >> 15;
+		h *= MixA;
+		h ^= h >> 12;
+		h *= MixB;
+		h ^= h >> 15;
+
+		return static_cast<float>(static_cast<int32_t>(h & 0xFFFFFF)) * ValueScale - 1.0f;
+	}
+
+	float Fade(float t)
+	{
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	float Lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	float AmplitudeSum(int octaves, float gain)
+	{
+		float sum = 0.0f;
+		float amplitude = 1.0f;
+
+		for (int i = 0; i < octaves; ++i)
+		{
+			sum += amplitude;
+			amplitude *= gain;
+		}
+
+		return sum;
+	}
+
+#ifdef FE_NOISE_SSE
+	// SSE2 has no 32 bit low multiply, build it from the two 64 bit ones
+	__m128i MulLo(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	__m128 Lattice4(__m128i x, __m128i y, __m128i z)
+	{
+		__m128i h = _mm_xor_si128(_mm_xor_si128(MulLo(x, _mm_set1_epi32(static_cast<int>(PrimeX))), MulLo(y, _mm_set1_epi32(static_cast<int>(PrimeY)))), MulLo(z, _mm_set1_epi32(static_cast<int>(PrimeZ))));
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+		h = MulLo(h, _mm_set1_epi32(static_cast<int>(MixA)));
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+		h = MulLo(h, _mm_set1_epi32(static_cast<int>(MixB)));
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+
+		__m128 value = _mm_cvtepi32_ps(_mm_and_si128(h, _mm_set1_epi32(0xFFFFFF)));
+		return _mm_sub_ps(_mm_mul_ps(value, _mm_set1_ps(ValueScale)), _mm_set1_ps(1.0f));
+	}
+
+	__m128 Fade4(__m128 t)
+	{
+		return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_set1_ps(2.0f), t)));
+	}
+
+	__m128 Lerp4(__m128 a, __m128 b, __m128 t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+	}
+
+	// Truncation rounds negative values up, step those back down
+	__m128 Floor4(__m128 x)
+	{
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+	}
+
+	__m128 Value4(__m128 x, __m128 y, __m128 z)
+	{
+		__m128 fx = Floor4(x);
+		__m128 fy = Floor4(y);
+		__m128 fz = Floor4(z);
+
+		__m128i x0 = _mm_cvttps_epi32(fx);
+		__m128i y0 = _mm_cvttps_epi32(fy);
+		__m128i z0 = _mm_cvttps_epi32(fz);
+		__m128i one = _mm_set1_epi32(1);
+		__m128i x1 = _mm_add_epi32(x0, one);
+		__m128i y1 = _mm_add_epi32(y0, one);
+		__m128i z1 = _mm_add_epi32(z0, one);
+
+		__m128 tx = Fade4(_mm_sub_ps(x, fx));
+		__m128 ty = Fade4(_mm_sub_ps(y, fy));
+		__m128 tz = Fade4(_mm_sub_ps(z, fz));
+
+		__m128 x00 = Lerp4(Lattice4(x0, y0, z0), Lattice4(x1, y0, z0), tx);
+		__m128 x10 = Lerp4(Lattice4(x0, y1, z0), Lattice4(x1, y1, z0), tx);
+		__m128 x01 = Lerp4(Lattice4(x0, y0, z1), Lattice4(x1, y0, z1), tx);
+		__m128 x11 = Lerp4(Lattice4(x0, y1, z1), Lattice4(x1, y1, z1), tx);
+
+		return Lerp4(Lerp4(x00, x10, ty), Lerp4(x01, x11, ty), tz);
+	}
+#endif
+}
+
+namespace feNoise
+{
+	float Value(float x, float y, float z)
+	{
+		float fx = std::floor(x);
+		float fy = std::floor(y);
+		float fz = std::floor(z);
+
+		int32_t x0 = static_cast<int32_t>(fx);
+		int32_t y0 = static_cast<int32_t>(fy);
+		int32_t z0 = static_cast<int32_t>(fz);
+
+		float tx = Fade(x - fx);
+		float ty = Fade(y - fy);
+		float tz = Fade(z - fz);
+
+		float x00 = Lerp(Lattice(x0, y0, z0), Lattice(x0 + 1, y0, z0), tx);
+		float x10 = Lerp(Lattice(x0, y0 + 1, z0), Lattice(x0 + 1, y0 + 1, z0), tx);
+		float x01 = Lerp(Lattice(x0, y0, z0 + 1), Lattice(x0 + 1, y0, z0 + 1), tx);
+		float x11 = Lerp(Lattice(x0, y0 + 1, z0 + 1), Lattice(x0 + 1, y0 + 1, z0 + 1), tx);
+
+		return Lerp(Lerp(x00, x10, ty), Lerp(x01, x11, ty), tz);
+	}
+
+	float Fbm(float x, float y, float z, int octaves, float lacunarity, float gain)
+	{
+		float sum = 0.0f;
+		float amplitude = 1.0f;
+		float frequency = 1.0f;
+
+		for (int i = 0; i < octaves; ++i)
+		{
+			sum += amplitude * Value(x * frequency, y * frequency, z * frequency);
+			amplitude *= gain;
+			frequency *= lacunarity;
+		}
+
+		return octaves > 0 ? sum / AmplitudeSum(octaves, gain) : 0.0f;
+	}
+
+	void FbmBatch(const float* x, const float* y, const float* z, float* out, size_t count, int octaves, float lacunarity, float gain)
+	{
+		size_t i = 0;
+
+#ifdef FE_NOISE_SSE
+		if (octaves > 0)
+		{
+			__m128 amplitudeSum = _mm_set1_ps(AmplitudeSum(octaves, gain));
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 px = _mm_loadu_ps(x + i);
+				__m128 py = _mm_loadu_ps(y + i);
+				__m128 pz = _mm_loadu_ps(z + i);
+
+				__m128 sum = _mm_setzero_ps();
+				float amplitude = 1.0f;
+				float frequency = 1.0f;
+
+				for (int octave = 0; octave < octaves; ++octave)
+				{
+					__m128 f = _mm_set1_ps(frequency);
+					__m128 value = Value4(_mm_mul_ps(px, f), _mm_mul_ps(py, f), _mm_mul_ps(pz, f));
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitude), value));
+					amplitude *= gain;
+					frequency *= lacunarity;
+				}
+
+				_mm_storeu_ps(out + i, _mm_div_ps(sum, amplitudeSum));
+			}
+		}
+#endif
+
+		for (; i < count; ++i) out[i] = Fbm(x[i], y[i], z[i], octaves, lacunarity, gain);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Hashed value noise, deterministic across platforms and free of tables so worker threads can share it
+namespace feNoise
+{
+	// In [-1, 1], smooth between integer lattice points
+	float Value(float x, float y, float z);
+
+	// Octaves of Value, each lacunarity times the frequency and gain times the amplitude of the last. Normalised back
+	// to [-1, 1].
+	float Fbm(float x, float y, float z, int octaves, float lacunarity = 2.0f, float gain = 0.5f);
+
+	// Fbm of count points, four at a time with SSE2 when it is available. Gives the same results as Fbm.
+	void FbmBatch(const float* x, const float* y, const float* z, float* out, size_t count, int octaves, float lacunarity = 2.0f, float gain = 0.5f);
+}
\ No newline at end of file
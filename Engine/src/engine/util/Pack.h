@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Conversions to the compact vertex attribute encodings
+namespace fePack
+{
+	// IEEE 754 binary16 with round to nearest even, for GL_HALF_FLOAT
+	inline uint16_t Half(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t exponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		// NaN stays NaN, infinity stays infinity
+		if (exponent == 0xFF) return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+		int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+		if (halfExponent >= 0x1F) return static_cast<uint16_t>(sign | 0x7C00);
+
+		if (halfExponent <= 0)
+		{
+			// Too small even for a subnormal
+			if (halfExponent < -10) return static_cast<uint16_t>(sign);
+
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+			uint32_t half = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1FFF;
+		// A carry out of the mantissa correctly moves on to the next exponent
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) ++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Inverse of Half, exact for every binary16 value
+	inline float FloatFromHalf(uint16_t half)
+	{
+		uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x3FF;
+		uint32_t bits;
+
+		if (exponent == 0x1F)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+		else if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Subnormal, shift the leading one up into the implicit bit
+			int shift = 0;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				++shift;
+			}
+
+			bits = sign | (static_cast<uint32_t>(127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Signed normalized x, y and z in 10 bits each and w in 2, for normalized GL_INT_2_10_10_10_REV
+	inline uint32_t Snorm1010102(float x, float y, float z, float w = 0.0f)
+	{
+		auto pack = [](float value, float scale, uint32_t mask)
+		{
+			value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+			int32_t integer = static_cast<int32_t>(std::round(value * scale));
+			return static_cast<uint32_t>(integer) & mask;
+		};
+
+		return pack(x, 511.0f, 0x3FF) | (pack(y, 511.0f, 0x3FF) << 10) | (pack(z, 511.0f, 0x3FF) << 20) | (pack(w, 1.0f, 0x3) << 30);
+	}
+}
\ No newline at end of file
@@ -19,6 +19,7 @@
 #include <iomanip>
 #include <cmath>
 #include "Sphere.h"
+#include "Pack.h"
 
 
 
@@ -440,6 +441,36 @@ void Sphere::buildInterleavedVertices()
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// generate packed vertices: V/N/T
+// stride must be 16 bytes
+///////////////////////////////////////////////////////////////////////////////
+std::vector<Sphere::PackedVertex> Sphere::getPackedVertices() const
+{
+    std::vector<PackedVertex> packedVertices(getVertexCount());
+
+    std::size_t i, j, k;
+    std::size_t count = vertices.size();
+    for(i = 0, j = 0, k = 0; i < count; i += 3, j += 2, ++k)
+    {
+        PackedVertex& vertex = packedVertices[k];
+
+        vertex.position[0] = fePack::Half(vertices[i]);
+        vertex.position[1] = fePack::Half(vertices[i+1]);
+        vertex.position[2] = fePack::Half(vertices[i+2]);
+        vertex.position[3] = fePack::Half(1.0f);
+
+        vertex.normal = fePack::Snorm1010102(normals[i], normals[i+1], normals[i+2]);
+
+        vertex.texCoord[0] = fePack::Half(texCoords[j]);
+        vertex.texCoord[1] = fePack::Half(texCoords[j+1]);
+    }
+
+    return packedVertices;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // add single vertex to array
 ///////////////////////////////////////////////////////////////////////////////
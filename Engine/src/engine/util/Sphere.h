@@ -13,10 +13,19 @@
 #define GEOMETRY_SPHERE_H
 
 #include <vector>
+#include <cstdint>
 
 class Sphere
 {
 public:
+    // packed vertex: half float position, 2_10_10_10 normal, half float tex coord
+    struct PackedVertex
+    {
+        uint16_t position[4];   // x, y, z as GL_HALF_FLOAT, w is padding
+        uint32_t normal;        // normalized GL_INT_2_10_10_10_REV
+        uint16_t texCoord[2];   // GL_HALF_FLOAT
+    };
+
     // ctor/dtor
     Sphere(float radius=1.0f, int sectorCount=36, int stackCount=18, bool smooth=true);
     ~Sphere() {}
@@ -55,6 +64,10 @@ public:
     int getInterleavedStride() const                { return interleavedStride; }   // should be 32 bytes
     const float* getInterleavedVertices() const     { return interleavedVertices.data(); }
 
+    // for packed vertices: half of the interleaved size, same order and count
+    std::vector<PackedVertex> getPackedVertices() const;
+    int getPackedStride() const                     { return sizeof(PackedVertex); }   // should be 16 bytes
+
     // debug
     void printSelf() const;
 
@@ -0,0 +1,425 @@
+#include "SphereGenerator.h"
+
+#include <vector>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FE_SPHERE_GENERATOR_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "Pack.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	constexpr float FaceNormalEpsilon = 0.000001f;
+
+	struct Tables final
+	{
+		int sectorCount = 0;
+		int stackCount = 0;
+		float radius = 0.0f;
+		// sectorCount + 1 entries
+		std::vector<float> sectorCos;
+		std::vector<float> sectorSin;
+		// stackCount + 1 entries, r * cos(u) and r * sin(u)
+		std::vector<float> stackXY;
+		std::vector<float> stackZ;
+	};
+
+	void Clamp(const feSphereGeneratorInfo& info, int& sectorCount, int& stackCount)
+	{
+		sectorCount = info.sectorCount < 3 ? 3 : info.sectorCount;
+		stackCount = info.stackCount < 2 ? 2 : info.stackCount;
+	}
+
+	// Same expressions as Sphere so the results match bit for bit
+	void BuildTables(const feSphereGeneratorInfo& info, Tables& tables)
+	{
+		const float PI = static_cast<float>(std::acos(-1));
+
+		Clamp(info, tables.sectorCount, tables.stackCount);
+		tables.radius = info.radius;
+
+		float sectorStep = 2 * PI / tables.sectorCount;
+		float stackStep = PI / tables.stackCount;
+
+		tables.sectorCos.resize(tables.sectorCount + 1);
+		tables.sectorSin.resize(tables.sectorCount + 1);
+		for (int j = 0; j <= tables.sectorCount; ++j)
+		{
+			float sectorAngle = j * sectorStep;
+			tables.sectorCos[j] = cosf(sectorAngle);
+			tables.sectorSin[j] = sinf(sectorAngle);
+		}
+
+		tables.stackXY.resize(tables.stackCount + 1);
+		tables.stackZ.resize(tables.stackCount + 1);
+		for (int i = 0; i <= tables.stackCount; ++i)
+		{
+			float stackAngle = PI / 2 - i * stackStep;
+			tables.stackXY[i] = info.radius * cosf(stackAngle);
+			tables.stackZ[i] = info.radius * sinf(stackAngle);
+		}
+	}
+
+	struct InterleavedWriter final
+	{
+		float* vertices;
+
+		void operator()(size_t index, float x, float y, float z, float nx, float ny, float nz, float s, float t) const
+		{
+			float* vertex = vertices + index * 8;
+			vertex[0] = x;
+			vertex[1] = y;
+			vertex[2] = z;
+			vertex[3] = nx;
+			vertex[4] = ny;
+			vertex[5] = nz;
+			vertex[6] = s;
+			vertex[7] = t;
+		}
+	};
+
+	struct PackedWriter final
+	{
+		Sphere::PackedVertex* vertices;
+
+		void operator()(size_t index, float x, float y, float z, float nx, float ny, float nz, float s, float t) const
+		{
+			Sphere::PackedVertex& vertex = vertices[index];
+			vertex.position[0] = fePack::Half(x);
+			vertex.position[1] = fePack::Half(y);
+			vertex.position[2] = fePack::Half(z);
+			vertex.position[3] = fePack::Half(1.0f);
+			vertex.normal = fePack::Snorm1010102(nx, ny, nz);
+			vertex.texCoord[0] = fePack::Half(s);
+			vertex.texCoord[1] = fePack::Half(t);
+		}
+	};
+
+	// Index of the first triangle index of stack i, the first and last stacks have one triangle per sector
+	size_t StackIndexStart(size_t sectorCount, size_t stack)
+	{
+		return stack == 0 ? 0 : 3 * sectorCount + 6 * sectorCount * (stack - 1);
+	}
+
+	void WriteStackIndices(const Tables& tables, int i, unsigned int* indices)
+	{
+		unsigned int* out = indices + StackIndexStart(tables.sectorCount, i);
+
+		unsigned int k1 = i * (tables.sectorCount + 1);
+		unsigned int k2 = k1 + tables.sectorCount + 1;
+
+		for (int j = 0; j < tables.sectorCount; ++j, ++k1, ++k2)
+		{
+			if (i != 0)
+			{
+				*out++ = k1;
+				*out++ = k2;
+				*out++ = k1 + 1;
+			}
+
+			if (i != tables.stackCount - 1)
+			{
+				*out++ = k1 + 1;
+				*out++ = k2;
+				*out++ = k2 + 1;
+			}
+		}
+	}
+
+	// One row of sectorCount + 1 shared vertices and the triangles below it
+	template<typename Writer>
+	void WriteSmoothStack(const Tables& tables, int i, const Writer& writer, unsigned int* indices)
+	{
+		float xy = tables.stackXY[i];
+		float z = tables.stackZ[i];
+		float lengthInv = 1.0f / tables.radius;
+		float nz = z * lengthInv;
+		float t = static_cast<float>(i) / tables.stackCount;
+		float sectors = static_cast<float>(tables.sectorCount);
+
+		const float* cosTable = tables.sectorCos.data();
+		const float* sinTable = tables.sectorSin.data();
+
+		size_t base = static_cast<size_t>(i) * (tables.sectorCount + 1);
+		int count = tables.sectorCount + 1;
+		int j = 0;
+
+#ifdef FE_SPHERE_GENERATOR_SSE
+		__m128 xy4 = _mm_set1_ps(xy);
+		__m128 lengthInv4 = _mm_set1_ps(lengthInv);
+		__m128 sectors4 = _mm_set1_ps(sectors);
+
+		for (; j + 4 <= count; j += 4)
+		{
+			__m128 x = _mm_mul_ps(xy4, _mm_loadu_ps(cosTable + j));
+			__m128 y = _mm_mul_ps(xy4, _mm_loadu_ps(sinTable + j));
+			__m128 nx = _mm_mul_ps(x, lengthInv4);
+			__m128 ny = _mm_mul_ps(y, lengthInv4);
+			__m128 s = _mm_div_ps(_mm_cvtepi32_ps(_mm_setr_epi32(j, j + 1, j + 2, j + 3)), sectors4);
+
+			alignas(16) float lanes[5][4];
+			_mm_store_ps(lanes[0], x);
+			_mm_store_ps(lanes[1], y);
+			_mm_store_ps(lanes[2], nx);
+			_mm_store_ps(lanes[3], ny);
+			_mm_store_ps(lanes[4], s);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				writer(base + j + lane, lanes[0][lane], lanes[1][lane], z, lanes[2][lane], lanes[3][lane], nz, lanes[4][lane], t);
+			}
+		}
+#endif
+
+		for (; j < count; ++j)
+		{
+			float x = xy * cosTable[j];
+			float y = xy * sinTable[j];
+			writer(base + j, x, y, z, x * lengthInv, y * lengthInv, nz, static_cast<float>(j) / sectors, t);
+		}
+
+		if (i < tables.stackCount) WriteStackIndices(tables, i, indices);
+	}
+
+	// Stacks 1 and up start after the single triangles of the first stack
+	size_t FlatStackVertexStart(size_t sectorCount, size_t stack)
+	{
+		return stack == 0 ? 0 : 3 * sectorCount + 4 * sectorCount * (stack - 1);
+	}
+
+	// Sector j of stack i, v1 and v3 on the top edge, v2 and v4 on the bottom edge, n is the face normal
+	template<typename Writer>
+	void WriteFlatSector(const Tables& tables, int i, int j, size_t& vertex, unsigned int*& out, const Writer& writer,
+		float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, float nx, float ny, float nz)
+	{
+		float zTop = tables.stackZ[i];
+		float zBottom = tables.stackZ[i + 1];
+		float sectors = static_cast<float>(tables.sectorCount);
+		float s1 = static_cast<float>(j) / sectors;
+		float s3 = static_cast<float>(j + 1) / sectors;
+		float tTop = static_cast<float>(i) / tables.stackCount;
+		float tBottom = static_cast<float>(i + 1) / tables.stackCount;
+
+		unsigned int index = static_cast<unsigned int>(vertex);
+
+		if (i == 0)
+		{
+			writer(vertex++, x1, y1, zTop, nx, ny, nz, s1, tTop);
+			writer(vertex++, x2, y2, zBottom, nx, ny, nz, s1, tBottom);
+			writer(vertex++, x4, y4, zBottom, nx, ny, nz, s3, tBottom);
+
+			*out++ = index;
+			*out++ = index + 1;
+			*out++ = index + 2;
+		}
+		else if (i == tables.stackCount - 1)
+		{
+			writer(vertex++, x1, y1, zTop, nx, ny, nz, s1, tTop);
+			writer(vertex++, x2, y2, zBottom, nx, ny, nz, s1, tBottom);
+			writer(vertex++, x3, y3, zTop, nx, ny, nz, s3, tTop);
+
+			*out++ = index;
+			*out++ = index + 1;
+			*out++ = index + 2;
+		}
+		else
+		{
+			writer(vertex++, x1, y1, zTop, nx, ny, nz, s1, tTop);
+			writer(vertex++, x2, y2, zBottom, nx, ny, nz, s1, tBottom);
+			writer(vertex++, x3, y3, zTop, nx, ny, nz, s3, tTop);
+			writer(vertex++, x4, y4, zBottom, nx, ny, nz, s3, tBottom);
+
+			*out++ = index;
+			*out++ = index + 1;
+			*out++ = index + 2;
+			*out++ = index + 2;
+			*out++ = index + 1;
+			*out++ = index + 3;
+		}
+	}
+
+	// Independent triangles with face normals, the first stack uses v1 v2 v4 and every other v1 v2 v3 like Sphere
+	template<typename Writer>
+	void WriteFlatStack(const Tables& tables, int i, const Writer& writer, unsigned int* indices)
+	{
+		float xyTop = tables.stackXY[i];
+		float xyBottom = tables.stackXY[i + 1];
+		float zTop = tables.stackZ[i];
+		float zBottom = tables.stackZ[i + 1];
+		bool useV4 = i == 0;
+
+		const float* cosTable = tables.sectorCos.data();
+		const float* sinTable = tables.sectorSin.data();
+
+		size_t vertex = FlatStackVertexStart(tables.sectorCount, i);
+		unsigned int* out = indices + StackIndexStart(tables.sectorCount, i);
+		int j = 0;
+
+#ifdef FE_SPHERE_GENERATOR_SSE
+		__m128 xyTop4 = _mm_set1_ps(xyTop);
+		__m128 xyBottom4 = _mm_set1_ps(xyBottom);
+		// Third vertex is v4 on the bottom edge or v3 on the top edge
+		__m128 xyThird4 = useV4 ? xyBottom4 : xyTop4;
+		__m128 ez1 = _mm_set1_ps(zBottom - zTop);
+		__m128 ez2 = _mm_set1_ps((useV4 ? zBottom : zTop) - zTop);
+		__m128 epsilon = _mm_set1_ps(FaceNormalEpsilon);
+		__m128 one = _mm_set1_ps(1.0f);
+
+		for (; j + 4 <= tables.sectorCount; j += 4)
+		{
+			__m128 cos0 = _mm_loadu_ps(cosTable + j);
+			__m128 sin0 = _mm_loadu_ps(sinTable + j);
+			__m128 cos1 = _mm_loadu_ps(cosTable + j + 1);
+			__m128 sin1 = _mm_loadu_ps(sinTable + j + 1);
+
+			__m128 x1 = _mm_mul_ps(xyTop4, cos0);
+			__m128 y1 = _mm_mul_ps(xyTop4, sin0);
+			__m128 x2 = _mm_mul_ps(xyBottom4, cos0);
+			__m128 y2 = _mm_mul_ps(xyBottom4, sin0);
+			__m128 x3 = _mm_mul_ps(xyTop4, cos1);
+			__m128 y3 = _mm_mul_ps(xyTop4, sin1);
+			__m128 x4 = _mm_mul_ps(xyBottom4, cos1);
+			__m128 y4 = _mm_mul_ps(xyBottom4, sin1);
+
+			__m128 ex1 = _mm_sub_ps(x2, x1);
+			__m128 ey1 = _mm_sub_ps(y2, y1);
+			__m128 ex2 = _mm_sub_ps(_mm_mul_ps(xyThird4, cos1), x1);
+			__m128 ey2 = _mm_sub_ps(_mm_mul_ps(xyThird4, sin1), y1);
+
+			__m128 nx = _mm_sub_ps(_mm_mul_ps(ey1, ez2), _mm_mul_ps(ez1, ey2));
+			__m128 ny = _mm_sub_ps(_mm_mul_ps(ez1, ex2), _mm_mul_ps(ex1, ez2));
+			__m128 nz = _mm_sub_ps(_mm_mul_ps(ex1, ey2), _mm_mul_ps(ey1, ex2));
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			// Degenerate triangles get a zero normal
+			__m128 valid = _mm_cmpgt_ps(length, epsilon);
+			__m128 lengthInv = _mm_and_ps(_mm_div_ps(one, length), valid);
+			nx = _mm_and_ps(_mm_mul_ps(nx, lengthInv), valid);
+			ny = _mm_and_ps(_mm_mul_ps(ny, lengthInv), valid);
+			nz = _mm_and_ps(_mm_mul_ps(nz, lengthInv), valid);
+
+			alignas(16) float lanes[11][4];
+			_mm_store_ps(lanes[0], x1);
+			_mm_store_ps(lanes[1], y1);
+			_mm_store_ps(lanes[2], x2);
+			_mm_store_ps(lanes[3], y2);
+			_mm_store_ps(lanes[4], x3);
+			_mm_store_ps(lanes[5], y3);
+			_mm_store_ps(lanes[6], x4);
+			_mm_store_ps(lanes[7], y4);
+			_mm_store_ps(lanes[8], nx);
+			_mm_store_ps(lanes[9], ny);
+			_mm_store_ps(lanes[10], nz);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				WriteFlatSector(tables, i, j + lane, vertex, out, writer,
+					lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane], lanes[4][lane], lanes[5][lane], lanes[6][lane], lanes[7][lane],
+					lanes[8][lane], lanes[9][lane], lanes[10][lane]);
+			}
+		}
+#endif
+
+		for (; j < tables.sectorCount; ++j)
+		{
+			float x1 = xyTop * cosTable[j];
+			float y1 = xyTop * sinTable[j];
+			float x2 = xyBottom * cosTable[j];
+			float y2 = xyBottom * sinTable[j];
+			float x3 = xyTop * cosTable[j + 1];
+			float y3 = xyTop * sinTable[j + 1];
+			float x4 = xyBottom * cosTable[j + 1];
+			float y4 = xyBottom * sinTable[j + 1];
+
+			float ex1 = x2 - x1;
+			float ey1 = y2 - y1;
+			float ez1 = zBottom - zTop;
+			float ex2 = (useV4 ? x4 : x3) - x1;
+			float ey2 = (useV4 ? y4 : y3) - y1;
+			float ez2 = (useV4 ? zBottom : zTop) - zTop;
+
+			float nx = ey1 * ez2 - ez1 * ey2;
+			float ny = ez1 * ex2 - ex1 * ez2;
+			float nz = ex1 * ey2 - ey1 * ex2;
+
+			float length = sqrtf(nx * nx + ny * ny + nz * nz);
+			if (length > FaceNormalEpsilon)
+			{
+				float lengthInv = 1.0f / length;
+				nx *= lengthInv;
+				ny *= lengthInv;
+				nz *= lengthInv;
+			}
+			else
+			{
+				nx = ny = nz = 0.0f;
+			}
+
+			WriteFlatSector(tables, i, j, vertex, out, writer, x1, y1, x2, y2, x3, y3, x4, y4, nx, ny, nz);
+		}
+	}
+
+	template<typename Writer>
+	void GenerateWith(const feSphereGeneratorInfo& info, const Writer& writer, unsigned int* indices)
+	{
+		Tables tables;
+		BuildTables(info, tables);
+
+		// Smooth spheres have a row of vertices more than they have rows of triangles
+		size_t rowCount = info.smooth ? tables.stackCount + 1 : tables.stackCount;
+
+		auto generateRows = [&](size_t begin, size_t end)
+		{
+			for (size_t row = begin; row < end; ++row)
+			{
+				if (info.smooth) WriteSmoothStack(tables, static_cast<int>(row), writer, indices);
+				else WriteFlatStack(tables, static_cast<int>(row), writer, indices);
+			}
+		};
+
+		if (info.threadPool)
+		{
+			// Enough rows per chunk that handing them out costs less than generating them
+			size_t minChunk = 4096 / (tables.sectorCount + 1) + 1;
+			info.threadPool->ParallelFor(rowCount, minChunk, generateRows);
+		}
+		else
+		{
+			generateRows(0, rowCount);
+		}
+	}
+}
+
+namespace feSphereGenerator
+{
+	size_t GetVertexCount(const feSphereGeneratorInfo& info)
+	{
+		int sectorCount, stackCount;
+		Clamp(info, sectorCount, stackCount);
+
+		if (info.smooth) return static_cast<size_t>(stackCount + 1) * (sectorCount + 1);
+		return FlatStackVertexStart(sectorCount, stackCount - 1) + 3 * static_cast<size_t>(sectorCount);
+	}
+
+	size_t GetIndexCount(const feSphereGeneratorInfo& info)
+	{
+		int sectorCount, stackCount;
+		Clamp(info, sectorCount, stackCount);
+
+		return 6 * static_cast<size_t>(sectorCount) * (stackCount - 1);
+	}
+
+	void Generate(const feSphereGeneratorInfo& info, float* vertices, unsigned int* indices)
+	{
+		GenerateWith(info, InterleavedWriter{ vertices }, indices);
+	}
+
+	void GeneratePacked(const feSphereGeneratorInfo& info, Sphere::PackedVertex* vertices, unsigned int* indices)
+	{
+		GenerateWith(info, PackedWriter{ vertices }, indices);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Sphere.h"
+
+class feThreadPool;
+
+struct feSphereGeneratorInfo final
+{
+	float radius = 1.0f;
+	// Clamped to at least 3 sectors and 2 stacks
+	int sectorCount = 36;
+	int stackCount = 18;
+	bool smooth = true;
+	// Stacks are split across the pool when set
+	feThreadPool* threadPool = nullptr;
+};
+
+// Builds the same vertices and indices as Sphere, in the same order, straight into caller memory. Trigonometry comes
+// from per stack and per sector tables and nothing is allocated per vertex. Size the buffers with GetVertexCount and
+// GetIndexCount first.
+namespace feSphereGenerator
+{
+	size_t GetVertexCount(const feSphereGeneratorInfo& info);
+	size_t GetIndexCount(const feSphereGeneratorInfo& info);
+
+	// vertices holds GetVertexCount * 8 floats, position, normal and tex coord like Sphere::getInterleavedVertices
+	void Generate(const feSphereGeneratorInfo& info, float* vertices, unsigned int* indices);
+	void GeneratePacked(const feSphereGeneratorInfo& info, Sphere::PackedVertex* vertices, unsigned int* indices);
+}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include "SphereMeshes.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "SphereGenerator.h"
+
+namespace
+{
+	constexpr int MaxIcosphereSubdivisions = 8;
+	constexpr int MaxCubeSphereSegments = 256;
+	constexpr int MaxUvSphereSectors = 1024;
+	// Vertices this close to the z axis have no meaningful s
+	constexpr float PoleEpsilon = 1e-6f;
+
+	// Unit positions and triangles before tex coords are assigned
+	struct UnitMesh final
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+	};
+
+	UnitMesh BuildIcosahedron()
+	{
+		const float phi = (1.0f + std::sqrt(5.0f)) * 0.5f;
+
+		UnitMesh mesh;
+		mesh.positions = {
+			{ -1, phi, 0 }, { 1, phi, 0 }, { -1, -phi, 0 }, { 1, -phi, 0 },
+			{ 0, -1, phi }, { 0, 1, phi }, { 0, -1, -phi }, { 0, 1, -phi },
+			{ phi, 0, -1 }, { phi, 0, 1 }, { -phi, 0, -1 }, { -phi, 0, 1 },
+		};
+
+		for (glm::vec3& position : mesh.positions) position = glm::normalize(position);
+
+		// Counter clockwise seen from outside
+		mesh.indices = {
+			0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+			1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+			3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+			4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+		};
+
+		return mesh;
+	}
+
+	// Splits every triangle in four, edge midpoints are looked up by their two end vertices so neighbours share them
+	void Subdivide(UnitMesh& mesh)
+	{
+		size_t triangleCount = mesh.indices.size() / 3;
+
+		// Every edge is shared by two triangles on a closed mesh
+		std::unordered_map<uint64_t, unsigned int> midpoints;
+		midpoints.reserve(triangleCount * 3 / 2);
+
+		mesh.positions.reserve(mesh.positions.size() + triangleCount * 3 / 2);
+
+		auto midpoint = [&mesh, &midpoints](unsigned int a, unsigned int b)
+		{
+			uint64_t key = a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+
+			auto [it, inserted] = midpoints.try_emplace(key, static_cast<unsigned int>(mesh.positions.size()));
+			if (inserted) mesh.positions.push_back(glm::normalize(mesh.positions[a] + mesh.positions[b]));
+
+			return it->second;
+		};
+
+		std::vector<unsigned int> indices;
+		indices.reserve(triangleCount * 12);
+
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			unsigned int a = mesh.indices[i * 3 + 0];
+			unsigned int b = mesh.indices[i * 3 + 1];
+			unsigned int c = mesh.indices[i * 3 + 2];
+
+			unsigned int ab = midpoint(a, b);
+			unsigned int bc = midpoint(b, c);
+			unsigned int ca = midpoint(c, a);
+
+			indices.insert(indices.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+		}
+
+		mesh.indices = std::move(indices);
+	}
+
+	UnitMesh BuildIcosphere(int subdivisions)
+	{
+		UnitMesh mesh = BuildIcosahedron();
+		for (int i = 0; i < subdivisions; ++i) Subdivide(mesh);
+		return mesh;
+	}
+
+	// Points on the cube surface are on an integer lattice from -segments to segments in steps of 2, so vertices on
+	// the edges between faces have identical keys
+	UnitMesh BuildCubeSphere(int segments)
+	{
+		struct Face final
+		{
+			glm::ivec3 normal;
+			glm::ivec3 u;
+			glm::ivec3 v;
+		};
+
+		// u x v = normal, so quads wound along u then v face outwards
+		const Face faces[6] = {
+			{ {  1,  0,  0 }, {  0,  0, -1 }, { 0, 1,  0 } },
+			{ { -1,  0,  0 }, {  0,  0,  1 }, { 0, 1,  0 } },
+			{ {  0,  1,  0 }, {  1,  0,  0 }, { 0, 0, -1 } },
+			{ {  0, -1,  0 }, {  1,  0,  0 }, { 0, 0,  1 } },
+			{ {  0,  0,  1 }, {  1,  0,  0 }, { 0, 1,  0 } },
+			{ {  0,  0, -1 }, { -1,  0,  0 }, { 0, 1,  0 } },
+		};
+
+		UnitMesh mesh;
+		size_t vertexCount = 6 * static_cast<size_t>(segments) * segments + 2;
+		mesh.positions.reserve(vertexCount);
+		mesh.indices.reserve(36 * static_cast<size_t>(segments) * segments);
+
+		std::unordered_map<uint64_t, unsigned int> lattice;
+		lattice.reserve(vertexCount);
+
+		const float inverseSegments = 1.0f / segments;
+		std::vector<unsigned int> grid = std::vector<unsigned int>((segments + 1) * (segments + 1));
+
+		for (const Face& face : faces)
+		{
+			for (int j = 0; j <= segments; ++j)
+			{
+				for (int i = 0; i <= segments; ++i)
+				{
+					glm::ivec3 point = face.normal * segments + face.u * (2 * i - segments) + face.v * (2 * j - segments);
+
+					uint64_t key = (static_cast<uint64_t>(point.x + segments) << 42) | (static_cast<uint64_t>(point.y + segments) << 21) | static_cast<uint64_t>(point.z + segments);
+
+					auto [it, inserted] = lattice.try_emplace(key, static_cast<unsigned int>(mesh.positions.size()));
+					if (inserted)
+					{
+						mesh.positions.push_back(feSphereMeshes::SpherifyCubePoint(glm::vec3(point) * inverseSegments));
+					}
+
+					grid[j * (segments + 1) + i] = it->second;
+				}
+			}
+
+			for (int j = 0; j < segments; ++j)
+			{
+				for (int i = 0; i < segments; ++i)
+				{
+					unsigned int k00 = grid[j * (segments + 1) + i];
+					unsigned int k10 = grid[j * (segments + 1) + i + 1];
+					unsigned int k01 = grid[(j + 1) * (segments + 1) + i];
+					unsigned int k11 = grid[(j + 1) * (segments + 1) + i + 1];
+
+					mesh.indices.insert(mesh.indices.end(), { k00, k10, k11,  k00, k11, k01 });
+				}
+			}
+		}
+
+		return mesh;
+	}
+
+	// Tex coords follow Sphere, s around z from +x and t from the north pole. Triangles that cross the seam get copies of
+	// their vertices with s past 1, corners on a pole get a copy with s in the middle of the triangle.
+	feSphereMesh Finalize(const UnitMesh& mesh, float radius)
+	{
+		const float twoPi = 2.0f * glm::pi<float>();
+
+		struct Vertex final
+		{
+			glm::vec3 position;
+			float s, t;
+		};
+
+		std::vector<Vertex> vertices;
+		vertices.reserve(mesh.positions.size() + mesh.positions.size() / 8);
+
+		for (const glm::vec3& position : mesh.positions)
+		{
+			float s = std::atan2(position.y, position.x) / twoPi;
+			if (s < 0.0f) s += 1.0f;
+			float t = std::acos(glm::clamp(position.z, -1.0f, 1.0f)) / glm::pi<float>();
+			vertices.push_back({ position, s, t });
+		}
+
+		std::vector<unsigned int> indices = mesh.indices;
+		std::unordered_map<unsigned int, unsigned int> wrapped;
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			unsigned int* triangle = indices.data() + i;
+
+			auto isPole = [&vertices](unsigned int index)
+			{
+				const glm::vec3& p = vertices[index].position;
+				return std::abs(p.x) < PoleEpsilon && std::abs(p.y) < PoleEpsilon;
+			};
+
+			float minS = 1.0f;
+			float maxS = 0.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (isPole(triangle[k])) continue;
+				minS = std::min(minS, vertices[triangle[k]].s);
+				maxS = std::max(maxS, vertices[triangle[k]].s);
+			}
+
+			if (maxS - minS > 0.5f)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					if (isPole(triangle[k]) || vertices[triangle[k]].s >= 0.5f) continue;
+
+					auto [it, inserted] = wrapped.try_emplace(triangle[k], static_cast<unsigned int>(vertices.size()));
+					if (inserted)
+					{
+						Vertex copy = vertices[triangle[k]];
+						copy.s += 1.0f;
+						vertices.push_back(copy);
+					}
+
+					triangle[k] = it->second;
+				}
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				if (!isPole(triangle[k])) continue;
+
+				Vertex copy = vertices[triangle[k]];
+				copy.s = (vertices[triangle[(k + 1) % 3]].s + vertices[triangle[(k + 2) % 3]].s) * 0.5f;
+				triangle[k] = static_cast<unsigned int>(vertices.size());
+				vertices.push_back(copy);
+			}
+		}
+
+		feSphereMesh result;
+		result.vertices.resize(vertices.size() * 8);
+		result.indices = std::move(indices);
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			float* out = result.vertices.data() + i * 8;
+			const Vertex& vertex = vertices[i];
+			out[0] = vertex.position.x * radius;
+			out[1] = vertex.position.y * radius;
+			out[2] = vertex.position.z * radius;
+			out[3] = vertex.position.x;
+			out[4] = vertex.position.y;
+			out[5] = vertex.position.z;
+			out[6] = vertex.s;
+			out[7] = vertex.t;
+		}
+
+		return result;
+	}
+
+	float UnitMeshError(const UnitMesh& mesh)
+	{
+		return feSphereMeshes::MaxError(&mesh.positions[0].x, 3, mesh.indices.data(), mesh.indices.size(), 1.0f);
+	}
+}
+
+namespace feSphereMeshes
+{
+	feSphereMesh Icosphere(float radius, int subdivisions)
+	{
+		subdivisions = glm::clamp(subdivisions, 0, MaxIcosphereSubdivisions);
+		return Finalize(BuildIcosphere(subdivisions), radius);
+	}
+
+	feSphereMesh CubeSphere(float radius, int segments)
+	{
+		segments = glm::clamp(segments, 1, MaxCubeSphereSegments);
+		return Finalize(BuildCubeSphere(segments), radius);
+	}
+
+	glm::vec3 SpherifyCubePoint(const glm::vec3& point)
+	{
+		glm::vec3 p2 = point * point;
+		glm::vec3 result;
+		result.x = point.x * std::sqrt(1.0f - p2.y * 0.5f - p2.z * 0.5f + p2.y * p2.z / 3.0f);
+		result.y = point.y * std::sqrt(1.0f - p2.z * 0.5f - p2.x * 0.5f + p2.z * p2.x / 3.0f);
+		result.z = point.z * std::sqrt(1.0f - p2.x * 0.5f - p2.y * 0.5f + p2.x * p2.y / 3.0f);
+
+		// Exactly on the sphere in theory, rounding leaves it a little off
+		return glm::normalize(result);
+	}
+
+	glm::dvec3 SpherifyCubePoint(const glm::dvec3& point)
+	{
+		glm::dvec3 p2 = point * point;
+		glm::dvec3 result;
+		result.x = point.x * std::sqrt(1.0 - p2.y * 0.5 - p2.z * 0.5 + p2.y * p2.z / 3.0);
+		result.y = point.y * std::sqrt(1.0 - p2.z * 0.5 - p2.x * 0.5 + p2.z * p2.x / 3.0);
+		result.z = point.z * std::sqrt(1.0 - p2.x * 0.5 - p2.y * 0.5 + p2.x * p2.y / 3.0);
+
+		return glm::normalize(result);
+	}
+
+	float MaxError(const float* vertices, size_t strideFloats, const unsigned int* indices, size_t indexCount, float radius)
+	{
+		float error = 0.0f;
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			glm::vec3 p0 = glm::vec3(vertices[indices[i + 0] * strideFloats], vertices[indices[i + 0] * strideFloats + 1], vertices[indices[i + 0] * strideFloats + 2]);
+			glm::vec3 p1 = glm::vec3(vertices[indices[i + 1] * strideFloats], vertices[indices[i + 1] * strideFloats + 1], vertices[indices[i + 1] * strideFloats + 2]);
+			glm::vec3 p2 = glm::vec3(vertices[indices[i + 2] * strideFloats], vertices[indices[i + 2] * strideFloats + 1], vertices[indices[i + 2] * strideFloats + 2]);
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+
+			// The degenerate triangles at the poles of a UV sphere cover nothing
+			if (length <= 1e-12f) continue;
+
+			float distance = std::abs(glm::dot(normal, p0)) / length;
+			error = std::max(error, radius - distance);
+		}
+
+		return error;
+	}
+
+	int IcosphereSubdivisionsForError(float radius, float maxError)
+	{
+		UnitMesh mesh = BuildIcosahedron();
+
+		int subdivisions = 0;
+		while (subdivisions < MaxIcosphereSubdivisions && UnitMeshError(mesh) * radius > maxError)
+		{
+			Subdivide(mesh);
+			++subdivisions;
+		}
+
+		return subdivisions;
+	}
+
+	int CubeSphereSegmentsForError(float radius, float maxError)
+	{
+		// The error falls as segments grow, binary search for the first count within it
+		int low = 1;
+		int high = MaxCubeSphereSegments;
+
+		while (low < high)
+		{
+			int middle = (low + high) / 2;
+			if (UnitMeshError(BuildCubeSphere(middle)) * radius > maxError) low = middle + 1;
+			else high = middle;
+		}
+
+		return low;
+	}
+
+	int UvSphereSectorsForError(float radius, float maxError)
+	{
+		auto error = [](int sectors)
+		{
+			feSphereGeneratorInfo info;
+			info.radius = 1.0f;
+			info.sectorCount = sectors;
+			info.stackCount = sectors / 2;
+
+			std::vector<float> vertices = std::vector<float>(feSphereGenerator::GetVertexCount(info) * 8);
+			std::vector<unsigned int> indices = std::vector<unsigned int>(feSphereGenerator::GetIndexCount(info));
+			feSphereGenerator::Generate(info, vertices.data(), indices.data());
+
+			return MaxError(vertices.data(), 8, indices.data(), indices.size(), 1.0f);
+		};
+
+		// Even sector counts only, so the stacks are exactly half
+		int low = 2;
+		int high = MaxUvSphereSectors / 2;
+
+		while (low < high)
+		{
+			int middle = (low + high) / 2;
+			if (error(middle * 2) * radius > maxError) low = middle + 1;
+			else high = middle;
+		}
+
+		return low * 2;
+	}
+}
\ No newline at end of file
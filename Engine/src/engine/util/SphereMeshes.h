@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// Interleaved position, normal and tex coord like Sphere::getInterleavedVertices, so the meshes use the feVertexPNT
+// layout. Vertices are shared between triangles except along the tex coord seam and at the poles.
+struct feSphereMesh final
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+
+	static constexpr int stride = 8 * sizeof(float);
+
+	[[nodiscard]] size_t GetVertexCount() const { return vertices.size() / 8; }
+	[[nodiscard]] size_t GetTriangleCount() const { return indices.size() / 3; }
+};
+
+// Spheres with evenly spread vertices, unlike the UV sphere that crowds them at the poles
+namespace feSphereMeshes
+{
+	// Icosahedron with every triangle split in four per subdivision, 20 * 4^subdivisions triangles
+	feSphereMesh Icosphere(float radius, int subdivisions);
+	// Cube with segments x segments quads per face pushed out onto the sphere, 12 * segments^2 triangles
+	feSphereMesh CubeSphere(float radius, int segments);
+
+	// Maps a point on the surface of the [-1, 1] cube onto the unit sphere, spreading points more evenly than
+	// normalising it would
+	glm::vec3 SpherifyCubePoint(const glm::vec3& point);
+	// For points that have to resolve very small cube areas, such as deep planet patches
+	glm::dvec3 SpherifyCubePoint(const glm::dvec3& point);
+
+	// Largest distance between the sphere and the plane of any triangle. vertices start with a position every
+	// strideFloats floats.
+	float MaxError(const float* vertices, size_t strideFloats, const unsigned int* indices, size_t indexCount, float radius);
+
+	// Smallest tessellation whose MaxError is within maxError, levels are capped so the search always ends
+	int IcosphereSubdivisionsForError(float radius, float maxError);
+	int CubeSphereSegmentsForError(float radius, float maxError);
+	// Sectors of a smooth UV sphere with half as many stacks
+	int UvSphereSectorsForError(float radius, float maxError);
+}
\ No newline at end of file
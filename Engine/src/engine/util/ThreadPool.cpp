@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+feThreadPool::feThreadPool(const feThreadPoolCreateInfo& info)
+{
+	size_t threadCount = info.threadCount;
+
+	if (threadCount == 0)
+	{
+		size_t hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	m_Threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) m_Threads.emplace_back(&feThreadPool::WorkerMain, this);
+}
+
+feThreadPool::~feThreadPool() noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_Condition.notify_all();
+
+	for (std::thread& thread : m_Threads) thread.join();
+}
+
+void feThreadPool::Submit(std::function<void()> task)
+{
+	// Without workers nothing would ever pick the task up
+	if (m_Threads.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+
+	m_Condition.notify_one();
+}
+
+void feThreadPool::ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t begin, size_t end)>& func)
+{
+	if (count == 0) return;
+	if (minChunk == 0) minChunk = 1;
+
+	// A few chunks per thread keeps them busy when chunks take uneven time
+	size_t chunkCount = (m_Threads.size() + 1) * 4;
+	size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+	if (chunkSize < minChunk) chunkSize = minChunk;
+	chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	if (chunkCount == 1 || m_Threads.empty())
+	{
+		func(0, count);
+		return;
+	}
+
+	// Helpers still queued when the call returns find no chunks left, they only ever touch the shared state
+	struct SharedState final
+	{
+		std::atomic<size_t> next = 0;
+		std::atomic<size_t> finished = 0;
+		const std::function<void(size_t begin, size_t end)>* func = nullptr;
+	};
+
+	std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+	state->func = &func;
+
+	auto work = [count, chunkSize](SharedState& state)
+	{
+		for (;;)
+		{
+			size_t begin = state.next.fetch_add(chunkSize);
+			if (begin >= count) break;
+
+			(*state.func)(begin, begin + chunkSize < count ? begin + chunkSize : count);
+			state.finished.fetch_add(1);
+		}
+	};
+
+	size_t helperCount = m_Threads.size() < chunkCount - 1 ? m_Threads.size() : chunkCount - 1;
+	for (size_t i = 0; i < helperCount; ++i) Submit([state, work]() { work(*state); });
+
+	work(*state);
+
+	// Every chunk is claimed once work returns, only the ones helpers are still running are waited for. Other queued
+	// tasks are never run here, a frame waiting on culling must not pick up a long job such as a planet patch.
+	while (state->finished.load() < chunkCount) std::this_thread::yield();
+}
+
+size_t feThreadPool::GetThreadCount() const
+{
+	return m_Threads.size();
+}
+
+void feThreadPool::WorkerMain()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+
+			if (m_Tasks.empty()) return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+
+		task();
+	}
+}
\ No newline at end of file
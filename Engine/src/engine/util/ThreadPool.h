@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+struct feThreadPoolCreateInfo final
+{
+	// 0 uses one thread less than the hardware has, the calling thread takes part in ParallelFor
+	size_t threadCount = 0;
+};
+
+// Fixed set of worker threads for splitting CPU work such as mesh generation and culling
+class feThreadPool final
+{
+public:
+	feThreadPool(const feThreadPoolCreateInfo& info = feThreadPoolCreateInfo());
+	~feThreadPool() noexcept;
+
+	feThreadPool(const feThreadPool&) = delete;
+	feThreadPool& operator=(const feThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Runs func over [0, count) in chunks of at least minChunk on the workers and the calling thread, returns once every
+	// chunk is done. The calling thread only runs chunks of this call, it takes over any that no worker picked up, so it
+	// can be called from inside a task and never waits behind unrelated queued tasks.
+	void ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t begin, size_t end)>& func);
+
+	[[nodiscard]] size_t GetThreadCount() const;
+private:
+	void WorkerMain();
+private:
+	std::vector<std::thread> m_Threads;
+	std::deque<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stopping = false;
+};
\ No newline at end of file
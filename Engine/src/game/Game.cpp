@@ -1,6 +1,7 @@
 #include <glad/gl.h>
 
 #include <unordered_set>
+#include <algorithm>
 
 #include <lua.hpp>
 
@@ -9,11 +10,30 @@
 #include "../engine/Log.h"
 #include "../engine/renderer/BufferObject.h"
 #include "../engine/renderer/VertexArray.h"
+#include "../engine/renderer/BufferHeap.h"
+#include "../engine/renderer/StreamBuffer.h"
+#include "../engine/renderer/BatchRenderer.h"
+#include "../engine/renderer/RenderQueue.h"
+#include "../engine/renderer/MeshLod.h"
+#include "../engine/renderer/FrustumCuller.h"
+#include "../engine/renderer/OcclusionCuller.h"
+#include "../engine/renderer/Planet.h"
 #include "../engine/renderer/Shader.h"
+#include "../engine/renderer/UniformBuffer.h"
+#include "../engine/renderer/ProgramCache.h"
+#include "../engine/renderer/ProgramCompiler.h"
+#include "../engine/renderer/ShaderLibrary.h"
 #include "../engine/ResourceLoader.h"
 #include "../engine/renderer/Util.h"
+#include "../engine/renderer/RenderState.h"
 #include "../engine/math/Transform.h"
+#include "../engine/math/TransformArray.h"
+#include "../engine/math/TransformHierarchy.h"
+#include "../engine/math/Bvh.h"
 #include "../engine/util/Sphere.h"
+#include "../engine/util/SphereGenerator.h"
+#include "../engine/util/SphereMeshes.h"
+#include "../engine/util/ThreadPool.h"
 #include "../engine/Event.h"
 #include "WindowEvents.h"
 
@@ -41,6 +61,42 @@ static void MakeWindow(feWindow& window, int width, int height, unsigned char ve
 	feRenderUtil::ClearLoadedFlag();
 }
 
+// Sphere::PackedVertex stores the position in four halves, the last one is padding
+FE_VERTEX_LAYOUT(Sphere::PackedVertex,
+	FE_VERTEX_ATTRIBUTE_AS(Sphere::PackedVertex, position, feHalf3),
+	FE_VERTEX_ATTRIBUTE_AS(Sphere::PackedVertex, normal, feSnorm1010102),
+	FE_VERTEX_ATTRIBUTE_AS(Sphere::PackedVertex, texCoord, feHalf2));
+
+// Generates into buffers sized up front, then optimises and uploads them
+static feMeshAllocation UploadSphere(feMeshHeap& heap, feMeshFormat format, const feSphereGeneratorInfo& info)
+{
+	std::vector<Sphere::PackedVertex> vertices = std::vector<Sphere::PackedVertex>(feSphereGenerator::GetVertexCount(info));
+	std::vector<unsigned int> indices = std::vector<unsigned int>(feSphereGenerator::GetIndexCount(info));
+
+	feSphereGenerator::GeneratePacked(info, vertices.data(), indices.data());
+
+	return heap.UploadOptimized(format, vertices.data(), vertices.size(), indices.data(), indices.size(), "Sphere");
+}
+
+struct SceneProgram final
+{
+	void Set(std::shared_ptr<feProgram> value)
+	{
+		program = std::move(value);
+		if (!program) return;
+
+		color = program->GetUniformSlot("u_Color"_uniform);
+	}
+
+	bool IsReady() const
+	{
+		return program && program->IsLinked();
+	}
+
+	std::shared_ptr<feProgram> program;
+	feUniformSlot color;
+};
+
 class ScriptState final
 {
 public:
@@ -81,11 +137,41 @@ public:
 		width = (int) lua_tointeger(state.L, -2);
 		height = (int) lua_tointeger(state.L, -1);
 
+		lua_pop(state.L, 2);
+
+		lua_getglobal(state.L, "programCache");
+		programCache = lua_toboolean(state.L, -1);
+
+		lua_pop(state.L, 1);
+
+		lua_getglobal(state.L, "instanceCount");
+		if (lua_isnumber(state.L, -1)) instanceCount = (int) lua_tointeger(state.L, -1);
+
+		lua_pop(state.L, 1);
+
+		lua_getglobal(state.L, "depthPrepass");
+		depthPrepass = lua_toboolean(state.L, -1);
+
+		lua_pop(state.L, 1);
+
+		lua_getglobal(state.L, "planet");
+		planet = lua_toboolean(state.L, -1);
+
+		lua_pop(state.L, 1);
+
+		lua_getglobal(state.L, "occlusionCulling");
+		occlusionCulling = lua_toboolean(state.L, -1);
+
 		lua_pop(state.L, 1);
 	}
 
 	int width = 0;
 	int height = 0;
+	bool programCache = false;
+	int instanceCount = 1;
+	bool depthPrepass = false;
+	bool planet = false;
+	bool occlusionCulling = false;
 };
 
 struct WindowEventInputMode
@@ -108,6 +194,12 @@ public:
 		m_Mouse.y = event.y;
 	}
 
+	void OnMouseButton(const feEventWindowMouseButton& event)
+	{
+		if (event.pressed) m_Buttons.insert(event.button);
+		else m_Buttons.erase(event.button);
+	}
+
 	Input() = default;
 
 	Input(const Input&) = delete;
@@ -119,6 +211,7 @@ public:
 		m_Dispatcher = &dispatcher;
 		dispatcher.Subscribe(this, &Input::OnKey);
 		dispatcher.Subscribe(this, &Input::OnMouseMove);
+		dispatcher.Subscribe(this, &Input::OnMouseButton);
 	}
 
 	void Unset()
@@ -130,6 +223,7 @@ public:
 	void Update()
 	{
 		m_KeysLast = m_Keys;
+		m_ButtonsLast = m_Buttons;
 		m_MouseLast = m_Mouse;
 		feWindow::PollEvents();
 	}
@@ -144,6 +238,17 @@ public:
 		return IsKeyDown(key) && m_KeysLast.find(key) == m_KeysLast.end();
 	}
 
+	bool IsButtonPressed(int button) const
+	{
+		return m_Buttons.find(button) != m_Buttons.end() && m_ButtonsLast.find(button) == m_ButtonsLast.end();
+	}
+
+	// In window coordinates, the origin is the top left corner
+	glm::vec2 GetMousePosition() const
+	{
+		return m_Mouse;
+	}
+
 	glm::vec2 GetMouseDelta() const
 	{
 		return m_Mouse - m_MouseLast;
@@ -156,6 +261,8 @@ public:
 private:
 	std::unordered_set<int> m_Keys;
 	std::unordered_set<int> m_KeysLast;
+	std::unordered_set<int> m_Buttons;
+	std::unordered_set<int> m_ButtonsLast;
 	glm::vec2 m_Mouse = glm::vec2(0.0f, 0.0f);
 	glm::vec2 m_MouseLast = glm::vec2(0.0f, 0.0f);
 
@@ -165,7 +272,8 @@ private:
 class Camera final
 {
 public:
-	void Move(const Input& input, float deltaTime)
+	// Returns true if the transform changed
+	bool Move(const Input& input, float deltaTime)
 	{
 		if (input.IsKeyPressed(GLFW_KEY_ESCAPE))
 		{
@@ -175,7 +283,9 @@ public:
 			else input.GetEventDispatcher().Dispatch<WindowEventInputMode>(GLFW_CURSOR_DISABLED);
 		}
 
-		if (m_Locked) return;
+		if (m_Locked) return false;
+
+		bool moved = false;
 
 		constexpr float mouseSensitivity = 0.3f;
 
@@ -183,10 +293,12 @@ public:
 		
 		if (glm::length2(mouseDelta) > 0)
 		{
-			glm::vec4 axis = glm::inverse(m_Transform.GetMatrix()) * glm::vec4(0, 1, 0, 0);
+			// World up in local space, the inverse of the rotation is its conjugate
+			glm::vec3 axis = glm::inverse(m_Transform.quat) * glm::vec3(0, 1, 0) / m_Transform.sca;
 
-			m_Transform.Rotate(glm::radians(mouseDelta.x * -mouseSensitivity), glm::vec3(axis));
+			m_Transform.Rotate(glm::radians(mouseDelta.x * -mouseSensitivity), axis);
 			m_Transform.Rotate(glm::radians(mouseDelta.y * -mouseSensitivity), glm::vec3(1, 0, 0));
+			moved = true;
 		}
 
 		glm::vec4 movementVector = glm::vec4(0, 0, 0, 0);
@@ -207,13 +319,13 @@ public:
 			movementVector = glm::normalize(movementVector);
 			movementVector *= speed * deltaTime;
 
-			glm::mat4 transform = m_Transform.GetMatrix();
-			transform = glm::translate(transform, glm::vec3(movementVector));
-			glm::vec4 axis = glm::inverse(transform) * glm::vec4(0, 1, 0, 0);
-			transform = glm::translate(transform, glm::vec3(axis) * movementVector.w);
-
-			m_Transform.SetMatrix(transform);
+			// xyz moves in local space, w along world up
+			m_Transform.pos += m_Transform.quat * (m_Transform.sca * glm::vec3(movementVector));
+			m_Transform.pos += glm::vec3(0, 1, 0) * movementVector.w;
+			moved = true;
 		}
+
+		return moved;
 	}
 public:
 	feTransform m_Transform;
@@ -265,91 +377,271 @@ public:
 			game->m_EventDispatcher.Dispatch<feEventWindowMouseMove>(&game->m_Window, float(x), float(y));
 		});
 
+		glfwSetMouseButtonCallback(m_Window.GetHandle(), [](GLFWwindow* window, int button, int action, int mods)
+		{
+			Game* game = static_cast<Game*>(glfwGetWindowUserPointer(window));
+
+			game->m_EventDispatcher.Dispatch<feEventWindowMouseButton>(&game->m_Window, button, action == GLFW_PRESS);
+		});
+
 		feRenderUtil::LogOpenGLInfo();
 		feRenderUtil::InitDefaults(0.7f, 0.8f, 0.9f, 1.0f);
 		feRenderUtil::SetupDebugLogger();
 
-		Sphere sphere = Sphere(1, 36, 18, false);
+		feSphereGeneratorInfo sphereInfo;
+		sphereInfo.radius = 1.0f;
+		sphereInfo.sectorCount = 36;
+		sphereInfo.stackCount = 18;
+		sphereInfo.smooth = false;
+		sphereInfo.threadPool = &m_ThreadPool;
+
+		feMeshHeapCreateInfo heapInfo;
+		heapInfo.vertexCapacity = 16 * 1024 * 1024;
+		heapInfo.indexCapacity = 8 * 1024 * 1024;
+		heapInfo.debugName = "Mesh heap";
+
+		m_MeshHeap = heapInfo;
 
+		m_CameraNode = m_Scene.Add(m_Camera.m_Transform);
+		m_SpinNode = m_Scene.Add();
+
+		// Spheres are laid out in a cube, every instance shares the spinning rotation
 		{
-			feBufferObjectCreateInfo info;
-			info.target = GL_ARRAY_BUFFER;
-			info.data = sphere.getInterleavedVertices();
-			info.size = sphere.getInterleavedVertexSize();
-			info.debugName = "Sphere VBO";
+			int side = 1;
+			while (side * side * side < config.instanceCount) ++side;
+
+			m_InstanceTransforms.Reserve(config.instanceCount);
+			for (int i = 0; i < config.instanceCount; ++i)
+			{
+				int x = i % side;
+				int y = (i / side) % side;
+				int z = i / (side * side);
+
+				feTransform transform;
+				transform.pos = glm::vec3((x - side / 2) * 3.0f, (y - side / 2) * 3.0f, -3.0f - z * 3.0f);
+				m_InstanceTransforms.Add(transform);
+			}
+
+			// Room for every instance in one frame, the visible ones are written straight into it
+			feStreamBufferCreateInfo bufferInfo;
+			bufferInfo.target = GL_ARRAY_BUFFER;
+			bufferInfo.frameSize = m_InstanceTransforms.GetCount() * sizeof(feInstanceTransform);
+			bufferInfo.debugName = "Instance transforms";
+
+			m_InstanceBuffer = bufferInfo;
+		}
+
+		feMeshFormatInfo formatInfo;
+		formatInfo.SetLayout<Sphere::PackedVertex>();
+		formatInfo.SetInstanceLayout<feInstanceTransform>(&m_InstanceBuffer);
+		formatInfo.mode = GL_TRIANGLES;
+		formatInfo.debugName = "PNT vao";
+
+		m_MeshFormat = m_MeshHeap.AddFormat(formatInfo);
+		m_SphereLods = feMeshLod::UploadSphere(m_MeshHeap, m_MeshFormat, sphereInfo, 4);
+		if (m_SphereLods.GetLevelCount() == 0) feLog::Error("No sphere LOD level fit in the mesh heap, instances will not be drawn");
+		m_InstanceLods.assign(m_InstanceTransforms.GetCount(), SIZE_MAX);
+
+		// The spheres only spin in place, their bounds never change
+		m_InstanceBounds.Reserve(m_InstanceTransforms.GetCount());
+		for (size_t i = 0; i < m_InstanceTransforms.GetCount(); ++i) m_InstanceBounds.Add(m_InstanceTransforms.GetPosition(i), m_SphereLods.boundingRadius);
 
-			m_Vbo = info;
+		// Only used for picking, so it is never refit
+		{
+			std::vector<feAabb> boxes = std::vector<feAabb>(m_InstanceBounds.GetCount());
+			for (size_t i = 0; i < boxes.size(); ++i) boxes[i] = feAabb::FromSphere(m_InstanceBounds.GetCenter(i), m_InstanceBounds.GetRadius(i));
+
+			feBvhCreateInfo bvhInfo;
+			bvhInfo.bounds = boxes.data();
+			bvhInfo.count = boxes.size();
+
+			m_InstanceBvh = bvhInfo;
 		}
 
 		{
-			feBufferObjectCreateInfo info;
-			info.target = GL_ELEMENT_ARRAY_BUFFER;
-			info.data = sphere.getIndices();
-			info.size = sphere.getIndexSize();
-			info.debugName = "Sphere indices";
+			feFrustumCullerCreateInfo cullerInfo;
+			cullerInfo.threadPool = &m_ThreadPool;
 
-			m_Ibo = info;
+			m_Culler = cullerInfo;
 		}
-		
-		feVertexArrayCreateInfoBufferObjectInfo vaoVboInfo;
-		vaoVboInfo.buffer = &m_Vbo;
-		vaoVboInfo.stride = 8 * sizeof(float);
 
-		feVertexArrayCreateInfoAttributeInfo attributeInfos[3];
+		if (config.occlusionCulling)
+		{
+			feOcclusionCullerCreateInfo occlusionInfo;
+			occlusionInfo.threadPool = &m_ThreadPool;
+
+			m_OcclusionCuller = std::make_unique<feOcclusionCuller>(occlusionInfo);
+
+			// Occluders have to stay inside the drawn spheres, each one is scaled to the inscribed radius of the level
+			// its instance is drawn with. The icosphere's own faces lie inside its unit vertices.
+			m_OccluderMesh = feSphereMeshes::Icosphere(1.0f, 1);
+		}
+		m_LodInstanceCounts.resize(m_SphereLods.GetLevelCount());
+		m_LodInstanceEnds.resize(m_SphereLods.GetLevelCount());
+
+		// The batch reads per-draw data itself, its format has no instance attributes
+		{
+			feMeshFormatInfo batchFormatInfo;
+			batchFormatInfo.SetLayout<Sphere::PackedVertex>();
+			batchFormatInfo.mode = GL_TRIANGLES;
+			batchFormatInfo.debugName = "PNT batch vao";
+
+			m_BatchFormat = m_MeshHeap.AddFormat(batchFormatInfo);
 
-		attributeInfos[0].buffer = 0;
-		attributeInfos[0].offset = 0 * sizeof(float);
-		attributeInfos[0].size = 3;
-		attributeInfos[0].type = GL_FLOAT;
+			feSphereGeneratorInfo smallSphereInfo = sphereInfo;
+			smallSphereInfo.radius = 0.5f;
+			smallSphereInfo.sectorCount = 18;
+			smallSphereInfo.stackCount = 9;
 
-		attributeInfos[1].buffer = 0;
-		attributeInfos[1].offset = 3 * sizeof(float);
-		attributeInfos[1].size = 3;
-		attributeInfos[1].type = GL_FLOAT;
+			m_BatchMeshes[0] = UploadSphere(m_MeshHeap, m_BatchFormat, sphereInfo);
+			m_BatchMeshes[1] = UploadSphere(m_MeshHeap, m_BatchFormat, smallSphereInfo);
 
-		attributeInfos[2].buffer = 0;
-		attributeInfos[2].offset = 5 * sizeof(float);
-		attributeInfos[2].size = 2;
-		attributeInfos[2].type = GL_FLOAT;
+			feBatchRendererCreateInfo batchInfo;
+			batchInfo.heap = &m_MeshHeap;
+			batchInfo.debugName = "Batch";
 
-		feVertexArrayCreateInfo vaoInfo;
-		vaoInfo.attributeInfos = attributeInfos;
-		vaoInfo.attributeInfoCount = 3;
-		vaoInfo.count = sphere.getIndexCount();
-		vaoInfo.mode = GL_TRIANGLES;
-		vaoInfo.vertexBufferInfos = &vaoVboInfo;
-		vaoInfo.vertexBufferInfoCount = 1;
-		vaoInfo.indexBuffer = &m_Ibo;
-		vaoInfo.debugName = "Sphere vao";
+			m_Batch = batchInfo;
+		}
 
-		m_Vao = vaoInfo;
+		feProgramCacheCreateInfo cacheInfo;
+		cacheInfo.enabled = config.programCache;
 
-		std::string vertSrc = feResourceLoader::LoadTextFile("res/shaders/simple.vert").value();
-		std::string fragSrc = feResourceLoader::LoadTextFile("res/shaders/simple.frag").value();
+		m_ProgramCache = cacheInfo;
 
-		feShader shaders[2];
+		feProgramCompilerCreateInfo compilerInfo;
+		compilerInfo.cache = &m_ProgramCache;
 
-		feShaderCreateInfo shaderInfo;
-		shaderInfo.type = GL_VERTEX_SHADER;
-		std::string_view view = vertSrc;
-		shaderInfo.sources = &view;
-		shaderInfo.sourceCount = 1;
-		shaderInfo.debugName = "Shader Vertex";
+		m_ProgramCompiler = compilerInfo;
 
-		shaders[0] = feShader(shaderInfo);
+		feShaderLibraryCreateInfo libraryInfo;
+		libraryInfo.cache = &m_ProgramCache;
 
-		shaderInfo.type = GL_FRAGMENT_SHADER;
-		shaderInfo.debugName = "Shader Fragment";
-		view = fragSrc;
+		m_ShaderLibrary = libraryInfo;
 
-		shaders[1] = feShader(shaderInfo);
+		// Both programs read the model matrix from the instance attribute
+		feShaderDefine instancedDefine = { "FE_INSTANCED", "1" };
 
-		feProgramCreateInfo programInfo;
-		programInfo.shaders = shaders;
-		programInfo.shaderCount = 2;
-		programInfo.debugName = "Main Program";
+		{
+			// Small enough to build up front, it is drawn with until the main program is ready
+			feShaderStageFile files[2] =
+			{
+				{ GL_VERTEX_SHADER, "res/shaders/fallback.vert" },
+				{ GL_FRAGMENT_SHADER, "res/shaders/fallback.frag" }
+			};
+
+			feShaderVariantInfo variantInfo;
+			variantInfo.files = files;
+			variantInfo.fileCount = 2;
+			variantInfo.defines = &instancedDefine;
+			variantInfo.defineCount = 1;
+			variantInfo.debugName = "Fallback Program";
+
+			m_FallbackProgram.Set(m_ShaderLibrary.GetProgram(variantInfo));
+			if (m_FallbackProgram.program) m_MeshHeap.Validate(m_MeshFormat, *m_FallbackProgram.program, variantInfo.debugName);
+		}
 
-		m_Program = programInfo;
+		{
+			// Indirect batches read their draw data from a storage buffer, the loop sets the same uniforms as simple
+			feShaderStageFile files[2] =
+			{
+				{ GL_VERTEX_SHADER, m_Batch.IsIndirect() ? "res/shaders/batch.vert" : "res/shaders/simple.vert" },
+				{ GL_FRAGMENT_SHADER, m_Batch.IsIndirect() ? "res/shaders/batch.frag" : "res/shaders/simple.frag" }
+			};
+
+			feShaderVariantInfo variantInfo;
+			variantInfo.files = files;
+			variantInfo.fileCount = 2;
+			variantInfo.debugName = "Batch Program";
+
+			m_BatchProgram = m_ShaderLibrary.GetProgram(variantInfo);
+			if (m_BatchProgram) m_MeshHeap.Validate(m_BatchFormat, *m_BatchProgram, variantInfo.debugName);
+		}
+
+		{
+			feShaderStageFile files[2] =
+			{
+				{ GL_VERTEX_SHADER, "res/shaders/simple.vert" },
+				{ GL_FRAGMENT_SHADER, "res/shaders/simple.frag" }
+			};
+
+			feShaderVariantInfo variantInfo;
+			variantInfo.files = files;
+			variantInfo.fileCount = 2;
+			variantInfo.debugName = "Queue Program";
+
+			m_QueueProgram = m_ShaderLibrary.GetProgram(variantInfo);
+			if (m_QueueProgram) m_MeshHeap.Validate(m_BatchFormat, *m_QueueProgram, variantInfo.debugName);
+
+			// Position only, it stands in for the queue program during the depth prepass
+			files[0].filename = "res/shaders/fallback.vert";
+			files[1].filename = "res/shaders/fallback.frag";
+			variantInfo.debugName = "Depth Program";
+
+			m_DepthProgram = m_ShaderLibrary.GetProgram(variantInfo);
+
+			feRenderQueueCreateInfo queueInfo;
+			queueInfo.heap = &m_MeshHeap;
+			queueInfo.depthPrepass = config.depthPrepass;
+			queueInfo.depthProgram = m_DepthProgram.get();
+			queueInfo.maxDepth = 100.0f;
+
+			m_Queue = queueInfo;
+		}
+
+		{
+			feShaderPreprocessor& preprocessor = m_ShaderLibrary.GetPreprocessor();
+
+			std::string vertSrc = preprocessor.Process("res/shaders/simple.vert", &instancedDefine, 1).value();
+			std::string fragSrc = preprocessor.Process("res/shaders/simple.frag", nullptr, 0).value();
+			std::string_view sources[2] = { vertSrc, fragSrc };
+
+			feShaderCreateInfo shaderInfos[2];
+
+			shaderInfos[0].type = GL_VERTEX_SHADER;
+			shaderInfos[0].sources = &sources[0];
+			shaderInfos[0].sourceCount = 1;
+			shaderInfos[0].debugName = "Shader Vertex";
+
+			shaderInfos[1].type = GL_FRAGMENT_SHADER;
+			shaderInfos[1].sources = &sources[1];
+			shaderInfos[1].sourceCount = 1;
+			shaderInfos[1].debugName = "Shader Fragment";
+
+			feProgramCompilerRequest request;
+			request.shaderInfos = shaderInfos;
+			request.shaderInfoCount = 2;
+			request.debugName = "Main Program";
+
+			m_MainProgramHandle = m_ProgramCompiler.Submit(request);
+		}
+
+		if (config.planet)
+		{
+			feShaderStageFile files[2] =
+			{
+				{ GL_VERTEX_SHADER, "res/shaders/planet.vert" },
+				{ GL_FRAGMENT_SHADER, "res/shaders/simple.frag" }
+			};
+
+			feShaderVariantInfo variantInfo;
+			variantInfo.files = files;
+			variantInfo.fileCount = 2;
+			variantInfo.debugName = "Planet Program";
+
+			m_PlanetProgram = m_ShaderLibrary.GetProgram(variantInfo);
+			if (m_PlanetProgram) feVertexLayoutOf<fePlanetVertex>::value.Validate(*m_PlanetProgram, variantInfo.debugName);
+
+			// Below the scene and large enough that flying down to it splits the faces several levels deep
+			fePlanetCreateInfo planetInfo;
+			planetInfo.center = glm::dvec3(0.0, -75.0, -40.0);
+			planetInfo.radius = 60.0;
+			planetInfo.threadPool = &m_ThreadPool;
+			planetInfo.debugName = "Planet";
+
+			m_Planet = std::make_unique<fePlanet>(planetInfo);
+		}
+
+		m_CameraBuffer = feUniformBuffer::CreateInfo<feUniformBlockCamera>("Camera UBO");
 
 		m_Script.Run("res/scripts/game.lua");
 
@@ -360,6 +652,36 @@ public:
 
 	virtual void Destroy() override
 	{
+		const feProgramCacheStats& cacheStats = m_ProgramCache.GetStats();
+		feLog::Debug("Program cache: {} hits, {} misses, {} rejected, {} stored", cacheStats.hits, cacheStats.misses, cacheStats.rejected, cacheStats.stored);
+
+		const feRenderStateStats& stateStats = feRenderState::GetTotalStats();
+		feLog::Debug("Render state changes: {} issued, {} elided", stateStats.issued, stateStats.elided);
+
+		const feRenderQueueStats& queueStats = m_Queue.GetFrameStats();
+		const feFrustumCullerStats& cullStats = m_Culler.GetFrameStats();
+		feLog::Debug("Frustum culling: {} visible, {} culled", cullStats.visible, cullStats.culled);
+
+		if (m_OcclusionCuller)
+		{
+			const feOcclusionCullerStats& occlusionStats = m_OcclusionCuller->GetFrameStats();
+			feLog::Debug("Occlusion culling: {} of {} culled by {} occluders, {:.3f} ms rasterizing {} triangles, {:.3f} ms testing", occlusionStats.culled, occlusionStats.tested, occlusionStats.occluders, occlusionStats.rasterizeMilliseconds, occlusionStats.rasterized, occlusionStats.testMilliseconds);
+		}
+
+		feLog::Debug("Render queue: {} commands, {} program and {} format changes, {} and {} in submission order", queueStats.commands, queueStats.programChanges, queueStats.formatChanges, queueStats.unsortedProgramChanges, queueStats.unsortedFormatChanges);
+
+		if (m_Planet)
+		{
+			const fePlanetStats& planetStats = m_Planet->GetFrameStats();
+			feLog::Debug("Planet: {} patches drawn, {} culled, {} resident, {} pending", planetStats.drawn, planetStats.culled, planetStats.resident, planetStats.pending);
+		}
+
+		if (m_MainProgram.program)
+		{
+			const feUniformUploadStats& stats = m_MainProgram.program->GetUploadStats();
+			feLog::Debug("Main Program uniform uploads: {} issued, {} skipped", stats.issued, stats.skipped);
+		}
+
 		m_EventDispatcher.Unsubscribe(this);
 		m_Input.Unset();
 	}
@@ -383,27 +705,219 @@ public:
 		// Don't render if the window is iconified
 		if (w == 0 || h == 0) return;
 
-		m_Camera.Move(m_Input, (float) GetDeltaTime());
+		if (m_Camera.Move(m_Input, (float) GetDeltaTime())) m_Scene.SetLocal(m_CameraNode, m_Camera.m_Transform);
+
+		feRenderState::BeginFrame();
 
 		feRenderUtil::Viewport(0, 0, w, h);
 		feRenderUtil::Clear();
 
 		glm::mat4 proj = glm::perspective(glm::radians(80.f), m_Window.GetAspect(), 0.1f, 100.0f);
 
-		m_Transform.pos = { 0, 0, -3 };
-		m_Transform.Rotate(glm::radians((float) GetDeltaTime() * 30), glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f)));
+		glm::quat spin = glm::angleAxis(glm::radians((float) GetDeltaTime() * 30), glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f)));
+		m_Scene.Rotate(m_SpinNode, spin);
+		m_InstanceTransforms.RotateAll(spin);
+
+		feUniformBlockCamera camera;
+		// Only the nodes that changed since last frame are recomputed
+		m_Scene.Propagate();
+
+		camera.view = m_Scene.GetInverseWorld(m_CameraNode);
+		camera.proj = proj;
+		camera.viewProj = proj * camera.view;
+		camera.position = glm::vec4(m_Camera.m_Transform.pos, 1.0f);
+
+		m_CameraBuffer.Update(camera);
+		m_CameraBuffer.Bind();
+
+		feFrustum frustum = feFrustum::FromMatrix(camera.viewProj);
+
+		// Clicking while the cursor is free picks the closest instance under it
+		if (m_Camera.m_Locked && m_Input.IsButtonPressed(GLFW_MOUSE_BUTTON_LEFT)) PickInstance(camera.viewProj);
+
+		m_ProgramCompiler.Poll();
+		if (m_ProgramCompiler.IsReady(m_MainProgramHandle))
+		{
+			m_MainProgram.Set(std::make_shared<feProgram>(m_ProgramCompiler.Take(m_MainProgramHandle)));
+			m_MeshHeap.Validate(m_MeshFormat, *m_MainProgram.program, "Main Program");
+		}
+
+		SceneProgram& program = m_MainProgram.IsReady() ? m_MainProgram : m_FallbackProgram;
+
+		// Nothing can draw the instances while the main program compiles if the fallback failed to load
+		bool drawInstances = program.IsReady();
+		if (drawInstances)
+		{
+			program.program->Bind();
+			program.program->Uniform3f(program.color, { 1.0f, 0.5f, 0.0f });
+		}
+
+		const glm::mat4& rotation = m_Scene.GetWorld(m_SpinNode);
+
+		// Instances are grouped by LOD level, each level draws its range of the instance buffer. Without base
+		// instances every instance uses the most detailed level.
+		m_LodSelector.SetProjection(proj, h);
+		bool selectLods = feRenderUtil::GetSupportedVersion() >= 42;
+
+		// Only the instances inside the view are bucketed and uploaded
+		m_Culler.Cull(frustum, m_InstanceBounds, m_VisibleInstances);
+		// Every visible instance needs a level to be bucketed into
+		if (m_SphereLods.GetLevelCount() == 0) m_VisibleInstances.clear();
+
+		for (uint32_t i : m_VisibleInstances)
+		{
+			float distance = glm::length(m_InstanceTransforms.GetPosition(i) - m_Camera.m_Transform.pos);
+			m_InstanceLods[i] = selectLods ? m_LodSelector.Select(m_SphereLods, m_SphereLods.boundingRadius, distance, m_InstanceLods[i]) : 0;
+		}
+
+		// Occluders are sized to the level each instance is drawn with, so levels are picked first
+		if (m_OcclusionCuller) CullOccludedInstances(camera.viewProj);
+
+		std::fill(m_LodInstanceCounts.begin(), m_LodInstanceCounts.end(), 0);
+		for (uint32_t i : m_VisibleInstances) ++m_LodInstanceCounts[m_InstanceLods[i]];
+
+		unsigned int lodInstanceStart = 0;
+		for (size_t level = 0; level < m_LodInstanceCounts.size(); ++level)
+		{
+			m_LodInstanceEnds[level] = lodInstanceStart;
+			lodInstanceStart += m_LodInstanceCounts[level];
+		}
+
+		// Visible instances in the order they are drawn, so only their matrices are built, straight into the buffer
+		m_DrawnInstances.resize(m_VisibleInstances.size());
+		for (uint32_t i : m_VisibleInstances) m_DrawnInstances[m_LodInstanceEnds[m_InstanceLods[i]]++] = i;
+
+		// The allocation offset is a whole number of instances, persistent sections are reached through the base
+		// instance, which GL 4.4 always has. Older contexts orphan and always start at 0.
+		m_InstanceBuffer.BeginFrame();
+		feStreamAllocation instanceAllocation;
+		if (!m_VisibleInstances.empty()) instanceAllocation = m_InstanceBuffer.Allocate(m_VisibleInstances.size() * sizeof(feInstanceTransform), sizeof(feInstanceTransform));
+
+		if (instanceAllocation.data)
+		{
+			static_assert(sizeof(feInstanceTransform) == sizeof(glm::mat4), "Instances are written as bare matrices");
+			m_InstanceTransforms.BuildMatrices(m_DrawnInstances, static_cast<glm::mat4*>(instanceAllocation.data), nullptr, &m_ThreadPool);
+
+			m_InstanceBuffer.Flush();
+		}
+
+		if (drawInstances && instanceAllocation.data)
+		{
+			unsigned int baseInstance = static_cast<unsigned int>(instanceAllocation.offset / sizeof(feInstanceTransform));
+
+			m_MeshHeap.Bind(m_MeshFormat);
+			for (size_t level = 0; level < m_LodInstanceCounts.size(); ++level)
+			{
+				unsigned int count = m_LodInstanceCounts[level];
+				if (count > 0) m_MeshHeap.DrawInstanced(m_SphereLods.GetMesh(level), count, baseInstance + m_LodInstanceEnds[level] - count);
+			}
+		}
+
+		m_InstanceBuffer.EndFrame();
+
+		if (m_Planet && m_PlanetProgram)
+		{
+			glm::dvec3 cameraPosition = glm::dvec3(m_Camera.m_Transform.pos);
+			m_Planet->Update(cameraPosition, &frustum);
+
+			m_PlanetProgram->Bind();
+			m_PlanetProgram->Uniform3f(m_PlanetProgram->GetUniformSlot("u_Color"_uniform), { 0.4f, 0.6f, 0.3f });
+			m_Planet->Draw(*m_PlanetProgram, cameraPosition);
+		}
+
+		// A ring of mixed meshes and colors, submitted through the batch
+		m_Batch.Begin();
+
+		constexpr int ringCount = 32;
+		for (int i = 0; i < ringCount; ++i)
+		{
+			float angle = glm::radians(360.0f) * i / ringCount + (float) GetTime() * 0.2f;
+
+			feBatchDrawData data;
+			data.model = glm::translate(glm::mat4(1.0f), glm::vec3(glm::cos(angle) * 8.0f, 4.0f, glm::sin(angle) * 8.0f - 10.0f)) * rotation;
+			data.color = glm::vec4(0.5f + 0.5f * glm::cos(angle), 0.5f + 0.5f * glm::sin(angle), 1.0f, 1.0f);
+
+			m_Batch.Submit(m_BatchProgram.get(), m_BatchMeshes[i % 2], data);
+		}
+
+		m_Batch.End();
+
+		// A row of alternating opaque and translucent spheres, submitted in the worst order for state changes
+		m_Queue.Begin(m_Camera.m_Transform.pos);
+
+		constexpr int rowCount = 12;
+		for (int i = 0; i < rowCount; ++i)
+		{
+			feRenderCommand command;
+			command.program = i % 3 == 0 ? m_DepthProgram.get() : m_QueueProgram.get();
+			command.mesh = m_BatchMeshes[i % 2];
+			command.model = glm::translate(glm::mat4(1.0f), glm::vec3((i - rowCount / 2) * 2.5f, -4.0f, -6.0f)) * rotation;
+			command.color = glm::vec4(0.2f, 0.8f, 0.4f, i % 4 == 1 ? 0.4f : 1.0f);
+			command.translucent = command.color.w < 1.0f;
+
+			m_Queue.Submit(command);
+		}
 
-		m_Program.Bind();
-		m_Program.Uniform3f("u_Color", { 1.0f, 0.5f, 0.0f });
-		m_Program.UniformMat4f("u_Model", m_Transform.GetMatrix());
-		m_Program.UniformMat4f("u_View", glm::inverse(m_Camera.m_Transform.GetMatrix()));
-		m_Program.UniformMat4f("u_Proj", proj);
-		m_Vao.Bind();
-		m_Vao.Draw();
+		m_Queue.Execute();
 
 		m_Window.SwapBuffers();
 	}
 
+	// The nearest visible instances are drawn into the occlusion buffer, then every visible instance is tested against it
+	void CullOccludedInstances(const glm::mat4& viewProj)
+	{
+		constexpr size_t maxOccluders = 16;
+
+		glm::vec3 cameraPosition = m_Camera.m_Transform.pos;
+		auto closer = [&](uint32_t a, uint32_t b)
+		{
+			return glm::length2(m_InstanceBounds.GetCenter(a) - cameraPosition) < glm::length2(m_InstanceBounds.GetCenter(b) - cameraPosition);
+		};
+
+		m_OccluderInstances = m_VisibleInstances;
+		if (m_OccluderInstances.size() > maxOccluders)
+		{
+			std::nth_element(m_OccluderInstances.begin(), m_OccluderInstances.begin() + maxOccluders, m_OccluderInstances.end(), closer);
+			m_OccluderInstances.resize(maxOccluders);
+		}
+
+		m_OcclusionCuller->Begin(viewProj);
+		for (uint32_t i : m_OccluderInstances)
+		{
+			// Scaled a little further in, the drawn vertices are halves
+			float radius = m_SphereLods.GetLevel(m_InstanceLods[i]).inscribedRadius * 0.99f;
+			glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), m_InstanceBounds.GetCenter(i)), glm::vec3(radius));
+			m_OcclusionCuller->AddOccluder(m_OccluderMesh.vertices.data(), 8, m_OccluderMesh.indices.data(), m_OccluderMesh.indices.size(), model);
+		}
+
+		m_OcclusionCuller->Rasterize();
+		m_OcclusionCuller->Cull(m_InstanceBounds, m_VisibleInstances);
+	}
+
+	void PickInstance(const glm::mat4& viewProj)
+	{
+		auto [w, h] = m_Window.GetSize();
+		glm::vec2 cursor = m_Input.GetMousePosition();
+		glm::vec2 ndc = glm::vec2(2.0f * cursor.x / w - 1.0f, 1.0f - 2.0f * cursor.y / h);
+
+		// The ray runs from the near plane to the far plane, so distances are fractions of the view depth
+		glm::mat4 inverseViewProj = glm::inverse(viewProj);
+		glm::vec4 start = inverseViewProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+		glm::vec4 end = inverseViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+
+		glm::vec3 origin = glm::vec3(start) / start.w;
+		glm::vec3 direction = glm::vec3(end) / end.w - origin;
+
+		feBvhRayHit hit;
+		bool picked = m_InstanceBvh.Raycast(origin, direction, 1.0f, [&](uint32_t index)
+		{
+			return feBvh::IntersectRaySphere(origin, direction, m_InstanceBounds.GetCenter(index), m_InstanceBounds.GetRadius(index));
+		}, hit);
+
+		if (picked) feLog::Info("Picked instance {} at {:.2f}", hit.index, glm::length(direction) * hit.distance);
+		else feLog::Info("Picked nothing");
+	}
+
 	virtual double GetTime() override
 	{
 		return feWindow::GetTime();
@@ -413,14 +927,48 @@ public:
 	feWindow m_Window;
 private:
 
-	feVertexArray m_Vao;
-	feBufferObject m_Vbo;
-	feBufferObject m_Ibo;
-	feProgram m_Program;
+	feThreadPool m_ThreadPool;
+	feStreamBuffer m_InstanceBuffer;
+	feTransformArray m_InstanceTransforms;
+	feMeshHeap m_MeshHeap;
+	feMeshFormat m_MeshFormat;
+	feMeshLodChain m_SphereLods;
+	feLodSelector m_LodSelector;
+	// Level each instance used last frame, for hysteresis
+	std::vector<size_t> m_InstanceLods;
+	std::vector<unsigned int> m_LodInstanceCounts;
+	std::vector<unsigned int> m_LodInstanceEnds;
+	// Visible instances grouped by level
+	std::vector<uint32_t> m_DrawnInstances;
+	feBoundingSphereArray m_InstanceBounds;
+	feFrustumCuller m_Culler;
+	feBvh m_InstanceBvh;
+	std::unique_ptr<feOcclusionCuller> m_OcclusionCuller;
+	feSphereMesh m_OccluderMesh;
+	std::vector<uint32_t> m_OccluderInstances;
+	std::vector<uint32_t> m_VisibleInstances;
+	feMeshFormat m_BatchFormat;
+	feMeshAllocation m_BatchMeshes[2];
+	feBatchRenderer m_Batch;
+	std::shared_ptr<feProgram> m_BatchProgram;
+	feRenderQueue m_Queue;
+	std::shared_ptr<feProgram> m_QueueProgram;
+	std::shared_ptr<feProgram> m_DepthProgram;
+	std::shared_ptr<feProgram> m_PlanetProgram;
+	std::unique_ptr<fePlanet> m_Planet;
+	feProgramCache m_ProgramCache;
+	feProgramCompiler m_ProgramCompiler;
+	feShaderLibrary m_ShaderLibrary;
+	feProgramCompilerHandle m_MainProgramHandle;
+	SceneProgram m_MainProgram;
+	SceneProgram m_FallbackProgram;
+	feUniformBuffer m_CameraBuffer;
 
 	ScriptState m_Script;
 
-	feTransform m_Transform;
+	feTransformHierarchy m_Scene;
+	feTransformNode m_CameraNode;
+	feTransformNode m_SpinNode;
 
 	Input m_Input;
 	Camera m_Camera;
@@ -18,4 +18,11 @@ struct feEventWindowMouseMove final
 {
 	const feWindow* window;
 	float x, y;
+};
+
+struct feEventWindowMouseButton final
+{
+	const feWindow* window;
+	int button;
+	bool pressed;
 };
\ No newline at end of file
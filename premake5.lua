@@ -90,6 +90,88 @@ project "Engine"
 		defines "FE_CONF_DIST"
 		kind "WindowedApp"
 
+project "Benchmark"
+	location "Benchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+
+	targetdir (outputbindir)
+	objdir (outputobjdir)
+
+	-- Builds the engine sources itself, the entry point is replaced by the benchmark runner
+	files
+	{
+		"%{prj.location}/src/**.cpp",
+		"%{prj.location}/src/**.h",
+		"%{wks.location}/Engine/src/engine/**.cpp",
+		"%{wks.location}/Engine/src/engine/**.h"
+	}
+
+	removefiles
+	{
+		"%{wks.location}/Engine/src/engine/EntryPoint.cpp"
+	}
+
+	includedirs
+	{
+		"%{wks.location}/Engine/src",
+		"%{wks.location}/vendor/glfw/include",
+		"%{wks.location}/vendor/glad2/include",
+		"%{wks.location}/vendor/glm",
+		"%{wks.location}/vendor/spdlog/include"
+	}
+
+	defines
+	{
+		"GLFW_INCLUDE_NONE"
+	}
+
+	links
+	{
+		"glfw",
+		"glad2"
+	}
+
+	filter "system:windows"
+		defines "FE_PLAT_WINDOWS"
+		systemversion "latest"
+		
+	filter "system:linux"
+		defines "FE_PLAT_LINUX"
+
+		links
+		{
+			"dl",
+			"pthread"
+		}
+
+	filter "system:macosx"
+		defines "FE_PLAT_MAC"
+
+		links
+		{
+			"CoreFoundation.framework",
+			"Cocoa.framework",
+			"IOKit.framework",
+			"CoreVideo.framework"
+		}
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		defines "FE_CONF_DEBUG"
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+		defines "FE_CONF_RELEASE"
+
+	filter "configurations:Dist"
+		runtime "Release"
+		optimize "on"
+		defines "FE_CONF_DIST"
+
 group "Dependencies"
 
 project "glm"